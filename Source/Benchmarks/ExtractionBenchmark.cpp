@@ -0,0 +1,460 @@
+// End-to-end benchmark of symbol extraction from generated verilog source files.
+// Copyright (c) 2020 Stanislav Jurny (github.com/STjurny) licence MIT
+
+// The extraction is run in-process so the whole SymbolEx is compiled here without its main.
+#define SYMBOLEX_WITHOUT_MAIN
+#include "../SymbolEx.cpp"
+
+#include <random>
+
+
+
+// Corpus Parameters //////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The corpus is generated only from the parameters so the same parameters always give the same files (mt19937 is
+// defined exactly by the standard and distributions of the standard library are not used).
+struct CorpusParameters
+{
+    int seed = 1;
+    int fileCount = 200;
+    int fileSize = 64;  // KiB, size of each file varies from half to one and half of it
+    int density = 30;  // percent of source bytes in marked localparam blocks
+    int tableSize = 40;  // symbols in marked block, varies from half to one and half of it
+    string formats = "bhodn";  // number formats: 'b 'h 'o 'd and plain decimal (n)
+    int sizedRatio = 50;  // percent of numbers with bit width (e.g. 8'h1F)
+    int underscoreRatio = 20;  // percent of numbers with digits separated by underscores
+    int noise = 20;  // percent of symbols and code lines accompanied with comments
+};
+
+
+
+// Generating Corpus //////////////////////////////////////////////////////////////////////////////////////////////////
+
+class CorpusGenerator
+{
+    public:
+        CorpusGenerator(const CorpusParameters & aParameters): fRandom((unsigned) aParameters.seed)
+        {
+            fParameters = aParameters;
+            fByteCount = 0;
+            fTableCount = 0;
+            fSymbolCount = 0;
+        }
+
+        void generate(String aDirectoryPath)
+        {
+            filesystem::remove_all(aDirectoryPath.rb());
+            createDirectoryPath(aDirectoryPath);
+
+            for (int fileIndex = 0; fileIndex < fParameters.fileCount; fileIndex++)
+            {
+                char fileName[32];
+                snprintf(fileName, sizeof(fileName), "Module%04d", fileIndex);
+
+                string text = generateFile(fileName);
+                fByteCount += (long long) text.size();
+
+                string filePath = (filesystem::path(aDirectoryPath.rb()) / (string(fileName) + ".v")).string();
+                ofstream file(filePath, ios::out | ios::binary);
+                file.write(text.data(), text.size());
+
+                if (!file)
+                    throw String::formatted(lf("Can't write file \"%s\"."), filePath.c_str());
+            }
+        }
+
+        long long byteCount() const { return fByteCount; }
+        long long tableCount() const { return fTableCount; }
+        long long symbolCount() const { return fSymbolCount; }
+
+    private:
+        string generateFile(const char * aModuleName)
+        {
+            string text;
+            appendFormatted(&text, "`default_nettype none\n\nmodule %s\n  (\n    input wire iClock\n  );\n\n", aModuleName);
+
+            size_t targetSize = (size_t) fParameters.fileSize * 1024 * randomInt(50, 150) / 100;
+            size_t markedSize = 0;
+            int tableIndex = 0;
+
+            while (text.size() < targetSize)
+                if (markedSize * 100 < (size_t) fParameters.density * text.size())
+                {
+                    size_t startSize = text.size();
+                    appendMarkedBlock(&text, tableIndex++);
+                    markedSize += text.size() - startSize;
+                }
+                else
+                    appendCode(&text);
+
+            text += "\nendmodule\n";
+
+            return text;
+        }
+
+        void appendMarkedBlock(string * ioText, int aTableIndex)
+        {
+            static const char * const words[] = { "Idle", "Start", "Data", "Parity", "Stop", "Wait", "Read", "Write" };
+
+            int symbolCount = max(1, fParameters.tableSize * randomInt(50, 150) / 100);
+            int step = randomInt(1, 4);
+            int bitWidth = min((int) verilogNumberMaxBitWidth, bitWidthOf((VerilogNumber) (symbolCount - 1) * step) + randomInt(0, 3));
+            bool hasPrefix = randomChance(50);
+
+            appendFormatted(ioText, "  localparam // $Table%d:%d%s\n", aTableIndex, bitWidth, hasPrefix ? ",s" : "");
+
+            for (int index = 0; index < symbolCount; index++)
+            {
+                if (randomChance(fParameters.noise / 2))
+                    *ioText += "    /* the next state, see the spec; rev. 2 */\n";
+
+                appendFormatted(ioText, "    s%s%d = ", words[index % size(words)], index);
+                *ioText += formatNumber((VerilogNumber) index * step, bitWidth);
+                *ioText += index + 1 < symbolCount ? "," : ";";
+
+                if (randomChance(fParameters.noise / 2))
+                    *ioText += "  // it waits for the clock, then it continues; see above";
+
+                *ioText += "\n";
+            }
+
+            *ioText += "\n";
+
+            fTableCount += 1;
+            fSymbolCount += symbolCount;
+        }
+
+        void appendCode(string * ioText)
+        {
+            // ordinary code including unmarked localparam which has to be skipped by the parser
+
+            if (randomChance(fParameters.noise))
+                *ioText +=
+                    "  /*\n"
+                    "    Counter of ticks. It is reset at the start of each bit, the value is compared with \n"
+                    "    the count of ticks per bit; see the parameters of module.\n"
+                    "  */\n";
+
+            switch (randomInt(0, 2))
+            {
+                case 0:
+                    appendFormatted(ioText, "  localparam Width%d = %d, Depth%d = %d;\n\n", fCodeIndex, randomInt(1, 64), fCodeIndex, randomInt(1, 1024));
+                    break;
+
+                case 1:
+                    appendFormatted(ioText,
+                        "  reg [7:0] Counter%d = 0;\n\n"
+                        "  always @(posedge iClock)\n"
+                        "    if (Counter%d == 8'd%d)\n"
+                        "      Counter%d <= 0;\n"
+                        "    else\n"
+                        "      Counter%d <= Counter%d + 1;%s\n\n",
+                        fCodeIndex, fCodeIndex, randomInt(0, 255), fCodeIndex, fCodeIndex, fCodeIndex,
+                        randomChance(fParameters.noise) ? "  // counts clock ticks" : "");
+                    break;
+
+                default:
+                    appendFormatted(ioText, "  wire [7:0] wLimit%d = 8'h%02x;\n\n", fCodeIndex, randomInt(0, 255));
+                    break;
+            }
+
+            fCodeIndex += 1;
+        }
+
+        string formatNumber(VerilogNumber aValue, int aBitWidth)
+        {
+            char format = fParameters.formats[randomInt(0, (int) fParameters.formats.size() - 1)];
+            int radix = format == 'b' ? 2 : format == 'o' ? 8 : format == 'h' ? 16 : 10;
+
+            string digits;
+            do {
+                digits.insert(digits.begin(), "0123456789abcdef"[aValue % radix]);
+                aValue /= radix;
+            } while (aValue);
+
+            if (digits.size() > 1 && randomChance(fParameters.underscoreRatio))
+                for (size_t index = digits.size() > 4 ? digits.size() - 4 : 1; index > 0; index = index > 4 ? index - 4 : 0)
+                    digits.insert(index, "_");
+
+            if (format == 'n')
+                return digits;
+
+            string result = randomChance(fParameters.sizedRatio) ? to_string(aBitWidth) : "";
+            result += '\'';
+            result += format;
+            result += digits;
+
+            return result;
+        }
+
+        static int bitWidthOf(VerilogNumber aValue)
+        {
+            int result = 1;
+
+            while (aValue >>= 1)
+                result += 1;
+
+            return result;
+        }
+
+        int randomInt(int aMin, int aMax)
+        {
+            return aMin + (int) (fRandom() % (unsigned) (aMax - aMin + 1));
+        }
+
+        bool randomChance(int aPercent)
+        {
+            return randomInt(0, 99) < aPercent;
+        }
+
+        static void appendFormatted(string * ioText, const char * aTemplate, ...)
+        {
+            char buffer[1024];
+
+            va_list arguments;
+            va_start(arguments, aTemplate);
+            vsnprintf(buffer, sizeof(buffer), aTemplate, arguments);
+            va_end(arguments);
+
+            *ioText += buffer;
+        }
+
+    private:
+        CorpusParameters fParameters;
+        mt19937 fRandom;
+        int fCodeIndex = 0;
+        long long fByteCount;
+        long long fTableCount;
+        long long fSymbolCount;
+};
+
+
+
+// Measuring Runs /////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct RunResult
+{
+    double seconds;
+    double mibPerSecond;
+    double filesPerSecond;
+    double symbolsPerSecond;
+};
+
+
+String percentilesAsJson(const vector<double> & aValues)
+{
+    String json;
+    json.appendFormatted("{ \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f }",
+        percentile(aValues, 0), percentile(aValues, 50), percentile(aValues, 90), percentile(aValues, 99), percentile(aValues, 100));
+    return json;
+}
+
+
+RunResult runExtraction(String aCorpusPath, String anOutputPath, const CorpusGenerator & aCorpus, vector<double> * ioFileMilliseconds)
+{
+    statistics.reset();
+
+    auto startTime = chrono::steady_clock::now();
+    extractSymbolsFromDirectory(aCorpusPath, anOutputPath);
+    double seconds = max(chrono::duration<double>(chrono::steady_clock::now() - startTime).count(), 1e-9);
+
+    if (statistics.counter(ctSymbols) != aCorpus.symbolCount())
+        throw String::formatted(
+            lf("Extracted %s symbols but %s symbols were generated."),
+            to_string(statistics.counter(ctSymbols)).c_str(), to_string(aCorpus.symbolCount()).c_str());
+
+    for (const auto & file : statistics.files())
+        ioFileMilliseconds->push_back(file.seconds * 1000);
+
+    return RunResult {
+        seconds,
+        (double) statistics.counter(ctSourceBytes) / (1 << 20) / seconds,
+        (double) statistics.counter(ctFiles) / seconds,
+        (double) statistics.counter(ctSymbols) / seconds };
+}
+
+
+
+// Parsing Command Line ///////////////////////////////////////////////////////////////////////////////////////////////
+
+struct BenchmarkOptions
+{
+    CorpusParameters corpus;
+    int runCount = 10;
+    String directoryPath;  // corpus and output are created in it
+    String outputFilePath;  // JSON results, standard output when empty
+};
+
+
+String benchmarkSyntaxDescription()
+{
+    return
+        "Syntax: ExtractionBenchmark [--seed n] [--files n] [--file-size KiB] [--density 0-100] [--table-size n]\n"
+        "    [--formats bhodn] [--sized 0-100] [--underscores 0-100] [--noise 0-100] [--runs n] [--jobs n]\n"
+        "    [--directory work_folder] [output_file.json]";
+}
+
+
+void readBenchmarkOptions(int aCount, char ** anArguments, BenchmarkOptions * oOptions)
+{
+    struct IntegerOption
+    {
+        const char * name;
+        int * value;
+        int minValue;
+        int maxValue;
+    };
+
+    const IntegerOption integerOptions[] = {
+        { "--seed", &oOptions->corpus.seed, 0, INT_MAX },
+        { "--files", &oOptions->corpus.fileCount, 1, 1000000 },
+        { "--file-size", &oOptions->corpus.fileSize, 1, 1 << 20 },
+        { "--density", &oOptions->corpus.density, 0, 100 },
+        { "--table-size", &oOptions->corpus.tableSize, 1, 1000000 },
+        { "--sized", &oOptions->corpus.sizedRatio, 0, 100 },
+        { "--underscores", &oOptions->corpus.underscoreRatio, 0, 100 },
+        { "--noise", &oOptions->corpus.noise, 0, 100 },
+        { "--runs", &oOptions->runCount, 1, 1000000 },
+        { "--jobs", &jobCount, 1, maxJobCount },
+    };
+
+    oOptions->directoryPath = (filesystem::temp_directory_path() / "SymbolExBenchmark").string().c_str();
+
+    for (int index = 1; index < aCount; index++)
+    {
+        String argument = anArguments[index];
+        const IntegerOption * option = NULL;
+
+        for (const auto & integerOption : integerOptions)
+            if (argument == integerOption.name)
+                option = &integerOption;
+
+        if (!option && argument != "--formats" && argument != "--directory")
+        {
+            if (!oOptions->outputFilePath.isEmpty())
+                throw String::formatted(lf("Unknown argument \"%s\".\n\n%s"), argument.rb(), benchmarkSyntaxDescription().rb());
+
+            oOptions->outputFilePath = argument;
+            continue;
+        }
+
+        if (index + 1 >= aCount)
+            throw String::formatted(lf("Value of \"%s\" missing.\n\n%s"), argument.rb(), benchmarkSyntaxDescription().rb());
+
+        String valueText = anArguments[++index];
+
+        if (argument == "--formats")
+        {
+            string formats = valueText.rb();
+
+            if (formats.empty() || formats.find_first_not_of("bhodn") != string::npos)
+                throw String::formatted(lf("Formats \"%s\" are invalid (use letters b h o d n)."), valueText.rb());
+
+            oOptions->corpus.formats = formats;
+        }
+        else if (argument == "--directory")
+            oOptions->directoryPath = valueText;
+        else
+        {
+            int value;
+            if (!tryStringToInt(valueText, &value, 10) || value < option->minValue || value > option->maxValue)
+                throw String::formatted(lf("Value \"%s\" of \"%s\" is invalid."), valueText.rb(), option->name);
+
+            *option->value = value;
+        }
+    }
+}
+
+
+
+// Main ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Generates the corpus, runs the extraction once for warming up and then measures --runs extractions of the whole
+// corpus. Results are written as JSON to the output file (or to standard output), progress is printed to standard
+// error. The corpus is just written so it is measured with warm page cache.
+int main(int argc, char * argv[])
+{
+    try {
+        BenchmarkOptions options;
+        readBenchmarkOptions(argc, argv, &options);
+
+        verbosityLevel = 0;
+        isCollectingStatistics = true;
+
+        String corpusPath = (filesystem::path(options.directoryPath.rb()) / "corpus").string().c_str();
+        String outputPath = (filesystem::path(options.directoryPath.rb()) / "output").string().c_str();
+
+        fprintf(stderr, "Generating corpus in %s\n", corpusPath.rb());
+
+        CorpusGenerator corpus(options.corpus);
+        corpus.generate(corpusPath);
+
+        filesystem::remove_all(outputPath.rb());
+        createDirectoryPath(outputPath);
+
+        fprintf(stderr, "Corpus: %d files, %.2f MiB, %lld tables, %lld symbols\n",
+            options.corpus.fileCount, (double) corpus.byteCount() / (1 << 20), corpus.tableCount(), corpus.symbolCount());
+
+        vector<double> fileMilliseconds;
+        runExtraction(corpusPath, outputPath, corpus, &fileMilliseconds);  // warming up
+        fileMilliseconds.clear();
+
+        vector<RunResult> runs;
+        vector<double> mibPerSecond, filesPerSecond, symbolsPerSecond;
+
+        for (int run = 0; run < options.runCount; run++)
+        {
+            RunResult result = runExtraction(corpusPath, outputPath, corpus, &fileMilliseconds);
+            runs.push_back(result);
+            mibPerSecond.push_back(result.mibPerSecond);
+            filesPerSecond.push_back(result.filesPerSecond);
+            symbolsPerSecond.push_back(result.symbolsPerSecond);
+
+            fprintf(stderr, "Run %d: %.3f s, %.2f MiB/s, %.1f files/s, %.0f symbols/s\n",
+                run + 1, result.seconds, result.mibPerSecond, result.filesPerSecond, result.symbolsPerSecond);
+        }
+
+        const CorpusParameters & parameters = options.corpus;
+
+        String json = "{\n";
+        json.appendFormatted("  \"parameters\": { \"seed\": %d, \"files\": %d, \"fileSizeKiB\": %d, \"density\": %d, \"tableSize\": %d, "
+            "\"formats\": \"%s\", \"sized\": %d, \"underscores\": %d, \"noise\": %d, \"runs\": %d, \"jobs\": %d },\n",
+            parameters.seed, parameters.fileCount, parameters.fileSize, parameters.density, parameters.tableSize,
+            parameters.formats.c_str(), parameters.sizedRatio, parameters.underscoreRatio, parameters.noise, options.runCount, jobCount);
+        json.appendFormatted("  \"corpus\": { \"bytes\": %lld, \"tables\": %lld, \"symbols\": %lld },\n",
+            corpus.byteCount(), corpus.tableCount(), corpus.symbolCount());
+        json.append("  \"runs\": [");
+
+        for (size_t index = 0; index < runs.size(); index++)
+            json.appendFormatted("%s\n    { \"seconds\": %.6f, \"mibPerSecond\": %.3f, \"filesPerSecond\": %.3f, \"symbolsPerSecond\": %.3f }",
+                index ? "," : "", runs[index].seconds, runs[index].mibPerSecond, runs[index].filesPerSecond, runs[index].symbolsPerSecond);
+
+        json.append("\n  ],\n");
+        json.appendFormatted("  \"mibPerSecond\": %s,\n", percentilesAsJson(mibPerSecond).rb());
+        json.appendFormatted("  \"filesPerSecond\": %s,\n", percentilesAsJson(filesPerSecond).rb());
+        json.appendFormatted("  \"symbolsPerSecond\": %s,\n", percentilesAsJson(symbolsPerSecond).rb());
+        json.appendFormatted("  \"fileMilliseconds\": %s\n", percentilesAsJson(fileMilliseconds).rb());
+        json.append("}\n");
+
+        if (options.outputFilePath.isEmpty())
+            fputs(json.rb(), stdout);
+        else
+        {
+            ofstream file(options.outputFilePath.rb(), ios::out | ios::binary);
+            file.write(json.rb(), json.length());
+
+            if (!file)
+                throw String::formatted(lf("Can't write file \"%s\"."), options.outputFilePath.rb());
+        }
+
+        return 0;
+    }
+    catch (String message) {
+        printError(message);
+        return 1;
+    }
+    catch (exception error) {
+        printError(error.what());
+        return 1;
+    }
+}
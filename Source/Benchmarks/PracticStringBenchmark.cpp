@@ -0,0 +1,338 @@
+// Microbenchmarks of Practic::String compared with std::string and std::string_view.
+// Copyright (c) 2020 Stanislav Jurny (github.com/STjurny) licence MIT
+
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <PracticString.h>
+
+using namespace std;
+using namespace Practic;
+
+
+
+// Measuring //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Each operation is run in batches until the batch takes at least minBatchTime. The best time per operation of more
+// batches is reported because it is the least affected by other processes. Results of operations are added to sink
+// so the compiler can't remove the measured code.
+
+const double minBatchTime = 0.05;  // seconds
+const int batchCount = 5;
+
+volatile size_t sink = 0;
+
+
+struct BenchmarkResult
+{
+    string name;
+    string implementation;
+    long long operationCount;  // operations in the best batch
+    double nanosecondsPerOperation;
+};
+
+
+class Benchmark
+{
+    public:
+        Benchmark(String aFilter)
+        {
+            fFilter = aFilter;
+        }
+
+        // Measures anOperation which returns a value derived from its result (e.g. length of created string).
+        void run(const char * aName, const char * anImplementation, const function<size_t ()> & anOperation)
+        {
+            if (!fFilter.isEmpty() && !StringView(aName).contains(fFilter.view()))
+                return;
+
+            long long operationCount = 1;
+            double seconds = 0;
+
+            while (true)  // count of operations in batch is doubled until the batch is long enough
+            {
+                seconds = measureBatch(anOperation, operationCount);
+
+                if (seconds >= minBatchTime)
+                    break;
+
+                operationCount *= 2;
+            }
+
+            double bestSeconds = seconds;
+
+            for (int batch = 1; batch < batchCount; batch++)
+                bestSeconds = min(bestSeconds, measureBatch(anOperation, operationCount));
+
+            BenchmarkResult result { aName, anImplementation, operationCount, bestSeconds * 1e9 / (double) operationCount };
+            fResults.push_back(result);
+
+            fprintf(stderr, "%-28s %-16s %10.2f ns\n", aName, anImplementation, result.nanosecondsPerOperation);
+        }
+
+        String resultsAsJson() const
+        {
+            String json = "{\n  \"benchmarks\": [";
+
+            for (size_t index = 0; index < fResults.size(); index++)
+            {
+                const BenchmarkResult & result = fResults[index];
+
+                json.appendFormatted(
+                    "%s\n    { \"name\": \"%s\", \"implementation\": \"%s\", \"operations\": %lld, \"nsPerOperation\": %.3f }",
+                    index ? "," : "", result.name.c_str(), result.implementation.c_str(), result.operationCount, result.nanosecondsPerOperation);
+            }
+
+            json.append("\n  ]\n}\n");
+
+            return json;
+        }
+
+    private:
+        static double measureBatch(const function<size_t ()> & anOperation, long long anOperationCount)
+        {
+            size_t sum = 0;
+            auto startTime = chrono::steady_clock::now();
+
+            for (long long index = 0; index < anOperationCount; index++)
+                sum += anOperation();
+
+            auto endTime = chrono::steady_clock::now();
+            sink = sink + sum;
+
+            return chrono::duration<double>(endTime - startTime).count();
+        }
+
+    private:
+        String fFilter;
+        vector<BenchmarkResult> fResults;
+};
+
+
+
+// Test Data //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Text resembling verilog source (the workload of SymbolEx) which is searched, split and replaced.
+string buildSourceText()
+{
+    string text;
+
+    for (int index = 0; index < 200; index++)
+    {
+        char line[128];
+        snprintf(line, sizeof(line), "    sState%03d = 8'h%02X, // state number %d of the machine\n", index, index & 0xFF, index);
+        text += line;
+    }
+
+    text += "    sLastState = 8'hFF; // SymbolEx marker at the end\n";
+
+    return text;
+}
+
+
+bool equalsIgnoringCase(string_view aFirst, string_view aSecond)
+{
+    return aFirst.size() == aSecond.size() &&
+        equal(aFirst.begin(), aFirst.end(), aSecond.begin(), [](char aChar, char anOther) { return tolower((unsigned char) aChar) == tolower((unsigned char) anOther); });
+}
+
+
+size_t findIgnoringCase(string_view aText, string_view aSubstring)
+{
+    auto position = search(aText.begin(), aText.end(), aSubstring.begin(), aSubstring.end(),
+        [](char aChar, char anOther) { return tolower((unsigned char) aChar) == tolower((unsigned char) anOther); });
+
+    return position == aText.end() ? string_view::npos : (size_t) (position - aText.begin());
+}
+
+
+void replaceAll(string * ioText, const string & aFound, const string & aReplacement)
+{
+    for (size_t position = ioText->find(aFound); position != string::npos; position = ioText->find(aFound, position + aReplacement.size()))
+        ioText->replace(position, aFound.size(), aReplacement);
+}
+
+
+
+// Benchmarks /////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void runBenchmarks(Benchmark * ioBenchmark)
+{
+    const char * practic = "Practic::String";
+    const char * standard = "std::string";
+
+    string stdSource = buildSourceText();
+    String source = stdSource.c_str();
+    string_view sourceView = stdSource;
+
+    // Construction
+
+    ioBenchmark->run("constructShortLiteral", practic, [] { String text = ls("sIdle"); return (size_t) text.length(); });
+    ioBenchmark->run("constructShortLiteral", standard, [] { string text = "sIdle"; return text.size(); });
+
+    ioBenchmark->run("constructLongLiteral", practic, [] {
+        String text = ls("localparam // $StateOfTransmitter:4,s"); return (size_t) text.length(); });
+    ioBenchmark->run("constructLongLiteral", standard, [] {
+        string text = "localparam // $StateOfTransmitter:4,s"; return text.size(); });
+
+    ioBenchmark->run("constructLongCString", practic, [] {
+        const char * chars = "localparam // $StateOfTransmitter:4,s"; String text = chars; return (size_t) text.length(); });
+    ioBenchmark->run("constructLongCString", standard, [] {
+        const char * chars = "localparam // $StateOfTransmitter:4,s"; string text = chars; return text.size(); });
+
+    // Appending
+
+    ioBenchmark->run("appendChain", practic, [] {
+        String text;
+        for (int index = 0; index < 16; index++)
+            text.append("sStateName");
+        return (size_t) text.length();
+    });
+    ioBenchmark->run("appendChain", standard, [] {
+        string text;
+        for (int index = 0; index < 16; index++)
+            text.append("sStateName");
+        return text.size();
+    });
+
+    String prefix = "SerialTransmitter", separator = ".", name = "StateOfTransmitter", extension = ".txt";
+    string stdPrefix = "SerialTransmitter", stdSeparator = ".", stdName = "StateOfTransmitter", stdExtension = ".txt";
+
+    ioBenchmark->run("plusChain", practic, [&] { String text = prefix + separator + name + extension; return (size_t) text.length(); });
+    ioBenchmark->run("plusChain", standard, [&] { string text = stdPrefix + stdSeparator + stdName + stdExtension; return text.size(); });
+
+    // Substrings
+
+    ioBenchmark->run("substringFrom", practic, [&] { String text = source.substringFrom(1000, 40); return (size_t) text.length(); });
+    ioBenchmark->run("substringFrom", standard, [&] { string text = stdSource.substr(1000, 40); return text.size(); });
+    ioBenchmark->run("substringFrom", "std::string_view", [&] { string_view text = sourceView.substr(1000, 40); return text.size(); });
+
+    // Searching
+
+    ioBenchmark->run("indexOfCaseSensitive", practic, [&] { return (size_t) source.indexOf("SymbolEx"); });
+    ioBenchmark->run("indexOfCaseSensitive", standard, [&] { return stdSource.find("SymbolEx"); });
+
+    ioBenchmark->run("indexOfCaseInsensitive", practic, [&] { return (size_t) source.indexOf("symbolex", caseInsensitive); });
+    ioBenchmark->run("indexOfCaseInsensitive", "std::string_view", [&] { return findIgnoringCase(sourceView, "symbolex"); });
+
+    ioBenchmark->run("indexOfChar", practic, [&] { return (size_t) source.indexOf(';'); });
+    ioBenchmark->run("indexOfChar", standard, [&] { return stdSource.find(';'); });
+
+    // Replacing
+
+    ioBenchmark->run("replace", practic, [&] { String text = source; text.replace("sState", "stateOf"); return (size_t) text.length(); });
+    ioBenchmark->run("replace", standard, [&] { string text = stdSource; replaceAll(&text, "sState", "stateOf"); return text.size(); });
+
+    // Splitting
+
+    ioBenchmark->run("nextPart", practic, [&] {
+        size_t count = 0;
+        int index = 0;
+        String part;
+        while (source.nextPart(&part, &index, ","))
+            count += part.length();
+        return count;
+    });
+    ioBenchmark->run("nextPart", "std::string_view", [&] {
+        size_t count = 0;
+        for (size_t start = 0, end; start <= sourceView.size(); start = end + 1)
+        {
+            end = sourceView.find(',', start);
+            if (end == string_view::npos)
+                end = sourceView.size();
+            count += end - start;
+        }
+        return count;
+    });
+
+    ioBenchmark->run("part", practic, [&] { String text = source.part(100, ","); return (size_t) text.length(); });
+    ioBenchmark->run("part", standard, [&] {
+        size_t start = 0;
+        for (int index = 0; index < 100 && start != string::npos; index++)
+        {
+            start = stdSource.find(',', start);
+            if (start != string::npos)
+                start += 1;
+        }
+        if (start == string::npos)
+            return (size_t) 0;
+        string text = stdSource.substr(start, stdSource.find(',', start) - start);
+        return text.size();
+    });
+
+    // Formatting
+
+    ioBenchmark->run("formatted", practic, [] {
+        String text = String::formatted(lf("%s.%s = %08X"), "SerialTransmitter", "sStartBit", 0x1234u); return (size_t) text.length(); });
+    ioBenchmark->run("formatted", standard, [] {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%s.%s = %08X", "SerialTransmitter", "sStartBit", 0x1234u);
+        string text = buffer;
+        return text.size();
+    });
+
+    // Copying
+
+    ioBenchmark->run("copy", practic, [&] { String text = source; return (size_t) text.length(); });
+    ioBenchmark->run("copy", standard, [&] { string text = stdSource; return text.size(); });
+
+    ioBenchmark->run("copyAndDetach", practic, [&] { String text = source; text[0] = 'x'; return (size_t) text.length(); });
+    ioBenchmark->run("copyAndDetach", standard, [&] { string text = stdSource; text[0] = 'x'; return text.size(); });
+
+    // Comparing
+
+    String first = source.substringFrom(0, 200), second = source.substringFrom(0, 200);
+    string stdFirst = stdSource.substr(0, 200), stdSecond = stdSource.substr(0, 200);
+
+    ioBenchmark->run("equals", practic, [&] { return (size_t) (first == second); });
+    ioBenchmark->run("equals", standard, [&] { return (size_t) (stdFirst == stdSecond); });
+
+    ioBenchmark->run("equalsCaseInsensitive", practic, [&] { return (size_t) first.equals(second, caseInsensitive); });
+    ioBenchmark->run("equalsCaseInsensitive", "std::string_view", [&] { return (size_t) equalsIgnoringCase(stdFirst, stdSecond); });
+}
+
+
+
+// Main ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Syntax: PracticStringBenchmark [--filter name_part] [output_file.json]
+// Results are written as JSON to the output file (or to standard output), progress is printed to standard error.
+int main(int argc, char * argv[])
+{
+    String filter;
+    String outputFilePath;
+
+    for (int index = 1; index < argc; index++)
+        if (strcmp(argv[index], "--filter") == 0 && index + 1 < argc)
+            filter = argv[++index];
+        else
+            outputFilePath = argv[index];
+
+    Benchmark benchmark(filter);
+    runBenchmarks(&benchmark);
+
+    String json = benchmark.resultsAsJson();
+
+    if (outputFilePath.isEmpty())
+        fputs(json.rb(), stdout);
+    else
+    {
+        ofstream file(outputFilePath.rb(), ios::out | ios::binary);
+        file.write(json.rb(), json.length());
+
+        if (!file)
+        {
+            fprintf(stderr, "Can not write file \"%s\".\n", outputFilePath.rb());
+            return 1;
+        }
+    }
+
+    return 0;
+}
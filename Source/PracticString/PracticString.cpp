@@ -8,8 +8,24 @@
 #include <cassert>
 #include <cctype>
 #include <climits>
+#include <mutex>
+#include <atomic>
 #include "PracticString.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define PRACTIC_STRING_SSE2
+    #include <emmintrin.h>
+#endif
+
+#ifdef __AVX2__
+    #define PRACTIC_STRING_AVX2
+    #include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
 
 #pragma warning(disable : 4996)  // Turn of MSVC deprecation warning C4996
 
@@ -49,2115 +65,3984 @@ void String::defaultOutOfMemoryHandler(size_t aRequestedSize)
 
 
 
-// Char Test Functions ////////////////////////////////////////////////////////////////////////////////////////////////
+// Memory Instrumentation /////////////////////////////////////////////////////////////////////////////////////////////
+
+void (*String::onMemoryEvent)(MemoryEvent anEvent, size_t aSize, size_t aPreviousSize) = NULL;
 
-bool charIsContainedIn(char aChar, void * aChars)
+
+static inline void reportMemoryEvent(MemoryEvent anEvent, size_t aSize, size_t aPreviousSize = 0)
 {
-    if (aChars)
-        return strchr((const char *)aChars, aChar);
-    else
-        return false;
+    if (String::onMemoryEvent)
+        String::onMemoryEvent(anEvent, aSize, aPreviousSize);
 }
 
 
-bool charIsNotContainedIn(char aChar, void * aChars)
+void _MemoryCounters::add(MemoryEvent anEvent, size_t aSize, size_t aPreviousSize, bool aCountsCurrentBytes)
 {
-    if (aChars)
-        return !strchr((const char *)aChars, aChar);
-    else
-        return true;
+    long long sizeChange = 0;
+
+    switch (anEvent)
+    {
+        case meAllocation:
+            allocationCount.fetch_add(1, std::memory_order_relaxed);
+            allocatedBytes.fetch_add((long long) aSize, std::memory_order_relaxed);
+            sizeChange = (long long) aSize;
+            break;
+
+        case meReallocation:
+            reallocationCount.fetch_add(1, std::memory_order_relaxed);
+            sizeChange = (long long) aSize - (long long) aPreviousSize;
+
+            if (sizeChange > 0)
+                allocatedBytes.fetch_add(sizeChange, std::memory_order_relaxed);
+            break;
+
+        case meRelease:
+            releaseCount.fetch_add(1, std::memory_order_relaxed);
+            sizeChange = -(long long) aSize;
+            break;
+
+        case meDetach:
+            detachCount.fetch_add(1, std::memory_order_relaxed);
+            break;
+    }
+
+    if (aCountsCurrentBytes && sizeChange != 0)
+    {
+        long long current = currentBytes.fetch_add(sizeChange, std::memory_order_relaxed) + sizeChange;
+        long long peak = peakBytes.load(std::memory_order_relaxed);
+
+        while (current > peak && !peakBytes.compare_exchange_weak(peak, current, std::memory_order_relaxed));
+    }
 }
 
 
-String::ParameterizedCharTestFunction String::checkingFunctionFor(CharTestCondition aCondition)
+MemoryCounts _MemoryCounters::counts() const
 {
-    if (aCondition == containedIn)
-        return charIsContainedIn;
-    else
-        return charIsNotContainedIn;
+    MemoryCounts result;
+    result.allocationCount = allocationCount.load(std::memory_order_relaxed);
+    result.reallocationCount = reallocationCount.load(std::memory_order_relaxed);
+    result.releaseCount = releaseCount.load(std::memory_order_relaxed);
+    result.detachCount = detachCount.load(std::memory_order_relaxed);
+    result.allocatedBytes = allocatedBytes.load(std::memory_order_relaxed);
+    result.currentBytes = currentBytes.load(std::memory_order_relaxed);
+    result.peakBytes = peakBytes.load(std::memory_order_relaxed);
+    return result;
 }
 
 
-bool testFunctionReturnsTrue(char aChar, void * aTestFunction)
+void _MemoryCounters::reset()
 {
-    return ((CharTestFunction)aTestFunction)(aChar);
+    allocationCount = 0;
+    reallocationCount = 0;
+    releaseCount = 0;
+    detachCount = 0;
+    allocatedBytes = 0;
+    currentBytes = 0;
+    peakBytes = 0;
 }
 
 
-bool testFunctionReturnsFalse(char aChar, void * aTestFunction)
+static _MemoryCounters memoryTotal;
+static MemoryTag * firstMemoryTag = NULL;
+static thread_local MemoryTag * currentMemoryTag = NULL;
+
+
+// Guards list of tags. The mutex is never destroyed so tags can be created and destroyed during static initialization 
+// and destruction.
+static std::mutex & memoryTagsMutex()
 {
-    return !((CharTestFunction)aTestFunction)(aChar);
+    static std::mutex * mutex = new std::mutex;
+    return *mutex;
 }
 
 
-String::ParameterizedCharTestFunction String::checkingFunctionFor(CharTestFunction aTestFunction, bool aResult)
+MemoryTag::MemoryTag(const char * aName): fName(aName)
 {
-    if (!aTestFunction)
-        return NULL;
-    else
-        if (aResult)
-            return testFunctionReturnsTrue;
-        else
-            return testFunctionReturnsFalse;
+    std::lock_guard<std::mutex> lock(memoryTagsMutex());
+    fNextTag = firstMemoryTag;
+    firstMemoryTag = this;
 }
 
 
+MemoryTag::~MemoryTag()
+{
+    if (currentMemoryTag == this)
+        currentMemoryTag = NULL;
 
+    std::lock_guard<std::mutex> lock(memoryTagsMutex());
 
+    for (MemoryTag ** link = &firstMemoryTag; *link; link = &(*link)->fNextTag)
+        if (*link == this)
+        {
+            *link = fNextTag;
+            break;
+        }
+}
 
-// Case Insensitive Search ////////////////////////////////////////////////////////////////////////////////////////////
 
-const char * strichr(const char * aString, int aChar)
+void MemoryAccounting::start()
 {
-    const char * currentChar = aString;
-    char searchedChar = String::onToLower(aChar);
+    String::onMemoryEvent = count;
+}
 
-    do {
-        if (String::onToLower(*currentChar) == searchedChar)
-            return currentChar;
-    } while (*currentChar++);
 
-    return NULL;
+void MemoryAccounting::stop()
+{
+    String::onMemoryEvent = NULL;
 }
 
 
-const char * stristr(const char * aString, const char * aSubstring) 
+void MemoryAccounting::reset()
 {
-    do  {
-        const char * stringChar = aString;
-        const char * substringChar = aSubstring;
+    memoryTotal.reset();
 
-        while (String::onToLower(*stringChar) == String::onToLower(*substringChar) && *substringChar) 
-        {
-            stringChar++;
-            substringChar++;
-        }
+    std::lock_guard<std::mutex> lock(memoryTagsMutex());
 
-        if (*substringChar == '\0') 
-            return aString;
+    for (MemoryTag * tag = firstMemoryTag; tag; tag = tag->fNextTag)
+        tag->fCounters.reset();
+}
 
-    } while (*aString++);
 
-    return NULL;
+MemoryCounts MemoryAccounting::total()
+{
+    return memoryTotal.counts();
 }
 
 
-char * findSubstring(const char * aString, const char * aSubstring, EqualityMode aMode)
+void MemoryAccounting::forEachTag(const std::function<void (const MemoryTag & aTag)> & aVisitor)
 {
-    if (aMode == caseSensitive)
-        return (char*) strstr(aString, aSubstring);
-    else
-        return (char*) stristr(aString, aSubstring);
+    std::lock_guard<std::mutex> lock(memoryTagsMutex());
+
+    for (MemoryTag * tag = firstMemoryTag; tag; tag = tag->fNextTag)
+        aVisitor(*tag);
+}
+
+
+MemoryTag * MemoryAccounting::setCurrentTag(MemoryTag * aTag)
+{
+    MemoryTag * previousTag = currentMemoryTag;
+    currentMemoryTag = aTag;
+    return previousTag;
 }
 
 
+void MemoryAccounting::count(MemoryEvent anEvent, size_t aSize, size_t aPreviousSize)
+{
+    memoryTotal.add(anEvent, aSize, aPreviousSize, true);
 
+    if (currentMemoryTag)
+        currentMemoryTag->fCounters.add(anEvent, aSize, aPreviousSize, false);  // block can be released under other tag
+}
 
 
-// Internal Types /////////////////////////////////////////////////////////////////////////////////////////////////////
 
-#define self (*this)
-#define isEmptyCString(cstring) (!cstring[0])
 
-#define asLiteral(pointer) ((char *) pointer)
-#define asAllocation(pointer) ((_Allocation *) pointer)
- 
 
-enum LengthCacheState
+// Char Test Functions ////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Set of characters for testing characters contained (or not contained) in a view without searching the view for each tested character.
+struct CharSet
 {
-    csUnknown = -1,
-    csDisabled = -2
+    uint32_t bits[8];
+
+    CharSet(StringView aChars, CharTestCondition aCondition)
+    {
+        memset(bits, aCondition == containedIn ? 0x00 : 0xFF, sizeof(bits));
+
+        for (int index = 0; index < aChars.length(); index++)
+        {
+            unsigned char setChar = aChars[index];
+
+            if (aCondition == containedIn)
+                bits[setChar >> 5] |= 1u << (setChar & 31);
+            else
+                bits[setChar >> 5] &= ~(1u << (setChar & 31));
+        }
+    }
+
+    inline bool operator () (char aChar) const
+    {
+        unsigned char testedChar = aChar;
+        return bits[testedChar >> 5] & (1u << (testedChar & 31));
+    }
 };
 
 
+// Adapter of CharTestFunction to the form used by StringView methods.
+struct CharTest
+{
+    CharTestFunction function;
+    bool result;
 
+    inline bool operator () (char aChar) const
+    {
+        return (function(aChar) != 0) == result;
+    }
+};
 
 
-// Lifecycle //////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-const String String::null = String(NULL, true);
 
-const String String::empty = String();
 
 
-String::String()
-{
-    data.asFields.mode = smInner;
-    data.asCharsBuffer[0] = '\0';
-}
 
+// ASCII Case Folding /////////////////////////////////////////////////////////////////////////////////////////////////
 
-String::String(char aChar)
+inline int lowestSetBitIndex(unsigned int aMask)
 {
-    data.asFields.mode = smInner;
-    data.asCharsBuffer[0] = aChar;
-    data.asCharsBuffer[1] = '\0';
+    #ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, aMask);
+        return index;
+    #else
+        return __builtin_ctz(aMask);
+    #endif
 }
 
 
-String::String(const char * aCString, bool aCStringIsLiteral) 
+// Lookup table for conversion of letters in range aFirst..aLast by adding aShift (other characters are unchanged).
+struct AsciiCaseTable
 {
-    if (aCString == NULL)
-        setLiteral(NULL);
-    else 
-        if (isEmptyCString(aCString))
-            setInner("");
-        else
-            if (aCStringIsLiteral)
-                setLiteral(aCString);
-            else
-            {
-                int length = strlen(aCString);
-                setBuffer(length);
-                copyFrom(aCString, length);
-            }
-}
+    unsigned char chars[256];
 
+    constexpr AsciiCaseTable(char aFirst, char aLast, int aShift): chars()
+    {
+        for (int index = 0; index < 256; index++)
+            chars[index] = (unsigned char) (index >= aFirst && index <= aLast ? index + aShift : index);
+    }
+};
 
-String::String(const char * aCString, int aMaxLength) 
-{
-    if (aCString == NULL)
-        setLiteral(NULL);
-    else 
-        if (aMaxLength <= 0 || isEmptyCString(aCString))
-            setInner("");
-        else
-            if (aMaxLength == 1)
-            {
-                char chars[] = { aCString[0], '\0' };
-                setInner(chars);
-            }
-            else
-            {
-                int actualLength = strnlen(aCString, aMaxLength);
-                setBuffer(actualLength);
-                copyFrom(aCString, actualLength);
-            }
-}
 
+constexpr AsciiCaseTable asciiLowerTable('A', 'Z', 'a' - 'A');
+constexpr AsciiCaseTable asciiUpperTable('a', 'z', 'A' - 'a');
 
-String::String(const String & aString) 
+
+// Returns true if case insensitive methods can use built-in ASCII folding instead of calling String::onToLower for each character.
+inline bool usesAsciiFolding()
 {
-    retain(aString);
+    return String::onToLower == String::asciiToLower;
 }
 
 
-String::~String() 
+inline bool usesAsciiConversion(LetterCase aLetterCase)
 {
-    release();
+    if (aLetterCase == upperCase)
+        return String::onToUpper == String::asciiToUpper;
+    else
+        return String::onToLower == String::asciiToLower;
 }
 
 
+#ifdef PRACTIC_STRING_SSE2
+    // Returns mask of characters in range aFirst..aLast (both must be ASCII, so characters above 127 are never in the range).
+    inline __m128i charsInRange(__m128i aChars, char aFirst, char aLast)
+    {
+        return _mm_and_si128(_mm_cmpgt_epi8(aChars, _mm_set1_epi8(aFirst - 1)), _mm_cmplt_epi8(aChars, _mm_set1_epi8(aLast + 1)));
+    }
 
 
+    inline __m128i shiftCharsInRange(__m128i aChars, char aFirst, char aLast, char aShift)
+    {
+        return _mm_add_epi8(aChars, _mm_and_si128(charsInRange(aChars, aFirst, aLast), _mm_set1_epi8(aShift)));
+    }
 
-// Managing Capacity //////////////////////////////////////////////////////////////////////////////////////////////////
 
-String String::withCapacity(int aRequiredCapacity)
-{
-    String s;
+    inline __m128i asciiLowerBlock(__m128i aChars)
+    {
+        return shiftCharsInRange(aChars, 'A', 'Z', 'a' - 'A');
+    }
+#endif
 
-    if (aRequiredCapacity > innerCapacity)
-        s.setAllocation(aRequiredCapacity, "");
 
-    return s;
-}
+#ifdef PRACTIC_STRING_AVX2
+    inline __m256i charsInRange(__m256i aChars, char aFirst, char aLast)
+    {
+        return _mm256_and_si256(_mm256_cmpgt_epi8(aChars, _mm256_set1_epi8(aFirst - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(aLast + 1), aChars));
+    }
 
 
-void String::reserveCapacity(int aRequiredCapacity, bool aCopyOriginal, bool anAllowShrink) 
+    inline __m256i shiftCharsInRange(__m256i aChars, char aFirst, char aLast, char aShift)
+    {
+        return _mm256_add_epi8(aChars, _mm256_and_si256(charsInRange(aChars, aFirst, aLast), _mm256_set1_epi8(aShift)));
+    }
+#endif
+
+
+// Returns index of first letter which would be changed by conversion to aLetterCase or notFound.
+int asciiIndexOfConvertible(const char * aChars, int aLength, LetterCase aLetterCase)
 {
-    if (aRequiredCapacity <= capacity() && aCopyOriginal && !anAllowShrink)
-        return;  // prevents premature allocating buffer but same behaviour as method "wb"
+    const char first = aLetterCase == upperCase ? 'a' : 'A';
+    const char last = aLetterCase == upperCase ? 'z' : 'Z';
+    int index = 0;
 
-    uniquate(aRequiredCapacity, aCopyOriginal, anAllowShrink);  
-}
+    #ifdef PRACTIC_STRING_SSE2
+        for (; index + 16 <= aLength; index += 16)
+        {
+            unsigned int found = _mm_movemask_epi8(charsInRange(_mm_loadu_si128((const __m128i *) (aChars + index)), first, last));
 
+            if (found)
+                return index + lowestSetBitIndex(found);
+        }
+    #endif
 
-void String::minimizeCapacity() 
-{
-    if (references() == 1)
-        uniquate(0, true, true);
+    for (; index < aLength; index++)
+        if (aChars[index] >= first && aChars[index] <= last)
+            return index;
+
+    return notFound;
 }
 
 
+void asciiConvert(char * ioChars, int aLength, LetterCase aLetterCase)
+{
+    const char first = aLetterCase == upperCase ? 'a' : 'A';
+    const char last = aLetterCase == upperCase ? 'z' : 'Z';
+    const char shift = aLetterCase == upperCase ? 'A' - 'a' : 'a' - 'A';
+    int index = 0;
 
+    #ifdef PRACTIC_STRING_AVX2
+        for (; index + 32 <= aLength; index += 32)
+        {
+            __m256i * block = (__m256i *) (ioChars + index);
+            _mm256_storeu_si256(block, shiftCharsInRange(_mm256_loadu_si256(block), first, last, shift));
+        }
+    #endif
 
+    #ifdef PRACTIC_STRING_SSE2
+        for (; index + 16 <= aLength; index += 16)
+        {
+            __m128i * block = (__m128i *) (ioChars + index);
+            _mm_storeu_si128(block, shiftCharsInRange(_mm_loadu_si128(block), first, last, shift));
+        }
+    #endif
 
-// Properties /////////////////////////////////////////////////////////////////////////////////////////////////////////
+    const AsciiCaseTable & table = aLetterCase == upperCase ? asciiUpperTable : asciiLowerTable;
 
-int String::capacity() const  // don't use this method in basic manipulations because it has side efects
-{
-    if (data.asFields.mode == smInner)
-        return innerCapacity;
-    else
-        if (data.asFields.mode == smLiteral)
-            return length();
-        else
-            return data.asFields.size - 1;
+    for (; index < aLength; index++)
+        ioChars[index] = table.chars[(unsigned char) ioChars[index]];
 }
 
 
-int String::length() const  // don't use this method in basic manipulations because it has side efects
+bool asciiCharsEqualIgnoringCase(const char * aFirst, const char * aSecond, ViewIndex aLength)
 {
-    int result;
+    ViewIndex index = 0;
 
-    if (data.asFields.mode == smInner)
-        result = strlen(data.asCharsBuffer);
-    else
-    {    
-        if (data.asFields.lengthCache != csUnknown && data.asFields.lengthCache != csDisabled)
-            result = data.asFields.lengthCache;
-        else
+    #ifdef PRACTIC_STRING_AVX2
+        for (; index + 32 <= aLength; index += 32)
         {
-            if (data.asFields.pointer == NULL)
-                result = 0;
-            else
-            {
-                char * charsBuffer;     
+            __m256i first = shiftCharsInRange(_mm256_loadu_si256((const __m256i *) (aFirst + index)), 'A', 'Z', 'a' - 'A');
+            __m256i second = shiftCharsInRange(_mm256_loadu_si256((const __m256i *) (aSecond + index)), 'A', 'Z', 'a' - 'A');
 
-                if (data.asFields.mode == smLiteral)
-                    charsBuffer = asLiteral(data.asFields.pointer);
-                else
-                    charsBuffer = asAllocation(data.asFields.pointer)->buffer;
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(first, second)) != -1)
+                return false;
+        }
+    #endif
 
-                result = strlen(charsBuffer);
-            }
+    #ifdef PRACTIC_STRING_SSE2
+        for (; index + 16 <= aLength; index += 16)
+        {
+            __m128i first = asciiLowerBlock(_mm_loadu_si128((const __m128i *) (aFirst + index)));
+            __m128i second = asciiLowerBlock(_mm_loadu_si128((const __m128i *) (aSecond + index)));
 
-            if (data.asFields.lengthCache != csDisabled)
-                data.asFields.lengthCache = result;
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(first, second)) != 0xFFFF)
+                return false;
         }
-    }    
+    #endif
 
-    debug_assert(isNull() || isEmpty() ? result == 0 : result == strlen(rb()));
+    for (; index < aLength; index++)
+        if (asciiLowerTable.chars[(unsigned char) aFirst[index]] != asciiLowerTable.chars[(unsigned char) aSecond[index]])
+            return false;
 
-    return result;
+    return true;
 }
 
 
-bool String::isNull() const 
+const char * asciiFindCharIgnoringCase(const char * aChars, ViewIndex aLength, char aChar)
 {
-    return data.asFields.mode == smLiteral && asLiteral(data.asFields.pointer) == NULL;
-}
+    const char lowerChar = asciiLowerTable.chars[(unsigned char) aChar];
+    const char upperChar = asciiUpperTable.chars[(unsigned char) aChar];
 
+    if (lowerChar == upperChar)
+        return (const char *) memchr(aChars, aChar, aLength);
 
-bool String::isEmpty() const
-{
-    if (data.asFields.mode == smInner)
-        return data.asCharsBuffer[0] == '\0';
-    else
-        if (data.asFields.mode == smAllocation)
-            return asAllocation(data.asFields.pointer)->buffer[0] == '\0';
-        else
-            if (asLiteral(data.asFields.pointer) == NULL)
-                return false;
-            else
-                return asLiteral(data.asFields.pointer)[0] == '\0';
-}
+    ViewIndex index = 0;
 
+    #ifdef PRACTIC_STRING_SSE2
+        const __m128i lowerChars = _mm_set1_epi8(lowerChar);
+        const __m128i upperChars = _mm_set1_epi8(upperChar);
 
-int String::references() const 
-{
-    if (data.asFields.mode == smAllocation)
-        return asAllocation(data.asFields.pointer)->references;
-    else
-        return -1;
+        for (; index + 16 <= aLength; index += 16)
+        {
+            __m128i block = _mm_loadu_si128((const __m128i *) (aChars + index));
+            unsigned int found = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, lowerChars), _mm_cmpeq_epi8(block, upperChars)));
+
+            if (found)
+                return aChars + index + lowestSetBitIndex(found);
+        }
+    #endif
+
+    for (; index < aLength; index++)
+        if (aChars[index] == lowerChar || aChars[index] == upperChar)
+            return aChars + index;
+
+    return NULL;
 }
 
 
 
 
 
-// Basic Manipulations ////////////////////////////////////////////////////////////////////////////////////////////////
+// Substring Search ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-void String::setInner(const char * aCString) 
+// Canonical forms of characters compared by search algorithms. ExactChar is used for case sensitive search, AsciiFoldedChar 
+// for case insensitive search with default conversion functions and HookFoldedChar when String::onToLower is customized.
+// Canonical types used by findCharsFiltered provide also searching of single char, comparing of chars and SIMD conversion.
+struct ExactChar
 {
-    debug_assert(aCString);
-    debug_assert(strlen(aCString) <= innerCapacity);
+    inline unsigned char operator () (char aChar) const { return aChar; }
 
-    data.asFields.mode = smInner;
+    static inline const char * find(const char * aChars, ViewIndex aLength, char aChar) { return (const char *) memchr(aChars, aChar, aLength); }
+    static inline bool equal(const char * aFirst, const char * aSecond, ViewIndex aLength) { return !memcmp(aFirst, aSecond, aLength); }
 
-    if (aCString)
-        strcpy(data.asCharsBuffer, aCString);
-}
+    #ifdef PRACTIC_STRING_SSE2
+        static inline __m128i block(__m128i aChars) { return aChars; }
+    #endif
+};
 
 
-void String::setLiteral(const char * aCString) 
+struct AsciiFoldedChar
 {
-    data.asFields.mode = smLiteral;
-    data.asFields.lengthCache = csUnknown;
-    data.asFields.pointer = (void *) aCString;
-}
+    inline unsigned char operator () (char aChar) const { return asciiLowerTable.chars[(unsigned char) aChar]; }
 
+    static inline const char * find(const char * aChars, ViewIndex aLength, char aChar) { return asciiFindCharIgnoringCase(aChars, aLength, aChar); }
+    static inline bool equal(const char * aFirst, const char * aSecond, ViewIndex aLength) { return asciiCharsEqualIgnoringCase(aFirst, aSecond, aLength); }
 
-void String::setAllocation(int aCapacity, const char * aCString) 
+    #ifdef PRACTIC_STRING_SSE2
+        static inline __m128i block(__m128i aChars) { return asciiLowerBlock(aChars); }
+    #endif
+};
+
+
+struct HookFoldedChar
 {
-    debug_assert(aCString);
-    debug_assert(aCapacity >= 0);
-    debug_assert(aCapacity <= maxCapacity);
-    debug_assert(strlen(aCString) <= (unsigned) aCapacity);
+    inline unsigned char operator () (char aChar) const { return String::onToLower(aChar); }
+};
 
-    int size = aCapacity + 1;  // add one position for terminating null character
 
-    void * pointer = malloc(_Allocation::sizeForBufferSize(size));
+const char * findChar(const char * aChars, ViewIndex aLength, char aChar, EqualityMode aMode)
+{
+    if (aMode == caseSensitive)
+        return (const char *) memchr(aChars, aChar, aLength);
 
-    if (!pointer)
-        onOutOfMemory(size);
+    if (usesAsciiFolding())
+        return asciiFindCharIgnoringCase(aChars, aLength, aChar);
 
-    #pragma warning (suppress : 6011)  // suppress MSVC warning about referencing NULL pointer
-    strcpy(asAllocation(pointer)->buffer, aCString);  
-    asAllocation(pointer)->references = 1;
+    HookFoldedChar folded;
+    unsigned char searchedChar = folded(aChar);
+    const char * endChar = aChars + aLength;
 
-    data.asFields.mode = smAllocation;
-    data.asFields.size = size;
-    data.asFields.pointer = pointer;
-    #pragma warning (suppress : 6011)  // suppress MSVC warning about referencing NULL pointer
-    data.asFields.lengthCache = isEmptyCString(aCString) ? 0 : csUnknown;
+    for (const char * currentChar = aChars; currentChar < endChar; currentChar++)
+        if (folded(*currentChar) == searchedChar)
+            return currentChar;
+
+    return NULL;
 }
 
 
-inline void String::setBuffer(int aRequiredCapacity) 
+template <typename Canonical>
+inline bool charsEqualAs(const char * aFirst, const char * aSecond, ViewIndex aLength, Canonical aCanonical)
 {
-    if (aRequiredCapacity <= innerCapacity)
-        setInner("");
-    else
-        setAllocation(aRequiredCapacity, "");
+    for (ViewIndex index = 0; index < aLength; index++)
+        if (aCanonical(aFirst[index]) != aCanonical(aSecond[index]))
+            return false;
+
+    return true;
 }
 
 
-void String::retain(const String & anOther) 
+inline bool charsEqual(const char * aFirst, const char * aSecond, ViewIndex aLength, EqualityMode aMode)
 {
-    data = anOther.data;
-
-    if (data.asFields.mode == smAllocation)
-        asAllocation(data.asFields.pointer)->references += 1;
+    if (aMode == caseSensitive)
+        return !memcmp(aFirst, aSecond, aLength);
+    else
+        if (usesAsciiFolding())
+            return asciiCharsEqualIgnoringCase(aFirst, aSecond, aLength);
+        else
+            return charsEqualAs(aFirst, aSecond, aLength, HookFoldedChar());
 }
 
 
-void String::release() 
+// Critical factorization of searched substring for Two-Way search algorithm (Crochemore & Perrin).
+// The substring is splitted at criticalIndex to left and right part, period is (local) period of the substring.
+struct TwoWayFactorization
 {
-    if (data.asFields.mode == smAllocation) 
+    ViewIndex criticalIndex;
+    ViewIndex period;
+    bool isPeriodic;
+};
+
+
+// Computes maximal suffix of aSubstring for given ordering of characters (normal or reversed) and returns index before its start.
+template <typename Canonical>
+ViewIndex maximalSuffix(const char * aSubstring, ViewIndex aLength, bool aReversedOrdering, ViewIndex * oPeriod, Canonical aCanonical)
+{
+    ViewIndex suffix = -1;
+    ViewIndex index = 0;
+    ViewIndex offset = 1;
+    ViewIndex period = 1;
+
+    while (index + offset < aLength)
     {
-        asAllocation(data.asFields.pointer)->references -= 1;
+        unsigned char currentChar = aCanonical(aSubstring[index + offset]);
+        unsigned char suffixChar = aCanonical(aSubstring[suffix + offset]);
 
-        if (asAllocation(data.asFields.pointer)->references == 0)
-            free(data.asFields.pointer);
+        if (aReversedOrdering ? suffixChar < currentChar : currentChar < suffixChar)
+        {
+            index += offset;
+            offset = 1;
+            period = index - suffix;
+        }
+        else
+            if (currentChar == suffixChar)
+            {
+                if (offset != period)
+                    offset++;
+                else
+                {
+                    index += period;
+                    offset = 1;
+                }
+            }
+            else
+            {
+                suffix = index++;
+                offset = period = 1;
+            }
     }
 
-    data.asFields.mode = smLiteral;  // remove reference to released allocation 
-    data.asFields.lengthCache = 0;   // and set fData to consistent state  
-    data.asFields.pointer = NULL;
+    *oPeriod = period;
+    return suffix;
 }
 
 
-void String::copyFrom(const char * aCString, int aLength) 
+template <typename Canonical>
+TwoWayFactorization factorize(const char * aSubstring, ViewIndex aLength, Canonical aCanonical)
 {
-    debug_assert(aCString);
-    debug_assert(data.asFields.mode != smLiteral);
-
-    char * buffer;
-    if (data.asFields.mode == smInner)
-    {
-        debug_assert(aLength <= innerCapacity);
-        debug_assert(strnlen(aCString, aLength) <= innerCapacity);
+    ViewIndex period;
+    ViewIndex reversedPeriod;
+    ViewIndex suffix = maximalSuffix(aSubstring, aLength, false, &period, aCanonical);
+    ViewIndex reversedSuffix = maximalSuffix(aSubstring, aLength, true, &reversedPeriod, aCanonical);
 
-        buffer = data.asCharsBuffer;
-    }
-    else
+    if (reversedSuffix > suffix)
     {
-        debug_assert((unsigned) aLength < data.asFields.size);
-        debug_assert(strnlen(aCString, aLength) < data.asFields.size);
-
-        data.asFields.lengthCache = aLength;
-        buffer = asAllocation(data.asFields.pointer)->buffer;
+        suffix = reversedSuffix;
+        period = reversedPeriod;
     }
 
-    strncpy(buffer, aCString, aLength);
-    buffer[aLength] = '\0';
-}
-
-
+    TwoWayFactorization result;
+    result.criticalIndex = suffix + 1;
+    result.period = period;
+    result.isPeriodic = result.criticalIndex + period <= aLength && charsEqualAs(aSubstring, aSubstring + period, result.criticalIndex, aCanonical);
 
+    if (!result.isPeriodic)
+        result.period = (result.criticalIndex > aLength - result.criticalIndex ? result.criticalIndex : aLength - result.criticalIndex) + 1;
 
+    return result;
+}
 
-// Uniquating /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void String::uniquate(int aRequiredCapacity, bool aCopyOriginal, bool anAllowShrink) 
+// Two-Way search algorithm. It runs in linear time to aLength and needs only constant extra memory.
+template <typename Canonical>
+const char * searchTwoWay(const char * aChars, ViewIndex aLength, const char * aSubstring, ViewIndex aSubstringLength, const TwoWayFactorization & aFactorization, Canonical aCanonical)
 {
-    debug_assert(aRequiredCapacity <= maxCapacity);
+    const ViewIndex criticalIndex = aFactorization.criticalIndex;
+    const ViewIndex period = aFactorization.period;
+    const ViewIndex lastStart = aLength - aSubstringLength;
+    ViewIndex start = 0;
 
-    if (data.asFields.mode == smInner)
-        uniquateInner(aRequiredCapacity, aCopyOriginal);
-    else
-        if (data.asFields.mode == smLiteral)
-            uniquateLiteral(aRequiredCapacity, aCopyOriginal);
-        else
+    if (aFactorization.isPeriodic)
+    {
+        ViewIndex memory = 0;  // length of prefix of the substring which is known to match at current position
+
+        while (start <= lastStart)
         {
-            debug_assert(asAllocation(data.asFields.pointer)->references > 0);
+            ViewIndex index = criticalIndex > memory ? criticalIndex : memory;
 
-            if (asAllocation(data.asFields.pointer)->references == 1)
-                uniquateSingleReferenceAllocation(aRequiredCapacity, aCopyOriginal, anAllowShrink);
-            else
-                uniquateMultiReferenceAllocation(aRequiredCapacity, aCopyOriginal);
-        }
+            while (index < aSubstringLength && aCanonical(aSubstring[index]) == aCanonical(aChars[start + index]))
+                index++;
 
-    debug_assert(data.asFields.mode != smLiteral);
-}
+            if (index < aSubstringLength)
+            {
+                start += index - criticalIndex + 1;
+                memory = 0;
+                continue;
+            }
 
+            index = criticalIndex - 1;
 
-inline void String::uniquateInner(int aRequiredCapacity, bool aCopyOriginal) 
-{
-    if (aRequiredCapacity <= unchanged || aRequiredCapacity <= innerCapacity)
-    {
-        if (!aCopyOriginal)
-            data.asCharsBuffer[0] = '\0';  // set empty string for consistent behaviour
-    }
-    else
-        if (aCopyOriginal) 
-            setAllocation(aRequiredCapacity, data.asCharsBuffer);
-        else
-            setAllocation(aRequiredCapacity, "");
-}
+            while (index >= memory && aCanonical(aSubstring[index]) == aCanonical(aChars[start + index]))
+                index--;
 
+            if (index < memory)
+                return aChars + start;
 
-inline void String::uniquateLiteral(int aRequiredCapacity, bool aCopyOriginal) 
-{
-    int originalLength = data.asFields.lengthCache;
-    
-    if (originalLength == csUnknown || originalLength == csDisabled)
-    {
-        if (data.asFields.pointer == NULL)
-            originalLength = 0;
-        else
-            originalLength = strlen(asLiteral(data.asFields.pointer));
+            start += period;
+            memory = aSubstringLength - period;
+        }
     }
+    else
+        while (start <= lastStart)
+        {
+            ViewIndex index = criticalIndex;
 
-    if (aRequiredCapacity <= unchanged || (aRequiredCapacity < originalLength && aCopyOriginal))
-        aRequiredCapacity = originalLength;
-
-    char * originalBuffer = asLiteral(data.asFields.pointer);
-
-    setBuffer(aRequiredCapacity);
+            while (index < aSubstringLength && aCanonical(aSubstring[index]) == aCanonical(aChars[start + index]))
+                index++;
 
-    if (aCopyOriginal && originalLength)
-        copyFrom(originalBuffer, originalLength);
-}
+            if (index < aSubstringLength)
+            {
+                start += index - criticalIndex + 1;
+                continue;
+            }
 
+            index = criticalIndex - 1;
 
-inline void String::uniquateMultiReferenceAllocation(int aRequiredCapacity, bool aCopyOriginal) 
-{
-    if (aRequiredCapacity <= unchanged)
-        aRequiredCapacity = data.asFields.size - 1;
+            while (index >= 0 && aCanonical(aSubstring[index]) == aCanonical(aChars[start + index]))
+                index--;
 
-    if (aCopyOriginal)
-    {
-        char * originalBuffer = asAllocation(data.asFields.pointer)->buffer;
+            if (index < 0)
+                return aChars + start;
 
-        int originalLength = data.asFields.lengthCache;
-        if (originalLength == csUnknown || originalLength == csDisabled)
-            originalLength = strlen(originalBuffer);
-        
-        if (aRequiredCapacity < originalLength)
-            aRequiredCapacity = originalLength;
+            start += period;
+        }
 
-        release();
-        setBuffer(aRequiredCapacity);
-        copyFrom(originalBuffer, originalLength);
-    }
-    else
-    {
-        release();
-        setBuffer(aRequiredCapacity);
-    }
+    return NULL;
 }
 
 
-inline void String::uniquateSingleReferenceAllocation(int aRequiredCapacity, bool aCopyOriginal, bool anAllowShrink) 
+// Search of substring with at least two characters. Candidate positions are found by testing of the first and the last 
+// character of the substring (16 positions at once when SSE2 is available) and then verified by comparing remaining characters.
+// Amount of verification is limited in proportion to scanned length of text. When the text defeats the filter (e.g. searching 
+// "aab" in "aaaa...") the rest of text is searched by Two-Way algorithm so the search remains linear in every case.
+// Parameter aFactorization can be NULL, then it is computed only when Two-Way algorithm is needed.
+template <typename Canonical>
+const char * findCharsFiltered(const char * aChars, ViewIndex aLength, const char * aSubstring, ViewIndex aSubstringLength, const TwoWayFactorization * aFactorization)
 {
-    unsigned int requiredSize;
+    Canonical canonical;
+    const char firstChar = canonical(aSubstring[0]);
+    const char lastChar = canonical(aSubstring[aSubstringLength - 1]);
+    const char * lastStartChar = aChars + aLength - aSubstringLength;
+    const char * startChar = aChars;
+    const int64_t verificationAllowance = 16 * (int64_t) aSubstringLength + 256;
+    int64_t verifiedLength = 0;
 
-    if (aRequiredCapacity <= unchanged)
-        requiredSize = data.asFields.size;
-    else
-        requiredSize = aRequiredCapacity + 1;
+    #ifdef PRACTIC_STRING_SSE2
+        const __m128i firstChars = _mm_set1_epi8(firstChar);
+        const __m128i lastChars = _mm_set1_epi8(lastChar);
 
-    if (requiredSize < data.asFields.size)
-    {
-        if (!anAllowShrink)
-            requiredSize = data.asFields.size;
-        else
-            if (aCopyOriginal)
+        while (startChar + 15 <= lastStartChar)
+        {
+            __m128i firstMatches = _mm_cmpeq_epi8(firstChars, Canonical::block(_mm_loadu_si128((const __m128i *) startChar)));
+            __m128i lastMatches = _mm_cmpeq_epi8(lastChars, Canonical::block(_mm_loadu_si128((const __m128i *) (startChar + aSubstringLength - 1))));
+            unsigned int candidates = _mm_movemask_epi8(_mm_and_si128(firstMatches, lastMatches));
+
+            while (candidates)
             {
-                if (data.asFields.lengthCache == csUnknown || data.asFields.lengthCache == csDisabled)
-                    data.asFields.lengthCache = strlen(asAllocation(data.asFields.pointer)->buffer);  // actualize length cache
-                
-                unsigned int occupiedSize = data.asFields.lengthCache + 1;
+                const char * candidate = startChar + lowestSetBitIndex(candidates);
 
-                if (requiredSize < occupiedSize)
-                    requiredSize = occupiedSize;           
+                if (Canonical::equal(candidate + 1, aSubstring + 1, aSubstringLength - 2))
+                    return candidate;
+
+                verifiedLength += aSubstringLength;
+                candidates &= candidates - 1;
             }
-    }
 
-    if (!aCopyOriginal)
-    {
-        asAllocation(data.asFields.pointer)->buffer[0] = '\0';
-        data.asFields.lengthCache = 0;
-    }
+            startChar += 16;
 
-    if (requiredSize != data.asFields.size)
+            if (verifiedLength > 4 * (startChar - aChars) + verificationAllowance)
+                break;
+        }
+    #endif
+
+    while (startChar <= lastStartChar && verifiedLength <= 4 * (startChar - aChars) + verificationAllowance)
     {
-        unsigned int innerSize = innerCapacity + 1;
+        startChar = Canonical::find(startChar, lastStartChar - startChar + 1, firstChar);
 
-        if (requiredSize <= innerSize)
-        {
-            void * pointer = data.asFields.pointer;
-            setInner(asAllocation(pointer)->buffer);
-            free(pointer);
-        }
-        else
-        {
-            void * newPointer = realloc(data.asFields.pointer, _Allocation::sizeForBufferSize(requiredSize));
+        if (!startChar)
+            return NULL;
 
-            if (!newPointer)
-                onOutOfMemory(requiredSize);
+        if ((char) canonical(startChar[aSubstringLength - 1]) == lastChar && Canonical::equal(startChar + 1, aSubstring + 1, aSubstringLength - 2))
+            return startChar;
 
-            data.asFields.pointer = newPointer;
-            data.asFields.size = requiredSize;
-        }
+        verifiedLength += aSubstringLength;
+        startChar++;
     }
+
+    if (startChar > lastStartChar)
+        return NULL;
+
+    TwoWayFactorization factorization = aFactorization ? *aFactorization : factorize(aSubstring, aSubstringLength, canonical);
+    return searchTwoWay(startChar, aChars + aLength - startChar, aSubstring, aSubstringLength, factorization, canonical);
 }
 
 
+const char * findChars(const char * aChars, ViewIndex aLength, const char * aSubstring, ViewIndex aSubstringLength, EqualityMode aMode)
+{
+    if (aSubstringLength == 0)
+        return aChars;
 
+    if (aSubstringLength > aLength)
+        return NULL;
 
+    if (aSubstringLength == 1)
+        return findChar(aChars, aLength, aSubstring[0], aMode);
 
-// Accessing Buffer ///////////////////////////////////////////////////////////////////////////////////////////////////
+    if (aMode == caseSensitive)
+        return findCharsFiltered<ExactChar>(aChars, aLength, aSubstring, aSubstringLength, NULL);
 
-const char * String::rb() const
-{   
-    if (data.asFields.mode == smInner)
-        return data.asCharsBuffer;
-    else
-        if (data.asFields.mode == smLiteral)
-            return asLiteral(data.asFields.pointer);
-        else
-            return asAllocation(data.asFields.pointer)->buffer;
+    if (usesAsciiFolding())
+        return findCharsFiltered<AsciiFoldedChar>(aChars, aLength, aSubstring, aSubstringLength, NULL);
+
+    HookFoldedChar folded;
+    return searchTwoWay(aChars, aLength, aSubstring, aSubstringLength, factorize(aSubstring, aSubstringLength, folded), folded);
 }
 
 
-char * String::wb(int aRequiredCapacity, bool aCopyOriginal, bool anAllowShrink) 
+
+
+
+// Hashing ////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Fast non-cryptographic hash processing eight characters per step (multiply-rotate mixing with final avalanche).
+// Result is never zero because zero marks not computed hash in _Allocation.
+static unsigned int hashOfChars(const char * aChars, ViewIndex aLength)
 {
-    uniquate(aRequiredCapacity, aCopyOriginal, anAllowShrink);  // same behaviour as method reserveCapacity
+    const uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+    uint64_t hash = multiplier ^ (uint64_t) aLength;
+    ViewIndex index = 0;
 
-    if (data.asFields.mode == smInner)
-        return data.asCharsBuffer;
-    else
+    for (; index + 8 <= aLength; index += 8)
     {
-        data.asFields.lengthCache = csDisabled;  // stop caching until next call non-const method 
-        return asAllocation(data.asFields.pointer)->buffer;
+        uint64_t block;
+        memcpy(&block, aChars + index, sizeof(block));
+        hash = ((hash ^ block) * multiplier);
+        hash ^= hash >> 29;
     }
-}
-
 
-void String::enableLengthCache(int aLength) 
-{
-    debug_assert(aLength == csUnknown || aLength == strlen(rb()));
+    if (index < aLength)
+    {
+        uint64_t block = 0;
+        memcpy(&block, aChars + index, aLength - index);
+        hash = ((hash ^ block) * multiplier);
+    }
 
-    if (data.asFields.mode != smInner)
-        data.asFields.lengthCache = aLength;
+    hash ^= hash >> 33;  // avalanche of the last block (finalizer of MurmurHash3)
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
 
-    // ensure string terminating with '\0' in all cases
-    if (data.asFields.mode == smInner)  
-        data.asCharsBuffer[innerCapacity] = '\0';
-    else
-        if (data.asFields.mode == smAllocation)
-            asAllocation(data.asFields.pointer)->buffer[data.asFields.size-1] = '\0';
+    unsigned int result = (unsigned int) (hash ^ (hash >> 32));
+    return result ? result : 1;
 }
 
 
 
 
 
-// Assigning //////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Internal Types /////////////////////////////////////////////////////////////////////////////////////////////////////
 
-String & String::operator = (const String & anOther) 
+#define self (*this)
+#define isEmptyCString(cstring) (!cstring[0])
+
+#define asLiteral(pointer) ((char *) pointer)
+#define asAllocation(pointer) ((_Allocation *) pointer)
+#define asShared(pointer) ((_SharedStorage *) pointer)
+ 
+
+enum LengthCacheState
 {
-    if (this == &anOther)
-        return *this;
+    csUnknown = -1,
+    csDisabled = -2
+};
+
+
+#define innerLengthByte (data.asCharsBuffer[innerCapacity + 1])
+
+enum InnerLengthState
+{
+    ilUnknown = 0x3F,  // all six bits of length in the last byte of inner buffer are set
+    ilDisabled = 0x3E  // string is written through wb, length is computed on each call of length()
+};
+
+
+inline int String::innerLength() const
+{
+    debug_assert(data.asFields.mode == smInner);
+
+    if (innerLengthByte == ilDisabled)
+        return (int) strlen(data.asCharsBuffer);
+
+    if (innerLengthByte == ilUnknown)
+        innerLengthByte = (char) strlen(data.asCharsBuffer);
+
+    return innerLengthByte;
+}
+
+
+inline void String::setInnerLength(int aLength)
+{
+    static_assert(innerCapacity + 2 == sizeof(Fields), "Inner buffer must cover whole Data.");
+    debug_assert(aLength == ilUnknown || aLength == ilDisabled || (aLength >= 0 && aLength <= innerCapacity));
+
+    innerLengthByte = (char) aLength;  // sets also mode to smInner
+}
+
+
+// Returns length of text (e.g. view) which has to be stored to String. Text longer than maxCapacity can't be stored 
+// to String so it is handled the same way as failed allocation.
+static inline int stringLengthOf(ViewIndex aLength)
+{
+    if (aLength > String::maxCapacity)
+        String::onOutOfMemory((size_t) aLength + 1);
+
+    return (int) aLength;
+}
+
+
+
+
+
+// Lifecycle //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const String String::null = String(NULL, true);
+
+const String String::empty = String();
+
+
+String::String()
+{
+    data.asCharsBuffer[0] = '\0';
+    setInnerLength(0);
+}
+
+
+String::String(char aChar)
+{
+    data.asCharsBuffer[0] = aChar;
+    data.asCharsBuffer[1] = '\0';
+    setInnerLength(aChar ? 1 : 0);
+}
+
+
+String::String(const char * aCString, bool aCStringIsLiteral) 
+{
+    if (aCString == NULL)
+        setLiteral(NULL);
+    else 
+        if (isEmptyCString(aCString))
+            setInner("");
+        else
+            if (aCStringIsLiteral)
+                setLiteral(aCString);
+            else
+            {
+                int length = strlen(aCString);
+                setBuffer(length);
+                copyFrom(aCString, length);
+            }
+}
+
+
+String::String(const char * aCString, int aMaxLength) 
+{
+    if (aCString == NULL)
+        setLiteral(NULL);
+    else 
+        if (aMaxLength <= 0 || isEmptyCString(aCString))
+            setInner("");
+        else
+            if (aMaxLength == 1)
+            {
+                char chars[] = { aCString[0], '\0' };
+                setInner(chars);
+            }
+            else
+            {
+                int actualLength = strnlen(aCString, aMaxLength);
+                setBuffer(actualLength);
+                copyFrom(aCString, actualLength);
+            }
+}
+
+
+String::String(const String & aString) 
+{
+    retain(aString);
+}
+
+
+String::~String() 
+{
+    release();
+}
+
+
+
+
+
+// Adopting External Buffers //////////////////////////////////////////////////////////////////////////////////////////
+
+String String::adopted(char * aBuffer, int aLength)
+{
+    if (aBuffer == NULL)
+        return String::null;
+
+    return shared(aBuffer, aLength, [aBuffer]() { free(aBuffer); });
+}
+
+
+String String::adopted(std::string && aString)
+{
+    int length = stringLengthOf((ViewIndex) aString.length());
+
+    if (length <= innerCapacity)
+        return String(aString.c_str(), length);
+
+    std::string * storage = new std::string(std::move(aString));  // moving keeps the characters on the same place
+
+    return shared(storage->c_str(), length, [storage]() { delete storage; });
+}
 
-    if (references() == 1 && !anOther.isNull())       // prefer copying to already allocated buffer
+
+String String::shared(const char * aChars, int aLength, std::function<void ()> aRelease)
+{
+    debug_assert(aChars);
+    debug_assert(aLength >= 0 && aChars[aLength] == '\0');
+
+    if (aLength <= innerCapacity)  // short text is cheaper to hold in inner buffer than to keep shared storage alive
     {
-        int otherLength = anOther.length();
-        if (otherLength <= self.capacity())           // if the buffer has enough capacity
+        String result(aChars, aLength);
+
+        if (aRelease)
+            aRelease();
+
+        return result;
+    }
+
+    String result;
+    result.setShared(aChars, aLength, std::move(aRelease));
+
+    return result;
+}
+
+
+
+
+
+// Managing Capacity //////////////////////////////////////////////////////////////////////////////////////////////////
+
+String String::withCapacity(int aRequiredCapacity)
+{
+    String s;
+
+    if (aRequiredCapacity > innerCapacity)
+        s.setAllocation(aRequiredCapacity, "");
+
+    return s;
+}
+
+
+void String::reserveCapacity(int aRequiredCapacity, bool aCopyOriginal, bool anAllowShrink) 
+{
+    if (aRequiredCapacity <= capacity() && aCopyOriginal && !anAllowShrink)
+        return;  // prevents premature allocating buffer but same behaviour as method "wb"
+
+    uniquate(aRequiredCapacity, aCopyOriginal, anAllowShrink);  
+}
+
+
+void String::minimizeCapacity() 
+{
+    if (data.asFields.mode == smAllocation && references() == 1)
+        uniquate(0, true, true);
+}
+
+
+
+
+
+// Properties /////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int String::capacity() const  // don't use this method in basic manipulations because it has side efects
+{
+    if (data.asFields.mode == smInner)
+        return innerCapacity;
+    else
+        if (data.asFields.mode == smLiteral || data.asFields.mode == smShared)
+            return length();
+        else
+            return data.asFields.size - 1;
+}
+
+
+int String::length() const  // don't use this method in basic manipulations because it has side efects
+{
+    int result;
+
+    if (data.asFields.mode == smInner)
+        result = innerLength();
+    else
+    {    
+        if (data.asFields.lengthCache != csUnknown && data.asFields.lengthCache != csDisabled)
+            result = data.asFields.lengthCache;
+        else
         {
-            copyFrom(anOther.rb(), otherLength);  
-            return *this;
+            if (data.asFields.pointer == NULL)
+                result = 0;
+            else
+            {
+                char * charsBuffer;     
+
+                if (data.asFields.mode == smLiteral)
+                    charsBuffer = asLiteral(data.asFields.pointer);
+                else
+                    if (data.asFields.mode == smShared)
+                        charsBuffer = (char *) asShared(data.asFields.pointer)->chars;
+                    else
+                        charsBuffer = asAllocation(data.asFields.pointer)->buffer;
+
+                result = strlen(charsBuffer);
+            }
+
+            if (data.asFields.lengthCache != csDisabled)
+                data.asFields.lengthCache = result;
         }
+    }    
+
+    debug_assert(isNull() || isEmpty() ? result == 0 : result == strlen(rb()));
+
+    return result;
+}
+
+
+bool String::isNull() const 
+{
+    return data.asFields.mode == smLiteral && asLiteral(data.asFields.pointer) == NULL;
+}
+
+
+bool String::isEmpty() const
+{
+    if (data.asFields.mode == smInner)
+        return data.asCharsBuffer[0] == '\0';
+    else
+        if (data.asFields.mode == smAllocation)
+            return asAllocation(data.asFields.pointer)->buffer[0] == '\0';
+        else
+            if (data.asFields.mode == smShared)
+                return asShared(data.asFields.pointer)->chars[0] == '\0';
+            else
+                if (asLiteral(data.asFields.pointer) == NULL)
+                    return false;
+                else
+                    return asLiteral(data.asFields.pointer)[0] == '\0';
+}
+
+
+int String::references() const 
+{
+    if (data.asFields.mode == smAllocation)
+        return asAllocation(data.asFields.pointer)->references;
+    else
+        if (data.asFields.mode == smShared)
+            return asShared(data.asFields.pointer)->references;
+        else
+            return -1;
+}
+
+
+
+
+
+// Basic Manipulations ////////////////////////////////////////////////////////////////////////////////////////////////
+
+void String::setInner(const char * aCString) 
+{
+    debug_assert(aCString);
+    debug_assert(strlen(aCString) <= innerCapacity);
+
+    if (aCString)
+        strcpy(data.asCharsBuffer, aCString);
+    else
+        data.asCharsBuffer[0] = '\0';
+
+    setInnerLength(strlen(data.asCharsBuffer));
+}
+
+
+void String::setLiteral(const char * aCString) 
+{
+    data.asFields.mode = smLiteral;
+    data.asFields.lengthCache = csUnknown;
+    data.asFields.pointer = (void *) aCString;
+}
+
+
+void String::setAllocation(int aCapacity, const char * aCString) 
+{
+    debug_assert(aCString);
+    debug_assert(aCapacity >= 0);
+    debug_assert(aCapacity <= maxCapacity);
+    debug_assert(strlen(aCString) <= (unsigned) aCapacity);
+
+    int size = aCapacity + 1;  // add one position for terminating null character
+    int length = strlen(aCString);  // aCString can be inner buffer of the string itself so it must be measured before changing data
+
+    void * pointer = malloc(_Allocation::sizeForBufferSize(size));
+
+    if (!pointer)
+        onOutOfMemory(size);
+
+    reportMemoryEvent(meAllocation, _Allocation::sizeForBufferSize(size));
+
+    #pragma warning (suppress : 6011)  // suppress MSVC warning about referencing NULL pointer
+    memcpy(asAllocation(pointer)->buffer, aCString, length + 1);  
+    asAllocation(pointer)->references = 1;
+    asAllocation(pointer)->hashCache = 0;
+
+    data.asFields.mode = smAllocation;
+    data.asFields.size = size;
+    data.asFields.pointer = pointer;
+    data.asFields.lengthCache = length;
+}
+
+
+void String::setShared(const char * aChars, int aLength, std::function<void ()> aRelease) 
+{
+    debug_assert(aChars);
+    debug_assert(aLength >= 0 && aLength <= maxCapacity);
+
+    _SharedStorage * storage = new _SharedStorage { 0, 1, aChars, std::move(aRelease) };
+    reportMemoryEvent(meAllocation, sizeof(_SharedStorage));
+
+    data.asFields.mode = smShared;
+    data.asFields.size = 0;  // shared characters are never written so there is no capacity
+    data.asFields.pointer = storage;
+    data.asFields.lengthCache = aLength;
+}
+
+
+inline void String::setBuffer(int aRequiredCapacity) 
+{
+    if (aRequiredCapacity <= innerCapacity)
+        setInner("");
+    else
+        setAllocation(aRequiredCapacity, "");
+}
+
+
+void String::retain(const String & anOther) 
+{
+    data = anOther.data;
+
+    if (data.asFields.mode == smAllocation)
+        asAllocation(data.asFields.pointer)->references += 1;
+    else
+        if (data.asFields.mode == smShared)
+            asShared(data.asFields.pointer)->references += 1;
+}
+
+
+void String::release() 
+{
+    if (data.asFields.mode == smAllocation) 
+    {
+        asAllocation(data.asFields.pointer)->references -= 1;
+
+        if (asAllocation(data.asFields.pointer)->references == 0)
+        {
+            free(data.asFields.pointer);
+            reportMemoryEvent(meRelease, _Allocation::sizeForBufferSize(data.asFields.size));
+        }
+    }
+    else
+        if (data.asFields.mode == smShared)
+        {
+            _SharedStorage * storage = asShared(data.asFields.pointer);
+
+            if (--storage->references == 0)
+            {
+                if (storage->release)
+                    storage->release();
+
+                delete storage;
+                reportMemoryEvent(meRelease, sizeof(_SharedStorage));
+            }
+        }
+
+    data.asFields.mode = smLiteral;  // remove reference to released allocation 
+    data.asFields.lengthCache = 0;   // and set fData to consistent state  
+    data.asFields.pointer = NULL;
+}
+
+
+void String::copyFrom(const char * aCString, int aLength) 
+{
+    debug_assert(aCString);
+    debug_assert(data.asFields.mode != smLiteral);
+
+    char * buffer;
+    if (data.asFields.mode == smInner)
+    {
+        debug_assert(aLength <= innerCapacity);
+        debug_assert(strnlen(aCString, aLength) <= innerCapacity);
+
+        buffer = data.asCharsBuffer;
+        setInnerLength(aLength);
+    }
+    else
+    {
+        debug_assert((unsigned) aLength < data.asFields.size);
+        debug_assert(strnlen(aCString, aLength) < data.asFields.size);
+
+        data.asFields.lengthCache = aLength;
+        buffer = asAllocation(data.asFields.pointer)->buffer;
+    }
+
+    strncpy(buffer, aCString, aLength);
+    buffer[aLength] = '\0';
+}
+
+
+
+
+
+// Returns cached hash of buffer shared between instances or NULL when the string has no such buffer 
+// or the buffer is written through wb.
+inline uint32_t * String::hashCache() const
+{
+    if (data.asFields.mode == smAllocation)
+        return data.asFields.lengthCache != csDisabled ? &asAllocation(data.asFields.pointer)->hashCache : NULL;
+    else
+        if (data.asFields.mode == smShared)
+            return &asShared(data.asFields.pointer)->hashCache;
+        else
+            return NULL;
+}
+
+
+
+
+
+// Uniquating /////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void String::uniquate(int aRequiredCapacity, bool aCopyOriginal, bool anAllowShrink) 
+{
+    debug_assert(aRequiredCapacity <= maxCapacity);
+
+    if (data.asFields.mode == smInner)
+        uniquateInner(aRequiredCapacity, aCopyOriginal);
+    else
+        if (data.asFields.mode == smLiteral)
+            uniquateLiteral(aRequiredCapacity, aCopyOriginal);
+        else
+            if (data.asFields.mode == smShared)
+                uniquateShared(aRequiredCapacity, aCopyOriginal);
+            else
+            {
+                debug_assert(asAllocation(data.asFields.pointer)->references > 0);
+
+                if (asAllocation(data.asFields.pointer)->references == 1)
+                    uniquateSingleReferenceAllocation(aRequiredCapacity, aCopyOriginal, anAllowShrink);
+                else
+                    uniquateMultiReferenceAllocation(aRequiredCapacity, aCopyOriginal);
+            }
+
+    debug_assert(data.asFields.mode != smLiteral && data.asFields.mode != smShared);
+
+    if (data.asFields.mode == smAllocation)
+        asAllocation(data.asFields.pointer)->hashCache = 0;  // content of buffer is going to be changed
+}
+
+
+inline void String::uniquateInner(int aRequiredCapacity, bool aCopyOriginal) 
+{
+    if (aRequiredCapacity <= unchanged || aRequiredCapacity <= innerCapacity)
+    {
+        if (!aCopyOriginal)
+        {
+            data.asCharsBuffer[0] = '\0';  // set empty string for consistent behaviour
+            setInnerLength(0);
+        }
+    }
+    else
+        if (aCopyOriginal) 
+            setAllocation(aRequiredCapacity, data.asCharsBuffer);
+        else
+            setAllocation(aRequiredCapacity, "");
+}
+
+
+inline void String::uniquateLiteral(int aRequiredCapacity, bool aCopyOriginal) 
+{
+    int originalLength = data.asFields.lengthCache;
+    
+    if (originalLength == csUnknown || originalLength == csDisabled)
+    {
+        if (data.asFields.pointer == NULL)
+            originalLength = 0;
+        else
+            originalLength = strlen(asLiteral(data.asFields.pointer));
+    }
+
+    if (aRequiredCapacity <= unchanged || (aRequiredCapacity < originalLength && aCopyOriginal))
+        aRequiredCapacity = originalLength;
+
+    char * originalBuffer = asLiteral(data.asFields.pointer);
+
+    setBuffer(aRequiredCapacity);
+
+    if (aCopyOriginal && originalLength)
+        copyFrom(originalBuffer, originalLength);
+}
+
+
+inline void String::uniquateShared(int aRequiredCapacity, bool aCopyOriginal) 
+{
+    int originalLength = data.asFields.lengthCache;  // length of shared characters is always known
+
+    if (aRequiredCapacity <= unchanged || (aRequiredCapacity < originalLength && aCopyOriginal))
+        aRequiredCapacity = originalLength;
+
+    String original(self);  // keeps shared characters alive until they are copied
+
+    release();
+    setBuffer(aRequiredCapacity);
+
+    if (aCopyOriginal && originalLength)
+        copyFrom(original.rb(), originalLength);
+}
+
+
+inline void String::uniquateMultiReferenceAllocation(int aRequiredCapacity, bool aCopyOriginal) 
+{
+    if (aRequiredCapacity <= unchanged)
+        aRequiredCapacity = data.asFields.size - 1;
+
+    if (aCopyOriginal)
+    {
+        char * originalBuffer = asAllocation(data.asFields.pointer)->buffer;
+
+        int originalLength = data.asFields.lengthCache;
+        if (originalLength == csUnknown || originalLength == csDisabled)
+            originalLength = strlen(originalBuffer);
+        
+        if (aRequiredCapacity < originalLength)
+            aRequiredCapacity = originalLength;
+
+        reportMemoryEvent(meDetach, originalLength);
+
+        release();
+        setBuffer(aRequiredCapacity);
+        copyFrom(originalBuffer, originalLength);
+    }
+    else
+    {
+        reportMemoryEvent(meDetach, 0);
+
+        release();
+        setBuffer(aRequiredCapacity);
+    }
+}
+
+
+inline void String::uniquateSingleReferenceAllocation(int aRequiredCapacity, bool aCopyOriginal, bool anAllowShrink) 
+{
+    unsigned int requiredSize;
+
+    if (aRequiredCapacity <= unchanged)
+        requiredSize = data.asFields.size;
+    else
+        requiredSize = aRequiredCapacity + 1;
+
+    if (requiredSize < data.asFields.size)
+    {
+        if (!anAllowShrink)
+            requiredSize = data.asFields.size;
+        else
+            if (aCopyOriginal)
+            {
+                if (data.asFields.lengthCache == csUnknown || data.asFields.lengthCache == csDisabled)
+                    data.asFields.lengthCache = strlen(asAllocation(data.asFields.pointer)->buffer);  // actualize length cache
+                
+                unsigned int occupiedSize = data.asFields.lengthCache + 1;
+
+                if (requiredSize < occupiedSize)
+                    requiredSize = occupiedSize;           
+            }
+    }
+
+    if (!aCopyOriginal)
+    {
+        asAllocation(data.asFields.pointer)->buffer[0] = '\0';
+        data.asFields.lengthCache = 0;
+    }
+
+    if (requiredSize != data.asFields.size)
+    {
+        unsigned int innerSize = innerCapacity + 1;
+
+        if (requiredSize <= innerSize)
+        {
+            void * pointer = data.asFields.pointer;
+            size_t size = _Allocation::sizeForBufferSize(data.asFields.size);
+            setInner(asAllocation(pointer)->buffer);
+            free(pointer);
+            reportMemoryEvent(meRelease, size);
+        }
+        else
+        {
+            void * newPointer = realloc(data.asFields.pointer, _Allocation::sizeForBufferSize(requiredSize));
+
+            if (!newPointer)
+                onOutOfMemory(requiredSize);
+
+            reportMemoryEvent(meReallocation, _Allocation::sizeForBufferSize(requiredSize), _Allocation::sizeForBufferSize(data.asFields.size));
+
+            data.asFields.pointer = newPointer;
+            data.asFields.size = requiredSize;
+        }
+    }
+}
+
+
+
+
+
+// Accessing Buffer ///////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char * String::rb() const
+{   
+    if (data.asFields.mode == smInner)
+        return data.asCharsBuffer;
+    else
+        if (data.asFields.mode == smLiteral)
+            return asLiteral(data.asFields.pointer);
+        else
+            if (data.asFields.mode == smShared)
+                return asShared(data.asFields.pointer)->chars;
+            else
+                return asAllocation(data.asFields.pointer)->buffer;
+}
+
+
+char * String::wb(int aRequiredCapacity, bool aCopyOriginal, bool anAllowShrink) 
+{
+    uniquate(aRequiredCapacity, aCopyOriginal, anAllowShrink);  // same behaviour as method reserveCapacity
+
+    if (data.asFields.mode == smInner)
+    {
+        setInnerLength(ilDisabled);  // stop caching until next call non-const method 
+        return data.asCharsBuffer;
+    }
+    else
+    {
+        data.asFields.lengthCache = csDisabled;  // stop caching until next call non-const method 
+        return asAllocation(data.asFields.pointer)->buffer;
+    }
+}
+
+
+void String::enableLengthCache(int aLength) 
+{
+    debug_assert(aLength == csUnknown || aLength == strlen(rb()));
+
+    // ensure string terminating with '\0' in all cases
+    if (data.asFields.mode == smInner)  
+    {
+        data.asCharsBuffer[innerCapacity] = '\0';
+        setInnerLength(aLength == csUnknown ? ilUnknown : aLength);
+    }
+    else
+    {
+        data.asFields.lengthCache = aLength;
+
+        if (data.asFields.mode == smAllocation)
+            asAllocation(data.asFields.pointer)->buffer[data.asFields.size-1] = '\0';
+    }
+}
+
+
+
+
+
+// Assigning //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+String & String::operator = (const String & anOther) 
+{
+    if (this == &anOther)
+        return *this;
+
+    if (data.asFields.mode == smAllocation && references() == 1 && !anOther.isNull())  // prefer copying to already allocated buffer
+    {
+        int otherLength = anOther.length();
+        if (otherLength <= self.capacity())           // if the buffer has enough capacity
+        {
+            copyFrom(anOther.rb(), otherLength);  
+            return *this;
+        }
+    }
+    
+    release();
+    retain(anOther);
+
+    return *this;
+}
+
+
+String & String::operator = (const char * aCString) 
+{
+    if (aCString == NULL)
+    {
+        release();
+        setLiteral(NULL);
+    }
+    else
+    {
+        int length = strlen(aCString);
+        uniquate(length, false, false);
+        copyFrom(aCString, length);
+    }
+
+    return *this;
+}
+
+
+String & String::operator = (const char aChar) 
+{
+    char * buffer = wb(1, false, false);
+
+    buffer[0] = aChar;
+
+    if (aChar == '\0')
+        enableLengthCache(0);
+    else
+    {
+        buffer[1] = '\0';
+        enableLengthCache(1);
+    }    
+
+    return *this;
+}
+
+
+
+
+
+// Appending //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void String::append(const String aString) 
+{
+    if (aString.isNull())
+        return;
+
+    if (aString.isEmpty())  // prevent reallocation (calling wb) unless there is change
+    {
+        if (self.isNull())
+            setInner("");
+        return;
+    }
+
+    if (self.isNull() || (self.isEmpty() && data.asFields.mode != smAllocation))
+        retain(aString);
+    else
+    {
+        int selfLength = self.length();
+        int otherLength = aString.length();
+        int newLength = selfLength + otherLength;
+
+        char * buffer = wb(newLength);
+        memcpy(buffer + selfLength, aString.rb(), otherLength);  // strcat or strcpy can't be used because possible ovelapping on terminator char
+        buffer[newLength] = '\0';
+        enableLengthCache(newLength);
+    }
+}
+
+
+void String::append(const char * aCString)
+{
+    if (!aCString)
+        return;
+
+    if (isEmptyCString(aCString))  // prevent reallocation (calling wb) unless there is change
+    {
+        if (self.isNull())
+            setInner("");
+        return;
+    }
+
+    int selfLength = self.length();
+    int otherLength = strlen(aCString);
+    int newLength = selfLength + otherLength;
+
+    char * buffer = wb(newLength);
+    memcpy(buffer + selfLength, aCString, otherLength);  // strcat or strcpy can't be used because possible ovelapping on terminator char
+    buffer[newLength] = '\0';
+    enableLengthCache(newLength);
+}
+
+
+void String::append(const char aChar)
+{
+    if (aChar == '\0' && !isNull())  // prevent reallocation (calling wb) unless there is change
+        return;
+
+    int newIndex = self.length();
+    int newLength = newIndex + 1;
+
+    char * buffer = self.wb(newLength);
+    buffer[newIndex] = aChar;
+    buffer[newIndex+1] = '\0';
+
+    if (aChar == '\0')
+        newLength -= 1;
+
+    enableLengthCache(newLength);
+}
+
+
+void String::appendFormatted(const char * aFormat, ...)
+{
+    va_list arguments;
+    va_start(arguments, aFormat);
+        appendFormattedList(aFormat, arguments);
+    va_end(arguments);
+}
+
+
+void String::appendFormattedList(const char * aFormat, va_list anArguments)
+{
+    if (!aFormat)
+        return;
+
+    va_list arguments;
+
+    va_copy(arguments, anArguments);
+        int formattedLength = vsnprintf(NULL, 0, aFormat, arguments);
+        debug_assert(formattedLength >= 0);
+    va_end(arguments);
+
+    if (formattedLength == 0)  // prevent reallocation (calling wb) unless there is change
+    {
+        if (self.isNull()) 
+            setInner("");
+        return;
+    }
+
+    int selfLength = self.length();
+    int newLength = selfLength + formattedLength;
+
+    char * buffer = wb(newLength);
+
+    va_copy(arguments, anArguments);
+        vsnprintf(buffer + selfLength, formattedLength + 1, aFormat, arguments);
+    va_end(arguments);
+
+    enableLengthCache(newLength);
+}
+
+
+
+
+
+// Joining ////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+_StringJoiningResult & operator +(const _StringJoiningResult & aFirst, const String & aSecond)
+{
+    _StringJoiningResult & first = const_cast<_StringJoiningResult&>(aFirst);
+    first.append(aSecond);
+    return first;
+}
+
+
+_StringJoiningResult & operator +(const _StringJoiningResult & aFirst, const char * aSecond)
+{
+    _StringJoiningResult & first = const_cast<_StringJoiningResult&>(aFirst);
+    first.append(aSecond);
+    return first;
+}
+
+
+_StringJoiningResult & operator +(const _StringJoiningResult & aFirst, char aSecond)
+{
+    _StringJoiningResult & first = const_cast<_StringJoiningResult&>(aFirst);
+    first.append(aSecond);
+    return first;
+}
+
+
+
+
+
+// Equality ///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool String::equals(const String & aString, EqualityMode aMode) const
+{
+    uint32_t * hashCache = self.hashCache();
+    uint32_t * otherHashCache = aString.hashCache();
+
+    if (hashCache && otherHashCache)
+    {
+        if (data.asFields.pointer == aString.data.asFields.pointer)
+            return true;
+
+        if (aMode == caseSensitive && *hashCache && *otherHashCache && *hashCache != *otherHashCache)
+            return false;
+    }
+
+    return view().equals(aString.view(), aMode);  // compares cached lengths first
+}
+
+
+bool String::equals(const char * anOther, EqualityMode aMode) const
+{
+    return view().equals(StringView(anOther), aMode);
+}
+
+
+bool String::equals(const char aChar, EqualityMode anEqualityMode) const
+{
+    return view().equals(aChar, anEqualityMode);
+}
+
+
+
+
+
+// Ordering & Hashing /////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int String::hash() const
+{
+    uint32_t * hashCache = self.hashCache();
+
+    if (!hashCache)
+        return view().hash();
+
+    if (*hashCache == 0)
+        *hashCache = view().hash();
+
+    return *hashCache;
+}
+
+
+
+
+
+// Searching //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int String::indexOf(const char * aCSubstring, EqualityMode aMode, int aStartIndex) const
+{
+    return (int) view().indexOf(StringView(aCSubstring), aMode, aStartIndex);
+}
+
+
+int String::indexOf(char aChar, EqualityMode aMode, int aStartIndex) const
+{
+    return (int) view().indexOf(aChar, aMode, aStartIndex);
+}
+
+
+int String::indexOfAnyChar(CharTestCondition aCondition, const char * aChars, int aStartIndex) const
+{
+    return (int) view().indexOfAnyChar(aCondition, StringView(aChars), aStartIndex);
+}
+
+
+int String::indexOfAnyCharWhere(CharTestFunction aTestFunction, bool aTestResult, int aStartIndex) const
+{
+    return (int) view().indexOfAnyCharWhere(aTestFunction, aTestResult, aStartIndex);
+} 
+
+
+
+
+
+// Containing substring / character ///////////////////////////////////////////////////////////////////////////////////
+
+bool String::containsOnlyChars(CharTestCondition aCondition, const char * aChars) const
+{
+    if (isEmpty() || isNull())
+        return false;
+
+    if (!aChars)
+        aChars = "";
+
+    if (aCondition == containedIn)
+        aCondition = notContainedIn;
+    else
+        aCondition = containedIn;
+
+    return indexOfAnyChar(aCondition, aChars, 0) == notFound;
+}
+
+
+bool String::containsOnlyCharsWhere(CharTestFunction aTestFunction, bool aTestResult) const 
+{ 
+    if (!aTestFunction || isEmpty() || isNull())
+        return false;
+    else
+        return indexOfAnyCharWhere(aTestFunction, !aTestResult) == notFound; 
+}
+
+
+bool String::containsAt(int anIndex, const char * aCSubstring, EqualityMode aMode) const
+{
+    return view().containsAt(anIndex, StringView(aCSubstring), aMode);
+}
+
+
+bool String::containsAt(int anIndex, char aChar, EqualityMode aMode) const
+{
+    return view().containsAt(anIndex, aChar, aMode);
+}
+
+
+bool String::containsCharsAt(int anIndex, CharTestCondition aCondition, const char * aChars, int * oLength) const
+{
+    ViewIndex length;
+    bool result = view().containsCharsAt(anIndex, aCondition, StringView(aChars), &length);
+
+    *oLength = (int) length;
+    return result;
+}
+
+
+bool String::containsCharsAtWhere(int anIndex, CharTestFunction aTestFunction, bool aTestResult, int * oLength) const
+{
+    ViewIndex length;
+    bool result = view().containsCharsAtWhere(anIndex, aTestFunction, aTestResult, &length);
+
+    *oLength = (int) length;
+    return result;
+}
+
+
+bool String::containsAnyCharAt(int anIndex, CharTestCondition aCondition, const char * aChars) const 
+{
+    return view().containsAnyCharAt(anIndex, aCondition, StringView(aChars));
+}
+
+
+bool String::containsAnyCharAtWhere(int anIndex, CharTestFunction aTestFunction, bool aTestResult) const
+{
+    return view().containsAnyCharAtWhere(anIndex, aTestFunction, aTestResult);
+}
+
+
+
+
+
+// Substrings /////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+String String::substringFrom(int aStartIndex, int aLength) const
+{
+    if (isNull())
+        return null;
+
+    if (isEmpty())
+        return empty;
+
+    if (aStartIndex < 0)
+    {
+        aLength += aStartIndex;
+        aStartIndex = 0;
+    }
+
+    if (aLength <= 0)
+        return empty;
+
+    int selfLength = length();
+
+    if (aStartIndex >= selfLength)
+        return empty;
+
+    if (aStartIndex + aLength > selfLength)
+        aLength = selfLength - aStartIndex;
+
+    if (aStartIndex == 0 && aLength == selfLength)
+        return self;
+
+    return String(rb() + aStartIndex, aLength);
+}
+
+
+String String::substringOfCharsAt(int aStartIndex, CharTestCondition aCondition, const char * aChars) const
+{   
+    if (isNull())
+        return null;
+
+    int substringLength;    
+    if (containsCharsAt(aStartIndex, aCondition, aChars, &substringLength))
+        return substringFrom(aStartIndex, substringLength);
+    else
+        return empty;
+}
+
+
+String String::substringOfCharsAtWhere(int aStartIndex, CharTestFunction aTestFunction, bool aTestResult) const
+{
+    if (isNull())
+        return null;
+
+    int substringLength;    
+    if (containsCharsAtWhere(aStartIndex, aTestFunction, aTestResult, &substringLength))
+        return substringFrom(aStartIndex, substringLength);
+    else
+        return empty;
+}
+
+            
+
+
+
+// Testing Suffex /////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool String::hasSuffix(const char * aCSubstring, EqualityMode aMode) const
+{
+    return view().hasSuffix(StringView(aCSubstring), aMode);
+}
+
+
+bool String::hasSuffix(char aChar, EqualityMode aMode) const
+{
+    int selfLength = length();
+    return selfLength && containsAt(selfLength-1, aChar, aMode);
+}
+
+
+
+
+
+// Inserting //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void String::insertAt(int anIndex, const String aString)
+{
+    if (aString.isNull())
+        return;
+
+    if ((self.isEmpty() || self.isNull()) && data.asFields.mode != smAllocation)
+    {
+        retain(aString);
+        return;
+    }
+
+    int otherLength = aString.length();  
+
+    if (otherLength == 0)  // prevent reallocation (call wb) when there is nothing to insert 
+        return;
+
+    int selfLength = length();
+
+    if (anIndex > selfLength)
+        anIndex = selfLength;
+
+    if (anIndex < 0)
+        anIndex = 0;
+
+    int newLength = selfLength + otherLength;
+
+    char * buffer = wb(newLength);
+    memmove(buffer + anIndex + otherLength, buffer + anIndex, selfLength - anIndex + 1);
+    memcpy(buffer + anIndex, aString.rb(), otherLength);
+    enableLengthCache(newLength);
+}
+
+
+void String::insertAt(int anIndex, const char * aCString)
+{
+    if (!aCString)
+        return;
+
+    int otherLength = strlen(aCString);  
+
+    if ((self.isEmpty() || self.isNull()) && data.asFields.mode != smAllocation)
+    {
+        setBuffer(otherLength);
+        copyFrom(aCString, otherLength);
+        return;
+    }
+
+    if (otherLength == 0)  // prevent reallocation (call wb) when there is nothing to insert 
+        return;
+
+    int selfLength = length();
+
+    if (anIndex > selfLength)
+        anIndex = selfLength;
+
+    if (anIndex < 0)
+        anIndex = 0;
+
+    int newLength = selfLength + otherLength;
+
+    char * buffer = wb(newLength);
+    memmove(buffer + anIndex + otherLength, buffer + anIndex, selfLength - anIndex + 1);
+    memcpy(buffer + anIndex, aCString, otherLength);
+    enableLengthCache(newLength);
+}
+
+       
+void String::insertAt(int anIndex, char aChar)
+{
+    int selfLength = length();
+
+    if (anIndex > selfLength)
+        anIndex = selfLength;
+
+    if (anIndex < 0)
+        anIndex = 0;
+
+    int newLength;
+    char * buffer;
+
+    if (aChar == '\0')
+    {
+        if (!isNull() && anIndex == selfLength) // prevent reallocation (calling wb) unless there is change
+            return;
+
+        newLength = anIndex;
+        buffer = wb(newLength);
+    }
+    else
+    {
+        newLength = selfLength + 1;
+        buffer = wb(newLength);
+        memmove(buffer + anIndex + 1, buffer + anIndex, selfLength - anIndex + 1);
+    }
+
+    buffer[anIndex] = aChar;
+    enableLengthCache(newLength);
+}
+
+
+void String::insertFormattedAt(int anIndex, const char * aFormat, ...)
+{
+    va_list arguments;
+    va_start(arguments, aFormat);
+        insertFormattedListAt(anIndex, aFormat, arguments);
+    va_end(arguments);
+}
+
+
+void String::insertFormattedListAt(int anIndex, const char * aFormat, va_list anArguments)
+{
+    if (!aFormat)
+        return;
+
+    va_list arguments;
+
+    va_copy(arguments, anArguments);
+        int formattedLength = vsnprintf(NULL, 0, aFormat, arguments);
+        debug_assert(formattedLength >= 0);
+    va_end(arguments);
+      
+    if (formattedLength == 0)  // prevent reallocation (calling wb) unless there is change
+    {
+        if (isNull())
+            setInner("");
+        return;
+    }
+
+    int selfLength = length();
+
+    if (anIndex > selfLength)
+        anIndex = selfLength;
+
+    if (anIndex < 0)
+        anIndex = 0;
+
+    int newLength = selfLength + formattedLength;
+
+    char * buffer = wb(newLength);
+    memmove(buffer + anIndex + formattedLength, buffer + anIndex, selfLength - anIndex + 1);
+
+    char * formattedTerminatorPosition = buffer + anIndex + formattedLength;
+    char temp = *formattedTerminatorPosition;  // save character at position of terminator of formatted string
+
+    va_copy(arguments, anArguments);
+        vsnprintf(buffer + anIndex, formattedLength + 1, aFormat, arguments);  // insert formatted string with terminator
+    va_end(arguments);
+
+    *formattedTerminatorPosition = temp;  // restore character at position of terminator of formatted string
+
+    enableLengthCache(newLength);
+}
+
+
+
+
+
+// Ensuring Prefix / Suffix ///////////////////////////////////////////////////////////////////////////////////////////
+
+void String::ensurePrefix(const char * aSubstring, EqualityMode aMode)
+{
+    if (!hasPrefix(aSubstring, aMode))
+        insertAt(0, aSubstring);
+}
+
+
+void String::ensurePrefix(const char aChar, EqualityMode aMode)
+{
+    if (!hasPrefix(aChar, aMode))
+        insertAt(0, aChar);
+}
+
+
+void String::ensureSuffix(const char * aSubstring, EqualityMode aMode)
+{
+    if (!hasSuffix(aSubstring, aMode))
+        append(aSubstring);
+}
+
+
+void String::ensureSuffix(const char aChar, EqualityMode aMode)
+{
+    if (!hasSuffix(aChar, aMode))
+        append(aChar);
+}
+
+
+
+
+
+// Converting Case ////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int (*String::onToLower)(int) = String::asciiToLower;
+
+int (*String::onToUpper)(int) = String::asciiToUpper;
+
+
+int String::asciiToLower(int aChar)
+{
+    return aChar >= 'A' && aChar <= 'Z' ? aChar + ('a' - 'A') : aChar;
+}
+
+
+int String::asciiToUpper(int aChar)
+{
+    return aChar >= 'a' && aChar <= 'z' ? aChar + ('A' - 'a') : aChar;
+}
+
+
+void String::convertTo(LetterCase aLetterCase)
+{
+    if (isEmpty() || isNull())
+        return;
+
+    if (usesAsciiConversion(aLetterCase))
+    {
+        int selfLength = self.length();
+        int startIndex = asciiIndexOfConvertible(rb(), selfLength, aLetterCase);
+
+        if (startIndex == notFound)  // prevent reallocation (calling wb) when there is nothing to convert
+            return;
+
+        char * writeBufferStart = wb();
+        asciiConvert(writeBufferStart + startIndex, selfLength - startIndex, aLetterCase);
+
+        enableLengthCache(selfLength);
+        return;
     }
+
+    const char * firstChar = rb();
+    const char * testedChar = firstChar;
+
+    if (aLetterCase == upperCase)
+        while (*testedChar && *testedChar == onToUpper(*testedChar)) testedChar++;
+    else
+        while (*testedChar && *testedChar == onToLower(*testedChar)) testedChar++;
+
+    if (!*testedChar)  // prevent reallocation (calling wb) when there is nothing to convert
+        return;
+
+    int startIndex = testedChar - firstChar;
+
+    char * writeBufferStart = wb();
+    char * convertedChar = writeBufferStart + startIndex;
     
-    release();
-    retain(anOther);
+    if (aLetterCase == upperCase)
+        do { *convertedChar = onToUpper(*convertedChar); } while (*(++convertedChar));
+    else
+        do { *convertedChar = onToLower(*convertedChar); } while (*(++convertedChar));
 
-    return *this;
+    enableLengthCache(convertedChar - writeBufferStart);
 }
 
 
-String & String::operator = (const char * aCString) 
+
+
+
+// Trimming ///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void String::trimLeftChars(CharTestCondition aCondition, const char * aChars)
 {
-    if (aCString == NULL)
-    {
-        release();
-        setLiteral(NULL);
-    }
-    else
-    {
-        int length = strlen(aCString);
-        uniquate(length, false, false);
-        copyFrom(aCString, length);
-    }
+    trimLeftCharsBy(CharSet(aChars, aCondition));
+}
 
-    return *this;
+
+void String::trimLeftCharsWhere(CharTestFunction aTestFunction, bool aTestResult)
+{
+    if (aTestFunction)
+        trimLeftCharsBy(CharTest{aTestFunction, aTestResult});
 }
 
 
-String & String::operator = (const char aChar) 
+void String::trimRightChars(CharTestCondition aCondition, const char * aChars)
 {
-    char * buffer = wb(1, false, false);
+    trimRightCharsBy(CharSet(aChars, aCondition));
+}
 
-    buffer[0] = aChar;
 
-    if (aChar == '\0')
-        enableLengthCache(0);
-    else
-    {
-        buffer[1] = '\0';
-        enableLengthCache(1);
-    }    
+void String::trimRightCharsWhere(CharTestFunction aTestFunction, bool aTestResult)
+{
+    if (aTestFunction)
+        trimRightCharsBy(CharTest{aTestFunction, aTestResult});
+}
 
-    return *this;
+
+void String::trimWhitespace()
+{
+    trimRightCharsBy(CharTest{isspace, true});
+    trimLeftCharsBy(CharTest{isspace, true});
 }
 
 
 
 
 
-// Appending //////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Removing by Index //////////////////////////////////////////////////////////////////////////////////////////////////
 
-void String::append(const String aString) 
+void String::removeFrom(int aStartIndex, int aLength)
 {
-    if (aString.isNull())
+    if (isEmpty() || isNull())
         return;
 
-    if (aString.isEmpty())  // prevent reallocation (calling wb) unless there is change
+    if (aStartIndex < 0)
     {
-        if (self.isNull())
-            setInner("");
-        return;
+        aLength += aStartIndex;
+        aStartIndex = 0;
     }
 
-    if (self.isNull() || (self.isEmpty() && data.asFields.mode != smAllocation))
-        retain(aString);
+    if (aLength <= 0)
+        return;
+
+    int selfLength = length();
+
+    if (aStartIndex >= selfLength)
+        return;
+
+    if (aStartIndex + aLength > selfLength)
+        aLength = selfLength - aStartIndex;
+
+    char * buffer = wb();
+
+    if (aLength == selfLength)
+        buffer[aStartIndex] = '\0';
     else
-    {
-        int selfLength = self.length();
-        int otherLength = aString.length();
-        int newLength = selfLength + otherLength;
+        memmove(buffer + aStartIndex, buffer + aStartIndex + aLength, selfLength - aStartIndex - aLength + 1);
 
-        char * buffer = wb(newLength);
-        memcpy(buffer + selfLength, aString.rb(), otherLength);  // strcat or strcpy can't be used because possible ovelapping on terminator char
-        buffer[newLength] = '\0';
-        enableLengthCache(newLength);
+    enableLengthCache(selfLength - aLength);
+}
+
+
+
+
+
+// Removing Prefix / Suffix ///////////////////////////////////////////////////////////////////////////////////////////
+
+void String::removePrefix(const char * aCSubstring, EqualityMode aMode)
+{
+    if (hasPrefix(aCSubstring, aMode))
+        removeFrom(0, strlen(aCSubstring));
+}
+
+
+void String::removePrefix(const char aChar, EqualityMode aMode)
+{
+    if (hasPrefix(aChar, aMode))
+        removeFrom(0, 1);
+}
+
+
+void String::removeSuffix(const char * aCSubstring, EqualityMode aMode)
+{
+    if (hasSuffix(aCSubstring, aMode))
+    {
+        int substringLength = strlen(aCSubstring);
+        removeFrom(self.length() - substringLength, substringLength);
     }
 }
 
 
-void String::append(const char * aCString)
+void String::removeSuffix(const char aChar, EqualityMode aMode)
 {
-    if (!aCString)
-        return;
+    if (hasSuffix(aChar, aMode))
+        removeFrom(length() - 1, 1);
+}
 
-    if (isEmptyCString(aCString))  // prevent reallocation (calling wb) unless there is change
+
+
+
+
+// Removing Characters ////////////////////////////////////////////////////////////////////////////////////////////////
+
+void String::remove(char aChar, EqualityMode aMode, int aStartIndex)
+{
+    if (aMode == caseSensitive || !isalpha(aChar))
     {
-        if (self.isNull())
-            setInner("");
-        return;
+        char chars[] = { aChar };
+        removeCharsBy(CharSet(StringView(chars, 1), containedIn), aStartIndex);
+    }
+    else
+    {
+        char chars[] = { (char)onToLower(aChar), (char)onToUpper(aChar) };
+        removeCharsBy(CharSet(StringView(chars, 2), containedIn), aStartIndex);
     }
+} 
 
-    int selfLength = self.length();
-    int otherLength = strlen(aCString);
-    int newLength = selfLength + otherLength;
 
-    char * buffer = wb(newLength);
-    memcpy(buffer + selfLength, aCString, otherLength);  // strcat or strcpy can't be used because possible ovelapping on terminator char
-    buffer[newLength] = '\0';
-    enableLengthCache(newLength);
+void String::removeChars(CharTestCondition aCondition, const char * aChars, int aStartIndex)
+{
+    removeCharsBy(CharSet(aChars, aCondition), aStartIndex);
 }
 
 
-void String::append(const char aChar)
+void String::removeCharsWhere(CharTestFunction aTestFunction, bool aTestResult, int aStartIndex)
 {
-    if (aChar == '\0' && !isNull())  // prevent reallocation (calling wb) unless there is change
-        return;
+    if (aTestFunction)
+        removeCharsBy(CharTest{aTestFunction, aTestResult}, aStartIndex);
+}
 
-    int newIndex = self.length();
-    int newLength = newIndex + 1;
 
-    char * buffer = self.wb(newLength);
-    buffer[newIndex] = aChar;
-    buffer[newIndex+1] = '\0';
 
-    if (aChar == '\0')
-        newLength -= 1;
 
-    enableLengthCache(newLength);
+
+// Replacing //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void String::replace(char anOriginal, char aSubstitute, EqualityMode aMode, int aStartIndex)
+{
+    if (aMode == caseSensitive || !isalpha(anOriginal))
+    {
+        char original[] = { anOriginal };
+        replaceCharsBy(CharSet(StringView(original, 1), containedIn), aSubstitute, aStartIndex);
+    }
+    else
+    {
+        char original[] = { (char)onToLower(anOriginal), (char)onToUpper(anOriginal) };
+        replaceCharsBy(CharSet(StringView(original, 2), containedIn), aSubstitute, aStartIndex);
+    }    
 }
 
 
-void String::appendFormatted(const char * aFormat, ...)
+void String::replaceChars(CharTestCondition aCondition, const char * aChars, char aSubstitute, int aStartIndex)
 {
-    va_list arguments;
-    va_start(arguments, aFormat);
-        appendFormattedList(aFormat, arguments);
-    va_end(arguments);
+    replaceCharsBy(CharSet(aChars, aCondition), aSubstitute, aStartIndex);
 }
 
 
-void String::appendFormattedList(const char * aFormat, va_list anArguments)
+void String::replaceCharsWhere(CharTestFunction aTestFunction, bool aTestResult, char aSubstitute, int aStartIndex)
 {
-    if (!aFormat)
+    if (aTestFunction)
+        replaceCharsBy(CharTest{aTestFunction, aTestResult}, aSubstitute, aStartIndex);
+}
+
+
+void String::replace(const char * anOriginal, const char * aSubstitute, EqualityMode aMode, int aStartIndex)
+{
+    if (isEmpty() || isNull() || !anOriginal || isEmptyCString(anOriginal))
         return;
 
-    va_list arguments;
+    int selfLength = self.length();
+    int originalLength = strlen(anOriginal);
 
-    va_copy(arguments, anArguments);
-        int formattedLength = vsnprintf(NULL, 0, aFormat, arguments);
-        debug_assert(formattedLength >= 0);
-    va_end(arguments);
+    if (aStartIndex < 0)
+        aStartIndex = 0;
 
-    if (formattedLength == 0)  // prevent reallocation (calling wb) unless there is change
-    {
-        if (self.isNull()) 
-            setInner("");
+    int searchedLength = selfLength - aStartIndex;
+    if (searchedLength < originalLength)
         return;
-    }
 
-    int selfLength = self.length();
-    int newLength = selfLength + formattedLength;
+    StringSearcher searcher(StringView(anOriginal, originalLength), aMode);
 
-    char * buffer = wb(newLength);
+    const char * rbFirstChar = rb(); 
+    int foundAtIndex = (int) searcher.indexIn(StringView(rbFirstChar, selfLength), aStartIndex); 
 
-    va_copy(arguments, anArguments);
-        vsnprintf(buffer + selfLength, formattedLength + 1, aFormat, arguments);
-    va_end(arguments);
+    if (foundAtIndex == notFound)  // prevent reallocation (calling wb) when there is nothing to replace
+        return;
 
-    enableLengthCache(newLength);
-}
+    int substituteLength = aSubstitute ? strlen(aSubstitute) : 0;  // NULL is considered to be empty string
+
+    if (substituteLength <= originalLength)
+    {
+        char * firstChar = wb();
+        StringView searched(firstChar, selfLength);  // characters after write position are never changed so the view stays valid
+
+        char * writeTo = firstChar + foundAtIndex;
+        int readFromIndex = foundAtIndex;
+
+        do {
+            int movedLength = foundAtIndex - readFromIndex;
+            memmove(writeTo, firstChar + readFromIndex, movedLength);
+            writeTo += movedLength;
+
+            memmove(writeTo, aSubstitute, substituteLength);
+            writeTo += substituteLength;
+
+            readFromIndex = foundAtIndex + originalLength;
+        } while (( foundAtIndex = (int) searcher.indexIn(searched, readFromIndex) ) != notFound); 
+
+        int movedLength = selfLength - readFromIndex;
+        memmove(writeTo, firstChar + readFromIndex, movedLength);
+        writeTo += movedLength;
+
+        *writeTo = '\0';
+
+        enableLengthCache(writeTo - firstChar);
+    }
+    else
+    {
+        // Replacing in place would move the rest of string for each occurrence, so the result is composed into a new buffer.
+        StringView searched(rbFirstChar, selfLength);
+        int increment = substituteLength - originalLength;   
+        int newLength = selfLength;         
+        int index = foundAtIndex;
+
+        do {
+            newLength += increment;
+            index += originalLength;
+        } while (( index = (int) searcher.indexIn(searched, index) ) != notFound);
+
+        String result = withCapacity(newLength);
+        char * writeTo = result.wb();
+        int readFromIndex = 0;
+
+        do {
+            int copiedLength = foundAtIndex - readFromIndex;
+            memcpy(writeTo, rbFirstChar + readFromIndex, copiedLength);
+            writeTo += copiedLength;
 
+            memcpy(writeTo, aSubstitute, substituteLength);
+            writeTo += substituteLength;
 
+            readFromIndex = foundAtIndex + originalLength;
+        } while (( foundAtIndex = (int) searcher.indexIn(searched, readFromIndex) ) != notFound);
 
+        memcpy(writeTo, rbFirstChar + readFromIndex, selfLength - readFromIndex + 1);
+        result.enableLengthCache(newLength);
 
+        release();
+        retain(result);
+    }
+}
 
-// Joining ////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-_StringJoiningResult & operator +(const _StringJoiningResult & aFirst, const String & aSecond)
-{
-    _StringJoiningResult & first = const_cast<_StringJoiningResult&>(aFirst);
-    first.append(aSecond);
-    return first;
-}
 
 
-_StringJoiningResult & operator +(const _StringJoiningResult & aFirst, const char * aSecond)
-{
-    _StringJoiningResult & first = const_cast<_StringJoiningResult&>(aFirst);
-    first.append(aSecond);
-    return first;
-}
 
+// Padding ////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-_StringJoiningResult & operator +(const _StringJoiningResult & aFirst, char aSecond)
+void String::padLeft(int aLength, char aChar)
 {
-    _StringJoiningResult & first = const_cast<_StringJoiningResult&>(aFirst);
-    first.append(aSecond);
-    return first;
-}
+    if (aLength <= 0)
+        return;
 
+    int selfLength = self.length();
 
+    if (aLength <= selfLength)
+        return;
 
+    char * buffer = wb(aLength);
 
+    int paddingLength = aLength - selfLength;
+    memmove(buffer + paddingLength, buffer, selfLength + 1);  // move including terminating null char
+    memset(buffer, aChar, paddingLength);
 
-// Equality ///////////////////////////////////////////////////////////////////////////////////////////////////////////
+    int actualLength;
 
-inline bool stringsEqualIgnoreCase(const char * aFirst, const char * aSecond)
-{
-    while (*aFirst)
-        if (String::onToLower(*aFirst++) != String::onToLower(*aSecond++))
-            return false;
+    if (aChar)
+        actualLength = aLength;
+    else
+        actualLength = 0;
 
-    return String::onToLower(*aFirst) == String::onToLower(*aSecond);
+    enableLengthCache(actualLength);
 }
 
 
-bool String::equals(const char * anOther, EqualityMode aMode) const
+void String::padRight(int aLength, char aChar)
 {
-    if (isNull())
-        return anOther == NULL;
+    if (aLength <= 0)
+        return;
+
+    int selfLength = self.length();
+
+    if (aLength <= selfLength)
+        return;
+
+    char * buffer = wb(aLength);
+    memset(buffer + selfLength, aChar, aLength - selfLength);
+    buffer[aLength] = '\0';
+
+    int actualLength;
+
+    if (aChar)
+        actualLength = aLength;
     else
-        if (anOther == NULL)
-            return isNull();
-        else
-        {
-            const char * selfBuffer = self.rb();
+        actualLength = selfLength;
 
-            if (selfBuffer == anOther)
-                return true;
-            else
-                if (aMode == caseSensitive)
-                    return !strcmp(selfBuffer, anOther);
-                else
-                    return stringsEqualIgnoreCase(selfBuffer, anOther);
-        }
+    enableLengthCache(actualLength);
 }
 
 
-bool String::equals(const char aChar, EqualityMode anEqualityMode) const
+void String::padCenter(int aLength, char aChar)
 {
-    if (isNull() || isEmpty())
-        return false;
-    else 
-    {
-        const char * buffer = rb();
+    if (aLength <= 0)
+        return;
 
-        if (anEqualityMode == caseSensitive)
-            return buffer[0] == aChar && buffer[1] == '\0';
-        else
-            return onToLower(buffer[0]) == onToLower(aChar) && buffer[1] == '\0';  
-    }
-}
+    int selfLength = self.length();
 
+    if (aLength <= selfLength)
+        return;
 
+    int paddingLength = aLength - selfLength;
+    int leftPaddingLength = paddingLength / 2;
+    int rightPaddingLength = leftPaddingLength + paddingLength % 2;
 
+    char * buffer = wb(aLength);
+    memmove(buffer + leftPaddingLength, buffer, selfLength);
+    memset(buffer, aChar, leftPaddingLength);
+    memset(buffer + leftPaddingLength + selfLength, aChar, rightPaddingLength);
+    buffer[aLength] = '\0';
 
+    int actualLength;
 
-// Searching //////////////////////////////////////////////////////////////////////////////////////////////////////////
+    if (aChar)
+        actualLength = aLength;
+    else
+        actualLength = csUnknown;
 
-int String::indexOf(const char * aCSubstring, EqualityMode aMode, int aStartIndex) const
-{
-    if (isNull() || !aCSubstring || aStartIndex > length())
-        return notFound;
+    enableLengthCache(actualLength);
+}
 
-    if (aStartIndex < 0)
-        aStartIndex = 0;
 
-    const char * buffer = rb();
-    const char * position = findSubstring(buffer + aStartIndex, aCSubstring, aMode);
 
-    if (position)
-        return position - buffer;
-    else
-        return notFound;
-}
 
 
-int String::indexOf(char aChar, EqualityMode aMode, int aStartIndex) const
+// Reversing //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void String::reverse()
 {
-    if (aStartIndex < 0)
-        aStartIndex = 0;
+    int selfLength = length();
 
-    if (aStartIndex >= length())
-        return notFound;
+    if (selfLength < 2)  
+        return;
 
-    const char * firstChar = rb();
+    char * beginning = wb();
+    char * end = beginning + selfLength - 1;
 
-    const char * position;
-    if (aMode == caseSensitive)
-        position = strchr(firstChar + aStartIndex, aChar);
-    else
-        position = strichr(firstChar + aStartIndex, aChar);
+    while (beginning < end)
+    {
+        char temp = *beginning;
+        *beginning = *end;
+        *end = temp;
 
-    if (position && *position)     // terminating char is not part of the string
-        return position - firstChar;
-    else
-        return notFound;
+        beginning++;
+        end--;
+    }
+
+    enableLengthCache(selfLength);
 }
 
 
-int String::indexOfAnyCharBy(ParameterizedCharTestFunction aTestFunction, void * aTestParameter, int aStartIndex) const
-{
-    if (!aTestFunction)
-        return notFound;
 
-    if (aStartIndex < 0)
-        aStartIndex = 0;
 
-    if (aStartIndex >= length()) // null, empty, beyond end
-        return notFound;
 
-    const char * firstChar = rb();
-    const char * testedChar = firstChar + aStartIndex;
+// Formatting /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    while (*testedChar)
-    {
-        if (aTestFunction(*testedChar, aTestParameter)) 
-            return testedChar - firstChar;
-        testedChar++;
-    }
+String String::formattedList(const char * aFormat, va_list anArguments)
+{
+    if (!aFormat)
+        return null;
 
-    return notFound;
+    String result;
+    result.appendFormattedList(aFormat, anArguments);
+    return result;
 }
 
 
-int String::indexOfAnyChar(CharTestCondition aCondition, const char * aChars, int aStartIndex) const
+String String::formatted(const char * aFormat, ...)
 {
-    return indexOfAnyCharBy(checkingFunctionFor(aCondition), (void *)aChars, aStartIndex);
+    va_list arguments;
+    
+    va_start(arguments, aFormat);
+        String result = String::formattedList(aFormat, arguments);
+    va_end(arguments);
+    
+    return result;
 }
 
 
-int String::indexOfAnyCharWhere(CharTestFunction aTestFunction, bool aTestResult, int aStartIndex) const
-{
-    return indexOfAnyCharBy(checkingFunctionFor(aTestFunction, aTestResult), (void *)aTestFunction, aStartIndex);
-} 
-
+// Formatting by Format Literal (see macro lf) ////////////////////////////////////////////////////////////////////////
 
+static const char decimalDigitPairs[] = 
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
 
 
+static const char nullArgumentText[] = "(null)";  // same as printf of NULL C string 
 
-// Containing substring / character ///////////////////////////////////////////////////////////////////////////////////
 
-bool String::containsOnlyChars(CharTestCondition aCondition, const char * aChars) const
+static inline int decimalDigitCount(unsigned long long aNumber)
 {
-    if (isEmpty() || isNull())
-        return false;
-
-    if (!aChars)
-        aChars = "";
+    int count = 1;
 
-    if (aCondition == containedIn)
-        aCondition = notContainedIn;
-    else
-        aCondition = containedIn;
+    for (; aNumber >= 10000; aNumber /= 10000)
+        count += 4;
 
-    return indexOfAnyChar(aCondition, aChars, 0) == notFound;
+    return count + (aNumber >= 10) + (aNumber >= 100) + (aNumber >= 1000);
 }
 
 
-bool String::containsOnlyCharsWhere(CharTestFunction aTestFunction, bool aTestResult) const 
-{ 
-    if (!aTestFunction || isEmpty() || isNull())
-        return false;
-    else
-        return indexOfAnyCharWhere(aTestFunction, !aTestResult) == notFound; 
-}
+static inline int hexDigitCount(unsigned long long aNumber)
+{
+    int count = 1;
 
+    for (; aNumber >= 0x10000; aNumber >>= 16)
+        count += 4;
 
-bool String::containsAt(int anIndex, const char * aCSubstring, EqualityMode aMode) const
-{
-    if (isNull() || !aCSubstring || anIndex < 0 || anIndex > length())
-        return false;
+    return count + (aNumber >= 0x10) + (aNumber >= 0x100) + (aNumber >= 0x1000);
+}
 
-    const char * testedChar = aCSubstring;
-    const char * selfChar = rb() + anIndex;
 
-    if (aMode == caseSensitive)
-    {
-        while (*testedChar)
-            if (*testedChar++ != *selfChar++)
-                return false;
-    }
-    else
+// Returns count of characters of conversion body without padding to width.
+static inline ViewIndex formattedBodyLength(const _FormatItem & anItem, const _FormatArgument & anArgument)
+{
+    switch (anItem.conversion)
     {
-        while (*testedChar)
-            if (onToLower(*testedChar++) != onToLower(*selfChar++))
-                return false;
+        case 's': return anArgument.chars ? anArgument.length : (ViewIndex) sizeof(nullArgumentText) - 1;
+        case 'c': return 1;
+        case 'x': 
+        case 'X': return hexDigitCount(anArgument.bits);
+        default: return decimalDigitCount(anArgument.magnitude) + anArgument.isNegative;
     }
-
-    return true;
 }
 
 
-bool String::containsAt(int anIndex, char aChar, EqualityMode aMode) const
+static ViewIndex formattedItemsLength(const _FormatItem * anItems, int anItemCount, const _FormatArgument * anArguments)
 {
-    if (anIndex < 0 || anIndex >= length())
-        return false;
+    ViewIndex length = 0;
 
-    char testedChar = rb()[anIndex];
+    for (int i = 0; i < anItemCount; i++)
+        if (anItems[i].conversion == '\0')
+            length += anItems[i].textLength;
+        else
+        {
+            ViewIndex bodyLength = formattedBodyLength(anItems[i], *anArguments++);
+            length += bodyLength > anItems[i].width ? bodyLength : anItems[i].width;
+        }
 
-    if (aMode == caseSensitive)
-        return testedChar == aChar;
-    else
-        return onToLower(testedChar) == onToLower(aChar);
+    return length;
 }
 
 
-
-bool String::containsCharsAtBy(int anIndex, ParameterizedCharTestFunction aTestFunction, void * aTestParameter, int * oLength) const
+static char * writeDecimal(char * aBuffer, unsigned long long aNumber, ViewIndex aDigitCount)
 {
-    *oLength = 0;
+    char * position = aBuffer + aDigitCount;
 
-    if (!aTestFunction || anIndex < 0 || anIndex >= length())
-        return false;
-
-    const char * firstChar = rb() + anIndex;
-    const char * testedChar = firstChar;
-
-    while (*testedChar && aTestFunction(*testedChar, aTestParameter))
-        testedChar++;
+    while (aNumber >= 100)
+    {
+        const char * pair = decimalDigitPairs + (aNumber % 100) * 2;
+        aNumber /= 100;
+        *--position = pair[1];
+        *--position = pair[0];
+    }
 
-    *oLength = testedChar - firstChar;
+    if (aNumber >= 10)
+    {
+        *--position = decimalDigitPairs[aNumber * 2 + 1];
+        *--position = decimalDigitPairs[aNumber * 2];
+    }
+    else
+        *--position = (char) ('0' + aNumber);
 
-    return *oLength;
+    return aBuffer + aDigitCount;
 }
 
 
-bool String::containsCharsAt(int anIndex, CharTestCondition aCondition, const char * aChars, int * oLength) const
+static char * writeHex(char * aBuffer, unsigned long long aNumber, ViewIndex aDigitCount, const char * aDigits)
 {
-    return containsCharsAtBy(anIndex, checkingFunctionFor(aCondition), (void *)aChars, oLength);
-}
-
+    for (char * position = aBuffer + aDigitCount; position > aBuffer; aNumber >>= 4)
+        *--position = aDigits[aNumber & 0xF];
 
-bool String::containsCharsAtWhere(int anIndex, CharTestFunction aTestFunction, bool aTestResult, int * oLength) const
-{
-    return containsCharsAtBy(anIndex, checkingFunctionFor(aTestFunction, aTestResult), (void *)aTestFunction, oLength);
+    return aBuffer + aDigitCount;
 }
 
 
-bool String::containsAnyCharAtBy(int anIndex, ParameterizedCharTestFunction aTestFunction, void * aTestParameter) const
+static void writeFormattedItems(char * aBuffer, const char * aFormat, const _FormatItem * anItems, int anItemCount, const _FormatArgument * anArguments)
 {
-    return aTestFunction && anIndex >= 0 && anIndex < length() && aTestFunction(rb()[anIndex], aTestParameter);
-}
+    for (int i = 0; i < anItemCount; i++)
+    {
+        const _FormatItem & item = anItems[i];
 
+        if (item.conversion == '\0')
+        {
+            memcpy(aBuffer, aFormat + item.textStart, item.textLength);
+            aBuffer += item.textLength;
+            continue;
+        }
 
-bool String::containsAnyCharAt(int anIndex, CharTestCondition aCondition, const char * aChars) const 
-{
-    return containsAnyCharAtBy(anIndex, checkingFunctionFor(aCondition), (void *)aChars);
-}
+        const _FormatArgument & argument = *anArguments++;
+        ViewIndex bodyLength = formattedBodyLength(item, argument);
+        ViewIndex paddingLength = item.width > bodyLength ? item.width - bodyLength : 0;
+        bool isNumber = item.conversion != 's' && item.conversion != 'c';
+        bool isZeroPadded = item.isZeroPadded && !item.isLeftJustified && isNumber;
 
+        if (paddingLength > 0 && !item.isLeftJustified && !isZeroPadded)
+        {
+            memset(aBuffer, ' ', paddingLength);
+            aBuffer += paddingLength;
+        }
 
-bool String::containsAnyCharAtWhere(int anIndex, CharTestFunction aTestFunction, bool aTestResult) const
-{
-    return containsAnyCharAtBy(anIndex, checkingFunctionFor(aTestFunction, aTestResult), (void *) aTestFunction);
+        switch (item.conversion)
+        {
+            case 's': 
+                memcpy(aBuffer, argument.chars ? argument.chars : nullArgumentText, bodyLength);
+                aBuffer += bodyLength;
+                break;
+
+            case 'c': 
+                *aBuffer++ = argument.character;
+                break;
+
+            default:
+                if (argument.isNegative && item.conversion != 'x' && item.conversion != 'X')
+                {
+                    *aBuffer++ = '-';
+                    bodyLength--;
+                }
+
+                if (paddingLength > 0 && isZeroPadded)
+                {
+                    memset(aBuffer, '0', paddingLength);
+                    aBuffer += paddingLength;
+                }
+
+                if (item.conversion == 'x')
+                    aBuffer = writeHex(aBuffer, argument.bits, bodyLength, "0123456789abcdef");
+                else if (item.conversion == 'X')
+                    aBuffer = writeHex(aBuffer, argument.bits, bodyLength, "0123456789ABCDEF");
+                else
+                    aBuffer = writeDecimal(aBuffer, argument.magnitude, bodyLength);
+        }
+
+        if (paddingLength > 0 && item.isLeftJustified)
+        {
+            memset(aBuffer, ' ', paddingLength);
+            aBuffer += paddingLength;
+        }
+    }
 }
 
 
+// Returns true if any text argument points into range of characters from aStart to anEnd.
+static bool argumentsOverlap(const _FormatItem * anItems, int anItemCount, const _FormatArgument * anArguments, const char * aStart, const char * anEnd)
+{
+    for (int i = 0; i < anItemCount; i++)
+        if (anItems[i].conversion != '\0')
+        {
+            const _FormatArgument & argument = *anArguments++;
 
+            if (anItems[i].conversion == 's' && argument.chars && argument.chars + argument.length >= aStart && argument.chars <= anEnd)
+                return true;
+        }
 
+    return false;
+}
 
-// Substrings /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-String String::substringFrom(int aStartIndex, int aLength) const
+void String::appendFormattedItems(const char * aFormat, const _FormatItem * anItems, int anItemCount, const _FormatArgument * anArguments)
 {
-    if (isNull())
-        return null;
+    if (!self.isNull() && argumentsOverlap(anItems, anItemCount, anArguments, self.rb(), self.rb() + self.length()))
+    {
+        String formatted;  // the argument would be invalidated by reallocation of own buffer
+        formatted.appendFormattedItems(aFormat, anItems, anItemCount, anArguments);
+        append(formatted);
+        return;
+    }
 
-    if (isEmpty())
-        return empty;
+    ViewIndex formattedLength = formattedItemsLength(anItems, anItemCount, anArguments);
 
-    if (aStartIndex < 0)
+    if (formattedLength == 0)  // prevent reallocation (calling wb) unless there is change
     {
-        aLength += aStartIndex;
-        aStartIndex = 0;
+        if (self.isNull()) 
+            setInner("");
+        return;
     }
 
-    if (aLength <= 0)
-        return empty;
+    int selfLength = self.length();
+    int newLength = stringLengthOf(selfLength + formattedLength);
 
-    int selfLength = length();
+    char * buffer = wb(newLength);
+    writeFormattedItems(buffer + selfLength, aFormat, anItems, anItemCount, anArguments);
+    buffer[newLength] = '\0';
 
-    if (aStartIndex >= selfLength)
-        return empty;
+    enableLengthCache(newLength);
+}
 
-    if (aStartIndex + aLength > selfLength)
-        aLength = selfLength - aStartIndex;
 
-    if (aStartIndex == 0 && aLength == selfLength)
-        return self;
 
-    return String(rb() + aStartIndex, aLength);
-}
 
 
-String String::substringOfCharsBy(int aStartIndex, ParameterizedCharTestFunction aTestFunction, void * aTestParameter) const
+// String Of Characters ///////////////////////////////////////////////////////////////////////////////////////////////
+String String::ofChar(char aChar, int aCount)
 {
-    if (isNull())
-        return null;
-
-    if (!aTestFunction || isEmpty() || aStartIndex >= length())
+    if (aCount < 1)
         return empty;
+    
+    if (aCount == 1)
+        return String(aChar);
 
-    int substringLength;    
-    if (containsCharsAtBy(aStartIndex, aTestFunction, aTestParameter, &substringLength))
-        return substringFrom(aStartIndex, substringLength);
-    else
-        return empty;
-}
+    String result = String::withCapacity(aCount);
+    
+    char * buffer = result.wb();
+    memset(buffer, aChar, aCount);
+    buffer[aCount] = '\0';
 
+    result.enableLengthCache(aChar ? aCount : 0);
 
-String String::substringOfCharsAt(int aStartIndex, CharTestCondition aCondition, const char * aChars) const
-{   
-    return substringOfCharsBy(aStartIndex, checkingFunctionFor(aCondition), (void *)aChars);
+    return result;
 }
 
 
-String String::substringOfCharsAtWhere(int aStartIndex, CharTestFunction aTestFunction, bool aTestResult) const
-{
-    return substringOfCharsBy(aStartIndex, checkingFunctionFor(aTestFunction, aTestResult), (void *)aTestFunction);
-}
-
-            
 
 
 
-// Testing Suffex /////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parsing ////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool String::hasSuffix(const char * aCSubstring, EqualityMode aMode) const
+// Finds next part of aChars starting at *ioCharIndex (see String::nextPart for the rules) and sets *ioCharIndex after it.
+// Content of the part is passed to ioContent: method begin(index, quotationChar) is called when the content starts by quotation 
+// character (characters before it are not part of content) and method append(index, length) for each block of the content.
+template <typename Content>
+bool scanPart(const char * aChars, ViewIndex aLength, ViewIndex * ioCharIndex, const CharSet & isDelimiter, const CharSet & isQuotation, bool anIgnoreEmpty, Content & ioContent)
 {
-    if (!aCSubstring)
+    if (*ioCharIndex >= aLength)  // also empty or NULL text
         return false;
 
-    int selfLength = length();
-    int otherLength = strlen(aCSubstring);
+    if (*ioCharIndex < 0)
+        *ioCharIndex = 0;
 
-    return otherLength <= selfLength && containsAt(selfLength - otherLength, aCSubstring, aMode);
-}
+    ViewIndex index = *ioCharIndex;
 
+    ViewIndex blockLength;
+    bool tokenIsQuoted;
+    bool tokenIsEmpty = true;
+    bool tokenIsDelimited = false;
 
-bool String::hasSuffix(char aChar, EqualityMode aMode) const
-{
-    int selfLength = length();
-    return selfLength && containsAt(selfLength-1, aChar, aMode);
-}
+    auto isNotControl = [&](char aChar) { return !isDelimiter(aChar) && !isQuotation(aChar); };
 
+    do {
+        if (( blockLength = _lengthOfCharsBy(aChars, aLength, index, isNotControl) ))
+        {
+            ioContent.append(index, blockLength);
+            index += blockLength;
+            tokenIsEmpty = false;
+        }
 
+        tokenIsQuoted = false;
 
+        while (index < aLength && isQuotation(aChars[index]))
+        {
+            char quotationChar = aChars[index];
+            auto isNotQuotation = [=](char aChar) { return aChar != quotationChar; };
 
+            index += 1;
 
-// Inserting //////////////////////////////////////////////////////////////////////////////////////////////////////////
+            if (!tokenIsQuoted)  // part content is only text between quotation characters
+            {
+                ioContent.begin(index, quotationChar);
+                tokenIsEmpty = true;
+                tokenIsQuoted = true;
+            }
 
-void String::insertAt(int anIndex, const String aString)
-{
-    if (aString.isNull())
-        return;
+            bool doubleQuoted = false;
 
-    if ((self.isEmpty() || self.isNull()) && data.asFields.mode != smAllocation)
-    {
-        retain(aString);
-        return;
-    }
+            do {
+                if (( blockLength = _lengthOfCharsBy(aChars, aLength, index, isNotQuotation) ))
+                {
+                    ioContent.append(index, blockLength);
+                    index += blockLength;
+                    tokenIsEmpty = false;
+                }
 
-    int otherLength = aString.length();  
+                if (index < aLength && aChars[index] == quotationChar)
+                    index += 1;
 
-    if (otherLength == 0)  // prevent reallocation (call wb) when there is nothing to insert 
-        return;
+                doubleQuoted = index < aLength && aChars[index] == quotationChar;  // two consecutive quotation characters
+                if (doubleQuoted)
+                {
+                    ioContent.append(index, 1);  // resulting in one quoting character in part
+                    index += 1;
+                    tokenIsEmpty = false;
+                }
 
-    int selfLength = length();
+            } while (doubleQuoted);
 
-    if (anIndex > selfLength)
-        anIndex = selfLength;
+            index += _lengthOfCharsBy(aChars, aLength, index, isNotControl);  // skip characters after quotation character
+        }
 
-    if (anIndex < 0)
-        anIndex = 0;
+        if (index < aLength && isDelimiter(aChars[index]))
+        {
+            index += 1;
+            tokenIsDelimited = true;
+        }
 
-    int newLength = selfLength + otherLength;
+    } while (anIgnoreEmpty && tokenIsEmpty && !tokenIsQuoted && index < aLength);
 
-    char * buffer = wb(newLength);
-    memmove(buffer + anIndex + otherLength, buffer + anIndex, selfLength - anIndex + 1);
-    memcpy(buffer + anIndex, aString.rb(), otherLength);
-    enableLengthCache(newLength);
+    *ioCharIndex = index;
+
+    return !tokenIsEmpty || tokenIsQuoted || (tokenIsDelimited && !anIgnoreEmpty);
 }
 
 
-void String::insertAt(int anIndex, const char * aCString)
+// Content of part for scanPart which only remembers bounds of the content.
+// The content is verbatim if it is one continuous block of characters (it isn't when there are doubled quotation characters or more quoted sections).
+struct PartBounds
 {
-    if (!aCString)
-        return;
+    ViewIndex start = -1;
+    ViewIndex end = 0;
+    char quotationChar = '\0';
+    bool isVerbatim = true;
 
-    int otherLength = strlen(aCString);  
+    inline void begin(ViewIndex anIndex, char aQuotationChar)
+    {
+        start = end = anIndex;
+        quotationChar = aQuotationChar;
+    }
 
-    if ((self.isEmpty() || self.isNull()) && data.asFields.mode != smAllocation)
+    inline void append(ViewIndex anIndex, ViewIndex aLength)
     {
-        setBuffer(otherLength);
-        copyFrom(aCString, otherLength);
-        return;
+        if (start < 0)
+            start = anIndex;
+        else
+            if (anIndex != end)
+                isVerbatim = false;
+
+        end = anIndex + aLength;
     }
 
-    if (otherLength == 0)  // prevent reallocation (call wb) when there is nothing to insert 
-        return;
+    inline StringView view(const char * aChars, ViewIndex aDefaultStart) const
+    {
+        if (start < 0)
+            return StringView(aChars + aDefaultStart, 0);
+        else
+            return StringView(aChars + start, end - start);
+    }
+};
 
-    int selfLength = length();
 
-    if (anIndex > selfLength)
-        anIndex = selfLength;
+// Content of part for scanPart which copies the content to a buffer (the buffer must be large enough for all characters from start of scanning to end of the content).
+struct PartBuilder
+{
+    const char * source;
+    char * buffer;
+    int length;
 
-    if (anIndex < 0)
-        anIndex = 0;
+    inline void begin(ViewIndex, char)
+    {
+        length = 0;
+    }
 
-    int newLength = selfLength + otherLength;
+    inline void append(ViewIndex anIndex, ViewIndex aLength)
+    {
+        memcpy(buffer + length, source + anIndex, aLength);
+        length += (int) aLength;
+    }
+};
 
-    char * buffer = wb(newLength);
-    memmove(buffer + anIndex + otherLength, buffer + anIndex, selfLength - anIndex + 1);
-    memcpy(buffer + anIndex, aCString, otherLength);
-    enableLengthCache(newLength);
-}
 
-       
-void String::insertAt(int anIndex, char aChar)
+// Content of part for scanPart when the content is not needed.
+struct PartSkipper
 {
-    int selfLength = length();
+    inline void begin(ViewIndex, char) {}
+    inline void append(ViewIndex, ViewIndex) {}
+};
 
-    if (anIndex > selfLength)
-        anIndex = selfLength;
 
-    if (anIndex < 0)
-        anIndex = 0;
 
-    int newLength;
-    char * buffer;
+int String::partCount(const ParsingContext & aContext) const
+{
+    return partCount(aContext.delimiterChars.rb(), aContext.quotingChars.rb(), aContext.ignoreEmpty);
+}
 
-    if (aChar == '\0')
-    {
-        if (!isNull() && anIndex == selfLength) // prevent reallocation (calling wb) unless there is change
-            return;
 
-        newLength = anIndex;
-        buffer = wb(newLength);
-    }
-    else
-    {
-        newLength = selfLength + 1;
-        buffer = wb(newLength);
-        memmove(buffer + anIndex + 1, buffer + anIndex, selfLength - anIndex + 1);
-    }
+int String::partCount(const char * aDelimiterChars, const char * aQuotationChars, bool anIgnoreEmpty) const
+{
+    int partCount = 0;
+    int charIndex = 0;
 
-    buffer[anIndex] = aChar;
-    enableLengthCache(newLength);
+    while (nextPart(NULL, &charIndex, aDelimiterChars, aQuotationChars, anIgnoreEmpty))
+        partCount++;
+
+    return partCount;
 }
 
 
-void String::insertFormattedAt(int anIndex, const char * aFormat, ...)
+String String::part(int aPartIndex, const ParsingContext & aContext) const
 {
-    va_list arguments;
-    va_start(arguments, aFormat);
-        insertFormattedListAt(anIndex, aFormat, arguments);
-    va_end(arguments);
+    return part(aPartIndex, aContext.delimiterChars.rb(), aContext.quotingChars.rb(), aContext.ignoreEmpty);
 }
 
 
-void String::insertFormattedListAt(int anIndex, const char * aFormat, va_list anArguments)
+String String::part(int aPartIndex, const char * aDelimiterChars, const char * aQuotationChars, bool anIgnoreEmpty) const
 {
-    if (!aFormat)
-        return;
+    if (aPartIndex < 0)
+        return empty;
 
-    va_list arguments;
+    int charIndex = 0;
 
-    va_copy(arguments, anArguments);
-        int formattedLength = vsnprintf(NULL, 0, aFormat, arguments);
-        debug_assert(formattedLength >= 0);
-    va_end(arguments);
-      
-    if (formattedLength == 0)  // prevent reallocation (calling wb) unless there is change
+    int currentPartIndex = 0;
+    while (currentPartIndex < aPartIndex && nextPart(NULL, &charIndex, aDelimiterChars, aQuotationChars, anIgnoreEmpty))
+        currentPartIndex++;
+
+    String result;
+    nextPart(&result, &charIndex, aDelimiterChars, aQuotationChars, anIgnoreEmpty);
+
+    return result;
+}
+
+
+bool String::nextPart(String * oPart, ParsingContext * aContext) const
+{
+    if (aContext->charIndex >= length())  // index after the end of the string is kept unchanged
     {
-        if (isNull())
-            setInner("");
-        return;
+        if (oPart)
+            *oPart = empty;
+
+        return false;
     }
 
-    int selfLength = length();
+    int charIndex = aContext->charIndex < 0 ? 0 : (int) aContext->charIndex;
+    bool found = nextPart(oPart, &charIndex, aContext->delimiterChars.rb(), aContext->quotingChars.rb(), aContext->ignoreEmpty);
 
-    if (anIndex > selfLength)
-        anIndex = selfLength;
+    aContext->charIndex = charIndex;
+    return found;
+}
 
-    if (anIndex < 0)
-        anIndex = 0;
 
-    int newLength = selfLength + formattedLength;
+bool String::nextPart(String * oPart, int * ioCharIndex, const char * aDelimiterChars, const char * aQuotationChars, bool anIgnoreEmpty) const
+{
+    if (oPart)
+        *oPart = empty;
 
-    char * buffer = wb(newLength);
-    memmove(buffer + anIndex + formattedLength, buffer + anIndex, selfLength - anIndex + 1);
+    int selfLength = self.length();  
 
-    char * formattedTerminatorPosition = buffer + anIndex + formattedLength;
-    char temp = *formattedTerminatorPosition;  // save character at position of terminator of formatted string
+    if (*ioCharIndex >= selfLength)  // also isEmpty, isNull
+        return false;
 
-    va_copy(arguments, anArguments);
-        vsnprintf(buffer + anIndex, formattedLength + 1, aFormat, arguments);  // insert formatted string with terminator
-    va_end(arguments);
+    if (*ioCharIndex < 0)
+        *ioCharIndex = 0;
 
-    *formattedTerminatorPosition = temp;  // restore character at position of terminator of formatted string
+    CharSet isDelimiter(aDelimiterChars, containedIn);
+    CharSet isQuotation(aQuotationChars, containedIn);
 
-    enableLengthCache(newLength);
-}
+    const char * firstChar = rb();
+    ViewIndex startIndex = *ioCharIndex;
+    ViewIndex charIndex = startIndex;
+    PartBounds bounds;
 
+    bool found = scanPart(firstChar, selfLength, &charIndex, isDelimiter, isQuotation, anIgnoreEmpty, bounds);
+    *ioCharIndex = (int) charIndex;
 
+    if (!oPart || !found || bounds.start < 0 || bounds.end == bounds.start)
+        return found;
 
+    if (bounds.isVerbatim)
+        *oPart = String(firstChar + bounds.start, (int) (bounds.end - bounds.start));
+    else
+    {
+        String part = withCapacity((int) (bounds.end - startIndex));  // builder appends also characters before quotation character (they are discarded then)
+        PartBuilder builder = { firstChar, part.wb(), 0 };
 
+        scanPart(firstChar, selfLength, &startIndex, isDelimiter, isQuotation, anIgnoreEmpty, builder);
 
-// Ensuring Prefix / Suffix ///////////////////////////////////////////////////////////////////////////////////////////
+        builder.buffer[builder.length] = '\0';
+        part.enableLengthCache(builder.length);
 
-void String::ensurePrefix(const char * aSubstring, EqualityMode aMode)
-{
-    if (!hasPrefix(aSubstring, aMode))
-        insertAt(0, aSubstring);
+        *oPart = part;
+    }
+
+    return found;
 }
 
 
-void String::ensurePrefix(const char aChar, EqualityMode aMode)
-{
-    if (!hasPrefix(aChar, aMode))
-        insertAt(0, aChar);
-}
 
 
-void String::ensureSuffix(const char * aSubstring, EqualityMode aMode)
+
+
+
+// String View ////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+String StringView::toString() const
 {
-    if (!hasSuffix(aSubstring, aMode))
-        append(aSubstring);
+    if (isNull())
+        return String::null;
+    else
+        return String(fChars, stringLengthOf(fLength));
 }
 
 
-void String::ensureSuffix(const char aChar, EqualityMode aMode)
+StringView StringView::substringFrom(ViewIndex aStartIndex, ViewIndex aLength) const
 {
-    if (!hasSuffix(aChar, aMode))
-        append(aChar);
-}
+    if (isNull())
+        return StringView();
 
+    if (aStartIndex < 0)
+    {
+        aLength += aStartIndex;
+        aStartIndex = 0;
+    }
 
+    if (aLength <= 0 || aStartIndex >= fLength)
+        return StringView(fChars, 0);
 
+    if (aStartIndex + aLength > fLength)
+        aLength = fLength - aStartIndex;
 
+    return StringView(fChars + aStartIndex, aLength);
+}
 
-// Converting Case ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int (*String::onToLower)(int) = tolower;
+ViewIndex StringView::indexOf(StringView aSubstring, EqualityMode aMode, ViewIndex aStartIndex) const
+{
+    if (isNull() || aSubstring.isNull() || aStartIndex > fLength)
+        return notFound;
 
-int (*String::onToUpper)(int) = toupper;
+    if (aStartIndex < 0)
+        aStartIndex = 0;
 
+    const char * position = findChars(fChars + aStartIndex, fLength - aStartIndex, aSubstring.fChars, aSubstring.fLength, aMode);
 
-void String::convertTo(LetterCase aLetterCase)
-{
-    if (isEmpty() || isNull())
-        return;
+    if (position)
+        return position - fChars;
+    else
+        return notFound;
+}
 
-    const char * firstChar = rb();
-    const char * testedChar = firstChar;
 
-    if (aLetterCase == upperCase)
-        while (*testedChar && *testedChar == onToUpper(*testedChar)) testedChar++;
-    else
-        while (*testedChar && *testedChar == onToLower(*testedChar)) testedChar++;
+ViewIndex StringView::indexOf(char aChar, EqualityMode aMode, ViewIndex aStartIndex) const
+{
+    if (aStartIndex < 0)
+        aStartIndex = 0;
 
-    if (!*testedChar)  // prevent reallocation (calling wb) when there is nothing to convert
-        return;
+    if (aStartIndex >= fLength)
+        return notFound;
 
-    int startIndex = testedChar - firstChar;
+    const char * position = findChar(fChars + aStartIndex, fLength - aStartIndex, aChar, aMode);
 
-    char * writeBufferStart = wb();
-    char * convertedChar = writeBufferStart + startIndex;
-    
-    if (aLetterCase == upperCase)
-        do { *convertedChar = onToUpper(*convertedChar); } while (*(++convertedChar));
+    if (position)
+        return position - fChars;
     else
-        do { *convertedChar = onToLower(*convertedChar); } while (*(++convertedChar));
-
-    enableLengthCache(convertedChar - writeBufferStart);
+        return notFound;
 }
 
 
+ViewIndex StringView::indexOfAnyChar(CharTestCondition aCondition, StringView aChars, ViewIndex aStartIndex) const
+{
+    return _indexOfCharBy(fChars, fLength, aStartIndex, CharSet(aChars, aCondition));
+}
 
 
+ViewIndex StringView::indexOfAnyCharWhere(CharTestFunction aTestFunction, bool aTestResult, ViewIndex aStartIndex) const
+{
+    if (!aTestFunction)
+        return notFound;
+
+    return _indexOfCharBy(fChars, fLength, aStartIndex, CharTest{aTestFunction, aTestResult});
+}
 
-// Trimming ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void String::trimLeftCharsBy(ParameterizedCharTestFunction aTestFunction, void * aTestParameter)
+bool StringView::containsAt(ViewIndex anIndex, StringView aSubstring, EqualityMode aMode) const
 {
-    if (!aTestFunction || isEmpty() || isNull())  
-        return;
+    if (isNull() || aSubstring.isNull() || anIndex < 0 || anIndex > fLength)
+        return false;
 
-    const char * firstChar = rb();
-    const char * restChar = firstChar;
-    
-    while (*restChar && aTestFunction(*restChar, aTestParameter)) 
-        restChar++;
+    if (aSubstring.fLength > fLength - anIndex)
+        return false;
 
-    if (restChar != firstChar)  // prevent reallocation (calling wb) when there is nothing to trim
-        removeFrom(0, restChar - firstChar);
+    return charsEqual(fChars + anIndex, aSubstring.fChars, aSubstring.fLength, aMode);
 }
 
 
-void String::trimLeftChars(CharTestCondition aCondition, const char * aChars)
+bool StringView::containsAt(ViewIndex anIndex, char aChar, EqualityMode aMode) const
 {
-    trimLeftCharsBy(checkingFunctionFor(aCondition), (void *) aChars);
+    if (anIndex < 0 || anIndex >= fLength)
+        return false;
+
+    if (aMode == caseSensitive)
+        return fChars[anIndex] == aChar;
+    else
+        return String::onToLower(fChars[anIndex]) == String::onToLower(aChar);
 }
 
 
-void String::trimLeftCharsWhere(CharTestFunction aTestFunction, bool aTestResult)
+bool StringView::containsCharsAt(ViewIndex anIndex, CharTestCondition aCondition, StringView aChars, ViewIndex * oLength) const
 {
-    trimLeftCharsBy(checkingFunctionFor(aTestFunction, aTestResult), (void *)aTestFunction);
-}
+    *oLength = 0;
 
+    if (anIndex < 0 || anIndex >= fLength)
+        return false;
 
-void String::trimRightCharsBy(ParameterizedCharTestFunction aTestFunction, void * aTestParameter)
-{
-    if (!aTestFunction || isEmpty() || isNull())  
-        return;
+    *oLength = _lengthOfCharsBy(fChars, fLength, anIndex, CharSet(aChars, aCondition));
 
-    int currentLength = length();
+    return *oLength != 0;
+}
 
-    if (!aTestFunction(rb()[currentLength-1], aTestParameter))  // prevent reallocation (calling wb) when there is nothing to trim
-        return;
 
-    char * firstChar = wb();
-    char * lastChar = firstChar + currentLength - 1;
+bool StringView::containsCharsAtWhere(ViewIndex anIndex, CharTestFunction aTestFunction, bool aTestResult, ViewIndex * oLength) const
+{
+    *oLength = 0;
 
-    while (lastChar >= firstChar && aTestFunction(*lastChar, aTestParameter))
-        lastChar--;
+    if (!aTestFunction)
+        return false;
 
-    *(lastChar + 1) = '\0';
+    *oLength = _lengthOfCharsBy(fChars, fLength, anIndex, CharTest{aTestFunction, aTestResult});
 
-    enableLengthCache(lastChar - firstChar + 1);
+    return *oLength != 0;
 }
 
 
-void String::trimRightChars(CharTestCondition aCondition, const char * aChars)
+bool StringView::containsAnyCharAt(ViewIndex anIndex, CharTestCondition aCondition, StringView aChars) const
 {
-    return trimRightCharsBy(checkingFunctionFor(aCondition), (void *)aChars);
+    return anIndex >= 0 && anIndex < fLength && CharSet(aChars, aCondition)(fChars[anIndex]);
 }
 
 
-void String::trimRightCharsWhere(CharTestFunction aTestFunction, bool aTestResult)
+bool StringView::containsAnyCharAtWhere(ViewIndex anIndex, CharTestFunction aTestFunction, bool aTestResult) const
 {
-    trimRightCharsBy(checkingFunctionFor(aTestFunction, aTestResult), (void *)aTestFunction);
+    return aTestFunction && anIndex >= 0 && anIndex < fLength && CharTest{aTestFunction, aTestResult}(fChars[anIndex]);
 }
 
 
-void String::trimWhitespace()
+bool StringView::equals(StringView anOther, EqualityMode aMode) const
 {
-    trimRightCharsWhere(isspace, true);
-    trimLeftCharsWhere(isspace, true);
-}
+    if (isNull() || anOther.isNull())
+        return isNull() && anOther.isNull();
 
+    if (fLength != anOther.fLength)
+        return false;
 
+    if (fChars == anOther.fChars)
+        return true;
 
+    return charsEqual(fChars, anOther.fChars, fLength, aMode);
+}
 
 
-// Removing by Index //////////////////////////////////////////////////////////////////////////////////////////////////
+bool StringView::equals(char aChar, EqualityMode aMode) const
+{
+    return fLength == 1 && containsAt(0, aChar, aMode);
+}
 
-void String::removeFrom(int aStartIndex, int aLength)
+
+int StringView::compare(StringView anOther, EqualityMode aMode) const
 {
-    if (isEmpty() || isNull())
-        return;
+    if (isNull() || anOther.isNull())
+        return (int) anOther.isNull() - (int) isNull();
 
-    if (aStartIndex < 0)
+    ViewIndex length = fLength < anOther.fLength ? fLength : anOther.fLength;
+
+    if (aMode == caseSensitive)
     {
-        aLength += aStartIndex;
-        aStartIndex = 0;
-    }
+        int result = memcmp(fChars, anOther.fChars, length);
 
-    if (aLength <= 0)
-        return;
+        if (result != 0)
+            return result;
+    }
+    else
+        for (ViewIndex i = 0; i < length; i++)
+        {
+            int result = String::onToLower((unsigned char) fChars[i]) - String::onToLower((unsigned char) anOther.fChars[i]);
 
-    int selfLength = length();
+            if (result != 0)
+                return result;
+        }
 
-    if (aStartIndex >= selfLength)
-        return;
+    return (fLength > anOther.fLength) - (fLength < anOther.fLength);
+}
 
-    if (aStartIndex + aLength > selfLength)
-        aLength = selfLength - aStartIndex;
 
-    char * buffer = wb();
+unsigned int StringView::hash() const
+{
+    return hashOfChars(fChars, fLength);
+}
 
-    if (aLength == selfLength)
-        buffer[aStartIndex] = '\0';
-    else
-        memmove(buffer + aStartIndex, buffer + aStartIndex + aLength, selfLength - aStartIndex - aLength + 1);
 
-    enableLengthCache(selfLength - aLength);
+bool StringView::nextPart(StringView * oPart, ParsingContext * aContext) const
+{
+    return nextPart(oPart, &(aContext->charIndex), aContext->delimiterChars, aContext->quotingChars, aContext->ignoreEmpty);
 }
 
 
+bool StringView::nextPart(StringView * oPart, ViewIndex * ioCharIndex, StringView aDelimiterChars, StringView aQuotationChars, bool anIgnoreEmpty) const
+{
+    if (*ioCharIndex >= fLength)  // also isEmpty, isNull
+    {
+        if (oPart)
+            *oPart = StringView(fChars, 0);
 
+        return false;
+    }
 
+    if (*ioCharIndex < 0)
+        *ioCharIndex = 0;
 
-// Removing Prefix / Suffix ///////////////////////////////////////////////////////////////////////////////////////////
+    ViewIndex startIndex = *ioCharIndex;
+    PartBounds bounds;
 
-void String::removePrefix(const char * aCSubstring, EqualityMode aMode)
-{
-    if (hasPrefix(aCSubstring, aMode))
-        removeFrom(0, strlen(aCSubstring));
-}
+    bool found = scanPart(fChars, fLength, ioCharIndex, CharSet(aDelimiterChars, containedIn), CharSet(aQuotationChars, containedIn), anIgnoreEmpty, bounds);
 
+    if (oPart)
+        *oPart = bounds.view(fChars, startIndex);
 
-void String::removePrefix(const char aChar, EqualityMode aMode)
-{
-    if (hasPrefix(aChar, aMode))
-        removeFrom(0, 1);
+    return found;
 }
 
 
-void String::removeSuffix(const char * aCSubstring, EqualityMode aMode)
+void StringView::split(StringParts * oParts, const ParsingContext & aContext) const
 {
-    if (hasSuffix(aCSubstring, aMode))
-    {
-        int substringLength = strlen(aCSubstring);
-        removeFrom(self.length() - substringLength, substringLength);
-    }
+    split(oParts, aContext.delimiterChars, aContext.quotingChars, aContext.ignoreEmpty);
 }
 
 
-void String::removeSuffix(const char aChar, EqualityMode aMode)
+void StringView::split(StringParts * oParts, StringView aDelimiterChars, StringView aQuotationChars, bool anIgnoreEmpty) const
 {
-    if (hasSuffix(aChar, aMode))
-        removeFrom(length() - 1, 1);
-}
+    oParts->clear();
 
+    StringView quotationChars = oParts->keepQuotationChars(aQuotationChars);
 
+    CharSet isDelimiter(aDelimiterChars, containedIn);
+    CharSet isQuotation(quotationChars, containedIn);
 
+    ViewIndex charIndex = 0;
 
+    while (true)
+    {
+        ViewIndex startIndex = charIndex;
+        PartBounds bounds;
 
-// Removing Characters ////////////////////////////////////////////////////////////////////////////////////////////////
+        if (!scanPart(fChars, fLength, &charIndex, isDelimiter, isQuotation, anIgnoreEmpty, bounds))
+            break;
 
-void String::removeCharsBy(ParameterizedCharTestFunction aTestFunction, void * aTestParameter, int aStartIndex)
-{
-    if (!aTestFunction)
-        return;
+        StringPart part;
+        part.text = bounds.view(fChars, startIndex);
+        part.quotationChar = bounds.quotationChar;
+        part.isVerbatim = bounds.isVerbatim;
+        part.quotationChars = quotationChars;
 
-    if (aStartIndex < 0)
-        aStartIndex = 0;
+        oParts->append(part);
+    }
+}
 
-    if (aStartIndex >= length())  // isNull, isEmpty
-        return;
 
-    const char * rbFirstChar = rb();
-    const char * searchedChar = rbFirstChar + aStartIndex;
-    
-    while (*searchedChar && !aTestFunction(*searchedChar, aTestParameter)) 
-        searchedChar++;
-    
-    if (*searchedChar == '\0')  // prevent reallocation (calling wb) when there is nothing to remove 
-        return;
+int StringView::partCount(const ParsingContext & aContext) const
+{
+    return partCount(aContext.delimiterChars, aContext.quotingChars, aContext.ignoreEmpty);
+}
 
-    aStartIndex = searchedChar - rbFirstChar;  // begin at the first removable character
 
-    char * wbFirstChar = wb();
-    char * testedChar = wbFirstChar + aStartIndex;
-    char * lastChar = testedChar;
+int StringView::partCount(StringView aDelimiterChars, StringView aQuotationChars, bool anIgnoreEmpty) const
+{
+    CharSet isDelimiter(aDelimiterChars, containedIn);
+    CharSet isQuotation(aQuotationChars, containedIn);
+    PartSkipper skipper;
 
-    while (*testedChar)
-        if (aTestFunction(*testedChar, aTestParameter))
-            testedChar++;
-        else
-        {
-            *lastChar = *testedChar;
-            testedChar++;
-            lastChar++;
-        }
+    int partCount = 0;
+    ViewIndex charIndex = 0;
 
-    *lastChar = '\0';
+    while (scanPart(fChars, fLength, &charIndex, isDelimiter, isQuotation, anIgnoreEmpty, skipper))
+        partCount++;
 
-    enableLengthCache(lastChar - wbFirstChar);
+    return partCount;
 }
 
 
-void String::remove(char aChar, EqualityMode aMode, int aStartIndex)
+StringView StringView::part(int aPartIndex, const ParsingContext & aContext) const
 {
-    if (aMode == caseSensitive || !isalpha(aChar))
-    {
-        char chars[] = { aChar, '\0' };
-        removeCharsBy(charIsContainedIn, (void *) &chars, aStartIndex);
-    }
-    else
-    {
-        char chars[] = { (char)onToLower(aChar), (char)onToUpper(aChar), '\0' };
-        removeCharsBy(charIsContainedIn, (void *) &chars, aStartIndex);
-    }
-} 
+    return part(aPartIndex, aContext.delimiterChars, aContext.quotingChars, aContext.ignoreEmpty);
+}
 
 
-void String::removeChars(CharTestCondition aCondition, const char * aChars, int aStartIndex)
+StringView StringView::part(int aPartIndex, StringView aDelimiterChars, StringView aQuotationChars, bool anIgnoreEmpty) const
 {
-    removeCharsBy(checkingFunctionFor(aCondition), (void *)aChars, aStartIndex);
-}
+    if (aPartIndex < 0)
+        return StringView(fChars, 0);
 
+    CharSet isDelimiter(aDelimiterChars, containedIn);
+    CharSet isQuotation(aQuotationChars, containedIn);
+    PartSkipper skipper;
 
-void String::removeCharsWhere(CharTestFunction aTestFunction, bool aTestResult, int aStartIndex)
-{
-    removeCharsBy(checkingFunctionFor(aTestFunction, aTestResult), (void *)aTestFunction, aStartIndex);
+    ViewIndex charIndex = 0;
+
+    int currentPartIndex = 0;
+    while (currentPartIndex < aPartIndex && scanPart(fChars, fLength, &charIndex, isDelimiter, isQuotation, anIgnoreEmpty, skipper))
+        currentPartIndex++;
+
+    ViewIndex startIndex = charIndex;
+    PartBounds bounds;
+    scanPart(fChars, fLength, &charIndex, isDelimiter, isQuotation, anIgnoreEmpty, bounds);
+
+    return bounds.view(fChars, startIndex);
 }
 
 
 
 
 
-// Replacing //////////////////////////////////////////////////////////////////////////////////////////////////////////
+// String Parts ///////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void String::replaceCharsBy(ParameterizedCharTestFunction aTestFunction, void * aTestParameter, char aSubstitute, int aStartIndex)
-{   
-    if (!aTestFunction || isEmpty() || isNull())
-        return;
+String StringPart::toString() const
+{
+    if (isVerbatim)
+        return text.toString();
 
-    if (aStartIndex < 0)
-        aStartIndex = 0;
+    // the text contains doubled quotation characters or more quoted sections which can use different quotation characters: 
+    // <content>["" <content>]...[" <skipped> ' <content>]..., so the content is built by scanning again from the quotation 
+    // character which precedes the text (the same way as String::nextPart does)
 
-    if (aStartIndex >= length())
-        return;
+    const char * chars = text.chars() - 1;
+    ViewIndex length = text.length() + 1;
+    ViewIndex index = 0;
 
-    const char * rbFirstChar = rb();
-    const char * foundAt = rbFirstChar + aStartIndex;
-    
-    while (*foundAt && !aTestFunction(*foundAt, aTestParameter)) 
-        foundAt++;
-    
-    if (*foundAt == '\0')  // prevent reallocation (calling wb) when there is nothing to replace 
-        return;
+    String result = String::withCapacity(stringLengthOf(text.length()));
+    PartBuilder builder = { chars, result.wb(), 0 };
 
-    int foundAtIndex = foundAt - rbFirstChar;  // begin at the first character to replace
+    scanPart(chars, length, &index, CharSet(StringView(), containedIn), CharSet(quotationChars, containedIn), false, builder);
 
-    char * wbFirstChar = wb();
-    char * currentChar = wbFirstChar + foundAtIndex;
+    builder.buffer[builder.length] = '\0';
+    result.enableLengthCache(builder.length);
 
-    while (*currentChar)
-    {
-        if (aTestFunction(*currentChar, aTestParameter))
-            *currentChar = aSubstitute;
-        currentChar++;
-    }
+    return result;
+}
 
-    enableLengthCache(aSubstitute ? currentChar - wbFirstChar : csUnknown);
+
+StringParts::StringParts(): 
+    fParts(fInnerParts), fCount(0), fCapacity(innerCapacity), fQuotationChars(fInnerQuotationChars), fQuotationCapacity(innerQuotationCapacity)
+{
 }
 
 
-void String::replace(char anOriginal, char aSubstitute, EqualityMode aMode, int aStartIndex)
+StringParts::~StringParts()
 {
-    if (aMode == caseSensitive || !isalpha(anOriginal))
+    if (fParts != fInnerParts)
     {
-        char original[] = { anOriginal, '\0' };
-        replaceCharsBy(charIsContainedIn, (void *) &original, aSubstitute, aStartIndex);
+        free(fParts);
+        reportMemoryEvent(meRelease, fCapacity * sizeof(StringPart));
     }
-    else
+
+    if (fQuotationChars != fInnerQuotationChars)
     {
-        char original[] = { (char)onToLower(anOriginal), (char)onToUpper(anOriginal), '\0' };
-        replaceCharsBy(charIsContainedIn, (void *) &original, aSubstitute, aStartIndex);
-    }    
+        free(fQuotationChars);
+        reportMemoryEvent(meRelease, fQuotationCapacity);
+    }
 }
 
 
-void String::replaceChars(CharTestCondition aCondition, const char * aChars, char aSubstitute, int aStartIndex)
+void StringParts::append(const StringPart & aPart)
 {
-    replaceCharsBy(checkingFunctionFor(aCondition), (void *)aChars, aSubstitute, aStartIndex);
-}
+    if (fCount == fCapacity)
+    {
+        int newCapacity = fCapacity * 2;
+        size_t size = newCapacity * sizeof(StringPart);
 
+        StringPart * newParts = (StringPart *) (fParts == fInnerParts ? malloc(size) : realloc(fParts, size));
 
-void String::replaceCharsWhere(CharTestFunction aTestFunction, bool aTestResult, char aSubstitute, int aStartIndex)
-{
-    replaceCharsBy(checkingFunctionFor(aTestFunction, aTestResult), (void *)aTestFunction, aSubstitute, aStartIndex);
-}
+        if (!newParts)
+            String::onOutOfMemory(size);
 
+        if (fParts == fInnerParts)
+            reportMemoryEvent(meAllocation, size);
+        else
+            reportMemoryEvent(meReallocation, size, fCapacity * sizeof(StringPart));
 
-void String::replace(const char * anOriginal, const char * aSubstitute, EqualityMode aMode, int aStartIndex)
-{
-    if (isEmpty() || isNull() || !anOriginal || isEmptyCString(anOriginal))
-        return;
+        if (fParts == fInnerParts)
+            memcpy(newParts, fInnerParts, fCount * sizeof(StringPart));
 
-    int selfLength = self.length();
-    int originalLength = strlen(anOriginal);
+        fParts = newParts;
+        fCapacity = newCapacity;
+    }
 
-    if (aStartIndex < 0)
-        aStartIndex = 0;
+    fParts[fCount++] = aPart;
+}
 
-    int searchedLength = selfLength - aStartIndex;
-    if (searchedLength < originalLength)
-        return;
 
-    const char * rbFirstChar = rb(); 
-    const char * rbFoundAt = findSubstring(rbFirstChar + aStartIndex, anOriginal, aMode); 
+StringView StringParts::keepQuotationChars(StringView aQuotationChars)
+{
+    int length = (int) aQuotationChars.length();
 
-    if (!rbFoundAt)  // prevent reallocation (calling wb) when there is nothing to replace
-        return;
+    if (length > fQuotationCapacity)
+    {
+        char * newChars = (char *) malloc(length);
 
-    int foundAtIndex = rbFoundAt - rbFirstChar;
-    int substituteLength = aSubstitute ? strlen(aSubstitute) : 0;  // NULL is considered to be empty string
+        if (!newChars)
+            String::onOutOfMemory(length);
 
-    if (substituteLength == originalLength)
-    {
-        char * firstChar = wb();
-        char * foundAt = firstChar + foundAtIndex;
+        reportMemoryEvent(meAllocation, length);
 
-        do {
-            memmove(foundAt, aSubstitute, substituteLength);
-            foundAt += substituteLength;
-        } while (( foundAt = findSubstring(foundAt, anOriginal, aMode) )); 
+        if (fQuotationChars != fInnerQuotationChars)
+        {
+            free(fQuotationChars);
+            reportMemoryEvent(meRelease, fQuotationCapacity);
+        }
 
-        enableLengthCache(selfLength);
+        fQuotationChars = newChars;
+        fQuotationCapacity = length;
     }
-    else
-        if (substituteLength < originalLength)
-        {
-            char * firstChar = wb();
-            char * foundAt = firstChar + foundAtIndex;
 
-            char * writeTo = foundAt;
-            memmove(writeTo, aSubstitute, substituteLength);
-            writeTo += substituteLength;
+    if (length)
+        memmove(fQuotationChars, aQuotationChars.chars(), length);  // the chars can be the kept copy (e.g. of a part split again)
+
+    return StringView(fQuotationChars, length);
+}
+
 
-            foundAt += originalLength;
-            char * readFrom = foundAt;
 
-            while (( foundAt = findSubstring(foundAt, anOriginal, aMode) ))
-            {
-                int movedLength = foundAt - readFrom;
-                memmove(writeTo, readFrom, movedLength);
-                writeTo += movedLength;
 
-                memmove(writeTo, aSubstitute, substituteLength);
-                writeTo += substituteLength;
 
-                foundAt += originalLength;
-                readFrom = foundAt;
-            }
+// String Searcher ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-            int movedLength = (firstChar + selfLength) - readFrom;
-            memmove(writeTo, readFrom, movedLength);
-            writeTo += movedLength;
+StringSearcher::StringSearcher(StringView aSubstring, EqualityMode aMode):
+    fSubstring(aSubstring.toString()), fMode(aMode), fAsciiFolding(usesAsciiFolding()), fCriticalIndex(0), fPeriod(1), fIsPeriodic(false)
+{
+    if (aSubstring.length() < 2)
+        return;
 
-            *writeTo = '\0';
+    TwoWayFactorization factorization;
 
-            enableLengthCache(writeTo - firstChar);
-        }
+    if (aMode == caseSensitive)
+        factorization = factorize(aSubstring.chars(), aSubstring.length(), ExactChar());
+    else
+        if (fAsciiFolding)
+            factorization = factorize(aSubstring.chars(), aSubstring.length(), AsciiFoldedChar());
         else
-        {
-            int increment = substituteLength - originalLength;   
-            int newLength = selfLength;         
+            factorization = factorize(aSubstring.chars(), aSubstring.length(), HookFoldedChar());
 
-            do {
-                newLength += increment;
-                rbFoundAt += originalLength;
-            } while (( rbFoundAt = findSubstring(rbFoundAt, anOriginal, aMode) ));
+    fCriticalIndex = (int) factorization.criticalIndex;
+    fPeriod = (int) factorization.period;
+    fIsPeriodic = factorization.isPeriodic;
+}
 
-            char * firstChar = wb(newLength);
-            char * termChar = firstChar + selfLength;
-            char * foundAt = firstChar + foundAtIndex;
 
-            do {
-                char * readFrom = foundAt + originalLength;
-                char * writeTo = foundAt + substituteLength;
-                int movedLength = termChar - readFrom + 1;
-                memmove(writeTo, readFrom, movedLength);
+ViewIndex StringSearcher::indexIn(StringView aText, ViewIndex aStartIndex) const
+{
+    if (aText.isNull() || fSubstring.isNull() || aStartIndex > aText.length())
+        return notFound;
 
-                memmove(foundAt, aSubstitute, substituteLength);
+    if (aStartIndex < 0)
+        aStartIndex = 0;
 
-                termChar += increment; 
-                foundAt += substituteLength;
+    const char * searchedChars = aText.chars() + aStartIndex;
+    ViewIndex searchedLength = aText.length() - aStartIndex;
+    int substringLength = fSubstring.length();
+    const char * position;
 
-            } while (( foundAt = findSubstring(foundAt, anOriginal, aMode) ));
+    if (substringLength < 2 || substringLength > searchedLength || (fMode == caseInsensitive && fAsciiFolding != usesAsciiFolding()))
+        position = findChars(searchedChars, searchedLength, fSubstring.rb(), substringLength, fMode);  // factorization is not prepared or the conversion function was changed
+    else
+    {
+        TwoWayFactorization factorization = {fCriticalIndex, fPeriod, fIsPeriodic};
 
-            enableLengthCache(newLength);
-        }
-}
+        if (fMode == caseSensitive)
+            position = findCharsFiltered<ExactChar>(searchedChars, searchedLength, fSubstring.rb(), substringLength, &factorization);
+        else
+            if (fAsciiFolding)
+                position = findCharsFiltered<AsciiFoldedChar>(searchedChars, searchedLength, fSubstring.rb(), substringLength, &factorization);
+            else
+                position = searchTwoWay(searchedChars, searchedLength, fSubstring.rb(), substringLength, factorization, HookFoldedChar());
+    }
 
+    if (position)
+        return position - aText.chars();
+    else
+        return notFound;
+}
 
 
+// String Builder /////////////////////////////////////////////////////////////////////////////////////////////////////
 
+StringBuilder::StringBuilder() : fAllocation(NULL), fBuffer(NULL), fLength(0), fCapacity(0)
+{
+}
 
-// Padding ////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void String::padLeft(int aLength, char aChar)
+StringBuilder::StringBuilder(int aCapacity) : StringBuilder()
 {
-    if (aLength <= 0)
-        return;
+    reserveCapacity(aCapacity);
+}
 
-    int selfLength = self.length();
 
-    if (aLength <= selfLength)
-        return;
+StringBuilder::~StringBuilder()
+{
+    if (fAllocation)
+    {
+        free(fAllocation);
+        reportMemoryEvent(meRelease, _Allocation::sizeForBufferSize(fCapacity + 1));
+    }
+}
 
-    char * buffer = wb(aLength);
 
-    int paddingLength = aLength - selfLength;
-    memmove(buffer + paddingLength, buffer, selfLength + 1);  // move including terminating null char
-    memset(buffer, aChar, paddingLength);
+void StringBuilder::reserveCapacity(int aRequiredCapacity)
+{
+    if (aRequiredCapacity > String::maxCapacity || aRequiredCapacity < 0)
+        String::onOutOfMemory(aRequiredCapacity);
 
-    int actualLength;
+    if (aRequiredCapacity > fCapacity)
+    {
+        int size = aRequiredCapacity + 1;  // add one position for terminating null character
+        void * pointer = realloc(fAllocation, _Allocation::sizeForBufferSize(size));
 
-    if (aChar)
-        actualLength = aLength;
-    else
-        actualLength = 0;
+        if (!pointer)
+            String::onOutOfMemory(size);
 
-    enableLengthCache(actualLength);
+        if (fAllocation)
+            reportMemoryEvent(meReallocation, _Allocation::sizeForBufferSize(size), _Allocation::sizeForBufferSize(fCapacity + 1));
+        else
+            reportMemoryEvent(meAllocation, _Allocation::sizeForBufferSize(size));
+
+        fAllocation = asAllocation(pointer);
+        fBuffer = fAllocation->buffer;
+        fCapacity = aRequiredCapacity;
+    }
 }
 
 
-void String::padRight(int aLength, char aChar)
+void StringBuilder::grow(int aRequiredCapacity)
 {
-    if (aLength <= 0)
-        return;
-
-    int selfLength = self.length();
+    if (aRequiredCapacity > String::maxCapacity || aRequiredCapacity < 0)
+        String::onOutOfMemory(aRequiredCapacity);
 
-    if (aLength <= selfLength)
-        return;
-
-    char * buffer = wb(aLength);
-    memset(buffer + selfLength, aChar, aLength - selfLength);
-    buffer[aLength] = '\0';
+    const int minimalCapacity = 16;
+    int capacity = fCapacity < String::maxCapacity / 2 ? fCapacity * 2 : String::maxCapacity;  // geometric growth makes appending amortized O(1)
 
-    int actualLength;
+    if (capacity < minimalCapacity)
+        capacity = minimalCapacity;
 
-    if (aChar)
-        actualLength = aLength;
-    else
-        actualLength = selfLength;
+    if (capacity < aRequiredCapacity)
+        capacity = aRequiredCapacity;
 
-    enableLengthCache(actualLength);
+    reserveCapacity(capacity);
 }
 
 
-void String::padCenter(int aLength, char aChar)
+void StringBuilder::append(StringView aText)
 {
-    if (aLength <= 0)
+    if (aText.isEmpty())
         return;
 
-    int selfLength = self.length();
-
-    if (aLength <= selfLength)
-        return;
+    debug_assert(memchr(aText.chars(), '\0', aText.length()) == NULL);
 
-    int paddingLength = aLength - selfLength;
-    int leftPaddingLength = paddingLength / 2;
-    int rightPaddingLength = leftPaddingLength + paddingLength % 2;
+    int length = stringLengthOf(fLength + aText.length());
+    const char * chars = aText.chars();
 
-    char * buffer = wb(aLength);
-    memmove(buffer + leftPaddingLength, buffer, selfLength);
-    memset(buffer, aChar, leftPaddingLength);
-    memset(buffer + leftPaddingLength + selfLength, aChar, rightPaddingLength);
-    buffer[aLength] = '\0';
+    if (length > fCapacity)
+    {
+        bool isOwnText = fBuffer && chars >= fBuffer && chars < fBuffer + fLength;  // e.g. appending view() of the builder
+        ViewIndex ownTextIndex = isOwnText ? chars - fBuffer : 0;
 
-    int actualLength;
+        grow(length);
 
-    if (aChar)
-        actualLength = aLength;
-    else
-        actualLength = csUnknown;
+        if (isOwnText)
+            chars = fBuffer + ownTextIndex;  // the text was moved by reallocation of the buffer
+    }
 
-    enableLengthCache(actualLength);
+    memcpy(fBuffer + fLength, chars, aText.length());
+    fLength = length;
 }
 
 
+void StringBuilder::appendRepeated(char aChar, int aCount)
+{
+    debug_assert(aChar != '\0');
 
+    if (aCount <= 0)
+        return;
 
+    int length = fLength + aCount;
 
-// Reversing //////////////////////////////////////////////////////////////////////////////////////////////////////////
+    if (length > fCapacity)
+        grow(length);
 
-void String::reverse()
-{
-    int selfLength = length();
+    memset(fBuffer + fLength, aChar, aCount);
+    fLength = length;
+}
 
-    if (selfLength < 2)  
-        return;
 
-    char * beginning = wb();
-    char * end = beginning + selfLength - 1;
+void StringBuilder::appendDigits(unsigned long long aNumber, unsigned int aBase, int aMinDigitCount, const char * aDigits)
+{
+    char digits[64];  // enough for binary notation of 64-bit number
+    int digitCount = 0;
 
-    while (beginning < end)
+    do
     {
-        char temp = *beginning;
-        *beginning = *end;
-        *end = temp;
+        digits[sizeof(digits) - ++digitCount] = aDigits[aNumber % aBase];
+        aNumber /= aBase;
+    } 
+    while (aNumber != 0);
 
-        beginning++;
-        end--;
-    }
+    int zeroCount = aMinDigitCount > digitCount ? aMinDigitCount - digitCount : 0;
+    int length = fLength + zeroCount + digitCount;
 
-    enableLengthCache(selfLength);
+    if (length > fCapacity)
+        grow(length);
+
+    memset(fBuffer + fLength, '0', zeroCount);
+    memcpy(fBuffer + fLength + zeroCount, digits + sizeof(digits) - digitCount, digitCount);
+    fLength = length;
 }
 
 
+void StringBuilder::appendDecimal(long long aNumber, int aMinDigitCount)
+{
+    unsigned long long magnitude = aNumber;
 
+    if (aNumber < 0)
+    {
+        append('-');
+        magnitude = 0 - magnitude;  // well defined also for the most negative number
+    }
 
+    appendDigits(magnitude, 10, aMinDigitCount, "0123456789");
+}
 
-// Formatting /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-String String::formattedList(const char * aFormat, va_list anArguments)
+void StringBuilder::appendHex(unsigned long long aNumber, int aMinDigitCount, LetterCase aLetterCase)
 {
-    if (!aFormat)
-        return null;
-
-    String result;
-    result.appendFormattedList(aFormat, anArguments);
-    return result;
+    appendDigits(aNumber, 16, aMinDigitCount, aLetterCase == upperCase ? "0123456789ABCDEF" : "0123456789abcdef");
 }
 
 
-String String::formatted(const char * aFormat, ...)
+void StringBuilder::appendBinary(unsigned long long aNumber, int aMinDigitCount)
 {
-    va_list arguments;
-    
-    va_start(arguments, aFormat);
-        String result = String::formattedList(aFormat, arguments);
-    va_end(arguments);
-    
-    return result;
+    appendDigits(aNumber, 2, aMinDigitCount, "01");
 }
 
 
+void StringBuilder::appendFormattedItems(const char * aFormat, const _FormatItem * anItems, int anItemCount, const _FormatArgument * anArguments)
+{
+    ViewIndex formattedLength = formattedItemsLength(anItems, anItemCount, anArguments);
+    int length = stringLengthOf(fLength + formattedLength);
 
+    if (formattedLength == 0)
+        return;
 
+    if (length > fCapacity)
+    {
+        if (fBuffer && argumentsOverlap(anItems, anItemCount, anArguments, fBuffer, fBuffer + fLength))
+        {
+            String formatted;  // the argument would be invalidated by reallocation of the buffer
+            formatted.appendFormattedItems(aFormat, anItems, anItemCount, anArguments);
+            append(formatted);
+            return;
+        }
 
-// String Of Characters ///////////////////////////////////////////////////////////////////////////////////////////////
-String String::ofChar(char aChar, int aCount)
-{
-    if (aCount < 1)
-        return empty;
-    
-    if (aCount == 1)
-        return String(aChar);
+        grow(length);
+    }
 
-    String result = String::withCapacity(aCount);
-    
-    char * buffer = result.wb();
-    memset(buffer, aChar, aCount);
-    buffer[aCount] = '\0';
+    writeFormattedItems(fBuffer + fLength, aFormat, anItems, anItemCount, anArguments);
+    fLength = length;
+}
 
-    result.enableLengthCache(aChar ? aCount : 0);
 
-    return result;
-}
+String StringBuilder::takeString()
+{
+    String result;
 
+    if (fLength == 0)
+        return result;
 
+    fBuffer[fLength] = '\0';  // there is always a position for terminating null character
 
+    if (fLength <= String::innerCapacity)
+        result.setInner(fBuffer);  // short text is copied and the buffer is kept for next use
+    else
+    {
+        fAllocation->references = 1;
+        fAllocation->hashCache = 0;
 
+        result.data.asFields.mode = String::smAllocation;
+        result.data.asFields.size = fCapacity + 1;
+        result.data.asFields.pointer = fAllocation;
+        result.data.asFields.lengthCache = fLength;
 
-// Parsing ////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        fAllocation = NULL;
+        fBuffer = NULL;
+        fCapacity = 0;
+    }
 
-int String::partCount(const ParsingContext & aContext) const
-{
-    return partCount(aContext.delimiterChars.rb(), aContext.quotingChars.rb(), aContext.ignoreEmpty);
+    fLength = 0;
+    return result;
 }
 
 
-int String::partCount(const char * aDelimiterChars, const char * aQuotationChars, bool anIgnoreEmpty) const
-{
-    int partCount = 0;
-    int charIndex = 0;
 
-    while (nextPart(NULL, &charIndex, aDelimiterChars, aQuotationChars, anIgnoreEmpty))
-        partCount++;
+// Atoms //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    return partCount;
-}
+// Shard of the table of atoms. Shard is selected by the highest bits of hash so threads interning different texts 
+// rarely wait for the same lock. Entries are never released so found atom can be used without lock.
+struct AtomShard
+{
+    std::mutex mutex;
+    const _AtomEntry ** slots = NULL;  // open addressing with linear probing, capacity is power of two
+    int capacity = 0;
+    int count = 0;
+    char * arenaPosition = NULL;  // free space in the current chunk of memory for entries
+    size_t arenaFreeSize = 0;
+};
 
 
-String String::part(int aPartIndex, const ParsingContext & aContext) const
-{
-    return part(aPartIndex, aContext.delimiterChars.rb(), aContext.quotingChars.rb(), aContext.ignoreEmpty);
-}
+static const int atomShardBits = 6;
+static const int atomInitialCapacity = 64;
+static const size_t atomArenaChunkSize = 16 * 1024;
 
+static AtomShard atomShards[1 << atomShardBits];  // constant initialized so atoms can be created also during static initialization
+static std::atomic<int> atomCount(0);
 
-String String::part(int aPartIndex, const char * aDelimiterChars, const char * aQuotationChars, bool anIgnoreEmpty) const
-{
-    if (aPartIndex < 0)
-        return empty;
 
-    int charIndex = 0;
+static void * allocateAtomMemory(size_t aSize)
+{
+    void * pointer = malloc(aSize);
 
-    int currentPartIndex = 0;
-    while (currentPartIndex < aPartIndex && nextPart(NULL, &charIndex, aDelimiterChars, aQuotationChars, anIgnoreEmpty))
-        currentPartIndex++;
+    if (!pointer)
+        String::onOutOfMemory(aSize);
 
-    String result;
-    nextPart(&result, &charIndex, aDelimiterChars, aQuotationChars, anIgnoreEmpty);
+    reportMemoryEvent(meAllocation, aSize);
 
-    return result;
+    return pointer;
 }
 
 
-void String::appendBlockAndIncrementIndex(int * ioCharIndex, int aLength, String * ioToken, bool * ioTokenIsEmpty) const
+static const _AtomEntry * createAtomEntry(AtomShard * aShard, StringView aText, unsigned int aHash)
 {
-    if (ioToken) 
-        (*ioToken).append(substringFrom(*ioCharIndex, aLength));
-    *ioCharIndex += aLength;
-    *ioTokenIsEmpty = false;
-}
+    const size_t alignment = alignof(_AtomEntry);
+    size_t size = (sizeof(_AtomEntry) + aText.length() + 1 + alignment - 1) & ~(alignment - 1);
+    void * memory;
 
+    if (size > atomArenaChunkSize / 4)
+        memory = allocateAtomMemory(size);  // long text gets its own block to not waste the rest of chunk
+    else
+    {
+        if (size > aShard->arenaFreeSize)
+        {
+            aShard->arenaPosition = (char *) allocateAtomMemory(atomArenaChunkSize);
+            aShard->arenaFreeSize = atomArenaChunkSize;
+        }
 
-bool String::nextPart(String * oPart, ParsingContext * aContext) const
-{
-    return nextPart(oPart, &(aContext->charIndex), aContext->delimiterChars.rb(), aContext->quotingChars.rb(), aContext->ignoreEmpty);
+        memory = aShard->arenaPosition;
+        aShard->arenaPosition += size;
+        aShard->arenaFreeSize -= size;
+    }
+
+    _AtomEntry * entry = (_AtomEntry *) memory;
+    entry->hash = aHash;
+    entry->length = (int) aText.length();
+    memcpy(entry->chars, aText.chars(), aText.length());
+    entry->chars[aText.length()] = '\0';
+
+    return entry;
 }
 
 
-bool String::nextPart(String * oPart, int * ioCharIndex, const char * aDelimiterChars, const char * aQuotationChars, bool anIgnoreEmpty) const
+static void growAtomShard(AtomShard * aShard)
 {
-    if (oPart)
-        *oPart = empty;
+    int newCapacity = aShard->capacity ? aShard->capacity * 2 : atomInitialCapacity;
+    const _AtomEntry ** newSlots = (const _AtomEntry **) calloc(newCapacity, sizeof(_AtomEntry *));
 
-    int selfLength = self.length();  
+    if (!newSlots)
+        String::onOutOfMemory(newCapacity * sizeof(_AtomEntry *));
 
-    if (*ioCharIndex >= selfLength)  // also isEmpty, isNull
-        return false;
+    reportMemoryEvent(meAllocation, newCapacity * sizeof(_AtomEntry *));
 
-    if (*ioCharIndex < 0)
-        *ioCharIndex = 0;
+    for (int i = 0; i < aShard->capacity; i++)
+        if (aShard->slots[i])
+        {
+            int index = aShard->slots[i]->hash & (newCapacity - 1);
 
-    if (!aQuotationChars)
-        aQuotationChars = "";
+            while (newSlots[index])
+                index = (index + 1) & (newCapacity - 1);
 
-    if (!aDelimiterChars)
-        aDelimiterChars = "";
+            newSlots[index] = aShard->slots[i];
+        }
 
-    String controlChars = String(aDelimiterChars) + aQuotationChars;
-    
-    int  blockLength;
-    bool tokenIsQuoted;
-    bool tokenIsEmpty = true;
-    bool tokenIsDelimited = false;
+    if (aShard->slots)
+    {
+        free(aShard->slots);
+        reportMemoryEvent(meRelease, aShard->capacity * sizeof(_AtomEntry *));
+    }
 
-    do {
-        if (containsCharsAt(*ioCharIndex, notContainedIn, controlChars, &blockLength))
-            appendBlockAndIncrementIndex(ioCharIndex, blockLength, oPart, &tokenIsEmpty);
+    aShard->slots = newSlots;
+    aShard->capacity = newCapacity;
+}
 
-        tokenIsQuoted = false;
 
-        while (containsAnyCharAt(*ioCharIndex, containedIn, aQuotationChars))
-        {
-            char quotationChar = self[*ioCharIndex];
+Atom::Atom(StringView aText): fEntry(NULL)
+{
+    if (aText.isNull())
+        return;
 
-            *ioCharIndex += 1;
+    stringLengthOf(aText.length());  // text of atom must be representable by String (see text)
 
-            if (!tokenIsQuoted)  // part content is only text between quotation characters
-            {
-                if (oPart) *oPart = empty;  // remove characters before quotation character
-                tokenIsEmpty = true;
-                tokenIsQuoted = true;
-            }
+    unsigned int hash = aText.hash();
+    AtomShard * shard = &atomShards[hash >> (32 - atomShardBits)];
 
-            char doubleQuoted = false;
+    std::lock_guard<std::mutex> lock(shard->mutex);
 
-            do {
-                if (containsCharsAt(*ioCharIndex, notContainedIn, quotationChar, &blockLength))
-                    appendBlockAndIncrementIndex(ioCharIndex, blockLength, oPart, &tokenIsEmpty);
+    if (shard->count * 4 >= shard->capacity * 3)  // keeps load factor under 3/4
+        growAtomShard(shard);
 
-                if (containsAt(*ioCharIndex, quotationChar))
-                    *ioCharIndex += 1;
-                
-                doubleQuoted = containsAt(*ioCharIndex, quotationChar);  // two consecutive quotation characters  
-                if (doubleQuoted)
-                    appendBlockAndIncrementIndex(ioCharIndex, 1, oPart, &tokenIsEmpty);  // resulting in one quoting character in part
+    int index = hash & (shard->capacity - 1);
 
-            } while (doubleQuoted);
+    for (; shard->slots[index]; index = (index + 1) & (shard->capacity - 1))
+    {
+        const _AtomEntry * entry = shard->slots[index];
 
-            if (containsCharsAt(*ioCharIndex, notContainedIn, controlChars, &blockLength))  // skip characters after quotation character
-                *ioCharIndex += blockLength;
-        }
-    
-        if (containsAnyCharAt(*ioCharIndex, containedIn, aDelimiterChars))
+        if (entry->hash == hash && entry->length == aText.length() && memcmp(entry->chars, aText.chars(), aText.length()) == 0)
         {
-            *ioCharIndex += 1;
-            tokenIsDelimited = true;
+            fEntry = entry;
+            return;
         }
+    }
+
+    fEntry = shard->slots[index] = createAtomEntry(shard, aText, hash);
+    shard->count++;
+    atomCount++;
+}
 
-    } while (anIgnoreEmpty && tokenIsEmpty && !tokenIsQuoted && *ioCharIndex < selfLength);
 
-    return !tokenIsEmpty || tokenIsQuoted || (tokenIsDelimited && !anIgnoreEmpty) ;
+int Atom::count()
+{
+    return atomCount;
 }
 
 
+String Atom::text() const
+{
+    if (!fEntry)
+        return String::null;
+
+    String result;
+    result.setLiteral(fEntry->chars);
+    result.data.asFields.lengthCache = fEntry->length;
+    return result;
+}
+
 
 
 
@@ -6,6 +6,17 @@
 #define _PracticString_
 
 #include <memory>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+#if defined(__cpp_impl_three_way_comparison) && __cpp_impl_three_way_comparison >= 201907L
+    #include <compare>
+    #define PRACTIC_STRING_THREE_WAY_COMPARISON
+#endif
 
 #pragma warning(disable : 26812)  // Turn off MSVC warning C26812 about class enum
 
@@ -16,6 +27,11 @@ namespace Practic {
 enum { notFound = -1 };
 
 
+// Type of indexes and lengths in StringView. Unlike String (limited by String::maxCapacity) a view is limited only by address 
+// space, so on 64-bit platform a view can span a text of any size (e.g. whole source file loaded to memory larger than 1 GiB).
+typedef std::ptrdiff_t ViewIndex;
+
+
 // Mode of comparing strings.
 enum EqualityMode {
     caseSensitive,
@@ -48,6 +64,23 @@ enum CharTestCondition
 typedef int (*CharTestFunction)(int);
 
 
+// Kind of memory operation reported to String::onMemoryEvent.
+enum MemoryEvent
+{
+    // Block of aSize bytes was allocated.
+    meAllocation,
+
+    // Block was reallocated to aSize bytes from aPreviousSize bytes.
+    meReallocation,
+
+    // Block of aSize bytes was released.
+    meRelease,
+
+    // Buffer shared by more strings was copied before its change (aSize is count of copied characters).
+    meDetach
+};
+
+
 // Class that keeps parameters of parsing and the current index in parsed string.
 struct ParsingContext;
 
@@ -60,6 +93,612 @@ class _StringJoiningResult;
 
 
 struct _Allocation;
+struct _SharedStorage;
+struct _AtomEntry;
+
+
+class String;
+class StringParts;
+
+
+// Character predicates for template *Where methods. Besides CharTestFunction any callable object taking char and returning bool 
+// (e.g. lambda or one of predicates below) can be passed to template overloads of *Where methods where it is inlined into the scanning loop.
+// Predicates below classify ASCII characters independently on the C locale and can be used also in compile time.
+// e.g. view.containsCharsAtWhere(index, isAsciiDigit, &length) returns true if the view contains digits at index.
+struct IsAsciiDigit { inline constexpr bool operator () (char aChar) const { return aChar >= '0' && aChar <= '9'; } };
+struct IsAsciiHexDigit { inline constexpr bool operator () (char aChar) const { return (aChar >= '0' && aChar <= '9') || ((aChar | 0x20) >= 'a' && (aChar | 0x20) <= 'f'); } };
+struct IsAsciiLetter { inline constexpr bool operator () (char aChar) const { return (aChar | 0x20) >= 'a' && (aChar | 0x20) <= 'z'; } };
+struct IsAsciiLetterOrDigit { inline constexpr bool operator () (char aChar) const { return IsAsciiLetter()(aChar) || IsAsciiDigit()(aChar); } };
+struct IsAsciiSpace { inline constexpr bool operator () (char aChar) const { return aChar == ' ' || (aChar >= '\t' && aChar <= '\r'); } };
+struct IsAsciiIdentifierStart { inline constexpr bool operator () (char aChar) const { return IsAsciiLetter()(aChar) || aChar == '_'; } };
+struct IsAsciiIdentifierChar { inline constexpr bool operator () (char aChar) const { return IsAsciiLetterOrDigit()(aChar) || aChar == '_'; } };
+
+inline constexpr IsAsciiDigit isAsciiDigit {};
+inline constexpr IsAsciiHexDigit isAsciiHexDigit {};
+inline constexpr IsAsciiLetter isAsciiLetter {};
+inline constexpr IsAsciiLetterOrDigit isAsciiLetterOrDigit {};
+inline constexpr IsAsciiSpace isAsciiSpace {};
+inline constexpr IsAsciiIdentifierStart isAsciiIdentifierStart {};
+inline constexpr IsAsciiIdentifierChar isAsciiIdentifierChar {};
+
+
+// Returns index of the first character (searching from aStartIndex) for which aTest returns true or notFound. 
+template <typename Test>
+inline ViewIndex _indexOfCharBy(const char * aChars, ViewIndex aLength, ViewIndex aStartIndex, const Test & aTest)
+{
+    for (ViewIndex index = aStartIndex < 0 ? 0 : aStartIndex; index < aLength; index++)
+        if (aTest(aChars[index]))
+            return index;
+
+    return notFound;
+}
+
+
+// Returns count of consecutive characters starting at aStartIndex for which aTest returns true.
+template <typename Test>
+inline ViewIndex _lengthOfCharsBy(const char * aChars, ViewIndex aLength, ViewIndex aStartIndex, const Test & aTest)
+{
+    if (aStartIndex < 0 || aStartIndex >= aLength)
+        return 0;
+
+    ViewIndex index = aStartIndex;
+
+    while (index < aLength && aTest(aChars[index]))
+        index++;
+
+    return index - aStartIndex;
+}
+
+
+// Class implementing a read only view to a sequence of characters (part of a string or any other array of characters).
+// View does not own viewed characters, it holds only pointer to the first character and length. Viewed characters don't have to be terminated by null character.
+// View is valid only until the viewed string is changed or destroyed. Creating and copying of a view never allocates memory.
+// View is intended for parsing where the parsed parts are only tested or compared and String is created only when the part has to be kept.
+class StringView
+{
+    // Constructors
+    public:
+        // Creates NULL view.
+        inline constexpr StringView(): fChars(NULL), fLength(0) {}
+
+        // Creates a view to aLength characters starting at aChars.
+        // Characters don't have to be terminated by null character. If aChars is NULL creates NULL view.
+        inline constexpr StringView(const char * aChars, ViewIndex aLength): fChars(aChars), fLength(aChars && aLength > 0 ? aLength : 0) {}
+
+        // Creates a view to standard null-terminated C string aCString.
+        // If aCString is NULL creates NULL view. For C string literal the length is computed in compile time.
+        inline constexpr StringView(const char * aCString): fChars(aCString), fLength(aCString ? (ViewIndex) std::char_traits<char>::length(aCString) : 0) {}
+
+        // Creates a view to the whole content of aString.
+        // The view is valid only until aString is changed or destroyed. If aString is NULL creates NULL view.
+        inline StringView(const String & aString);
+
+
+    // Basic Properties
+    public:
+        // Returns true when the view is NULL (for empty or non-empty view returns false).
+        inline constexpr bool isNull() const { return fChars == NULL; }
+
+        // Returns true when the view is empty (for NULL or non-empty view returns false).
+        inline constexpr bool isEmpty() const { return fChars != NULL && fLength == 0; }
+
+        // Returns length of the view in number of characters. For empty or NULL view returns 0.
+        inline constexpr ViewIndex length() const { return fLength; }
+
+        // Returns pointer to the first viewed character. Viewed characters are not terminated by null character.
+        inline constexpr const char * chars() const { return fChars; }
+
+        // Returns character at anIndex. Index has to be in range of the view.
+        inline constexpr char operator [] (ViewIndex anIndex) const { return fChars[anIndex]; }
+
+        // Returns new String containing copy of the viewed characters.
+        // If the view is NULL returns NULL string. View longer than String::maxCapacity is reported by String::onOutOfMemory.
+        String toString() const;
+
+
+    // Subview
+    public:
+        // Returns a view to aLength characters beginning at aStartIndex.
+        // Range is adjusted to the range of the view same way as in String::substringFrom. If the view is NULL returns NULL view.
+        StringView substringFrom(ViewIndex aStartIndex, ViewIndex aLength) const;
+
+        // Returns a view from aStartIndex to the end of the view.
+        inline StringView substringFrom(ViewIndex aStartIndex) const { return substringFrom(aStartIndex, fLength - aStartIndex); }
+
+        // Returns a view from the beginning to anEndIndex. Character at anEndIndex is not included (half open interval).
+        inline StringView substringBefore(ViewIndex anEndIndex) const { return substringFrom(0, anEndIndex); }
+
+        // Returns a view from aStartIndex to anEndIndex. Character at anEndIndex is not included (half open interval).
+        inline StringView substringBetween(ViewIndex aStartIndex, ViewIndex anEndIndex) const { return substringFrom(aStartIndex, anEndIndex - aStartIndex); }
+
+
+    // Finding Substring / Character
+    public:
+        // Returns index of beginning of aSubstring or notFound if the view does not contain substring in the searched part.
+        // Parameter aMode defines case sensitive (default) or case insensitive searching.
+        // Searching starts from aStartIndex which is zero in default. If passed aStartIndex is less than zero searching starts from zero.
+        // If aSubstring is empty it returns aStartIndex if is in range of the view (including index length()) or notFound if aStartIndex is out of range.
+        // Returns notFound if the view itself or substring is NULL.
+        ViewIndex indexOf(StringView aSubstring, EqualityMode aMode = caseSensitive, ViewIndex aStartIndex = 0) const;
+
+        // Returns index of character aChar in the view or notFound if the view does not contain aChar in the searched part.
+        // Parameter aMode defines case sensitive (default) or case insensitive searching.
+        // Searching starts from aStartIndex which is zero in default. If passed aStartIndex is less than zero searching starts from zero.
+        ViewIndex indexOf(char aChar, EqualityMode aMode = caseSensitive, ViewIndex aStartIndex = 0) const;
+
+        // Returns index of a first found character which is contained (or is not contained) in aChars. If such char is not found returns notFound (-1).
+        // Parameter aCondition specifies mode of character testing (only characters contained or not contained in aChars).
+        // Searching starts from aStartIndex which is zero in default. If aStartIndex is less than zero searching starts from zero.
+        ViewIndex indexOfAnyChar(CharTestCondition aCondition, StringView aChars, ViewIndex aStartIndex = 0) const;
+
+        // Returns index of first found character for which aTestFunction returns aTestResult or notFound if the view does not contain such character in searched part.
+        // Method is designed for using with standard functions isalpha, isdigit, isspace, ...
+        // Searching starts from aStartIndex which is zero in default. If passed aStartIndex is less than zero searching starts from zero.
+        ViewIndex indexOfAnyCharWhere(CharTestFunction aTestFunction, bool aTestResult, ViewIndex aStartIndex = 0) const;
+
+        // Returns index of first found character for which aPredicate returns true (see IsAsciiDigit) or notFound.
+        // Searching starts from aStartIndex which is zero in default. If passed aStartIndex is less than zero searching starts from zero.
+        template <class Predicate>
+        inline ViewIndex indexOfAnyCharWhere(Predicate aPredicate, ViewIndex aStartIndex = 0) const { return _indexOfCharBy(fChars, fLength, aStartIndex, aPredicate); }
+
+
+    // Testing contained substring / character
+    public:
+        // Returns true if the view contains aSubstring.
+        // Parameter aMode defines case sensitive (default) or case insensitive searching.
+        // If aSubstring is empty always returns true except the case when the view itself is NULL.
+        // If aSubstring is NULL returns true if the view itself is also NULL.
+        inline bool contains(StringView aSubstring, EqualityMode aMode = caseSensitive) const { return isNull() ? aSubstring.isNull() : indexOf(aSubstring, aMode) != notFound; }
+
+        // Returns true if the view contains character aChar.
+        // Parameter aMode defines case sensitive (default) or case insensitive searching.
+        inline bool contains(char aChar, EqualityMode aMode = caseSensitive) const { return indexOf(aChar, aMode) != notFound; }
+
+
+    // Testing substring / character at index
+    public:
+        // Returns true if the view constains aSubstring starting at anIndex.
+        // Parameter aMode defines case sensitive (default) or case insensitive comparing.
+        // If aSubstring is empty it returns true if anIndex is in range of the view (including index length()) or false if anIndex is out of range.
+        // Returns false if the view itself or substring is NULL.
+        bool containsAt(ViewIndex anIndex, StringView aSubstring, EqualityMode aMode = caseSensitive) const;
+
+        // Returns true if the view contains character aChar at position anIndex.
+        // Parameter aMode defines case sensitive (default) or case insensitive comparing.
+        // When anIndex is out of range of the view or the view is NULL returns false.
+        bool containsAt(ViewIndex anIndex, char aChar, EqualityMode aMode = caseSensitive) const;
+
+        // Returns true if the view contains at a position anIndex one or more characters which are contained (or are not contained) in aChars.
+        // Parameter aCondition specifies mode of character testing (only characters contained or not contained in aChars).
+        // Parameter oLength is setted to count of found characters.
+        bool containsCharsAt(ViewIndex anIndex, CharTestCondition aCondition, StringView aChars, ViewIndex * oLength) const;
+
+        // Returns true if the view contains from a position anIndex one or more characters for which aTestFunction returns aTestResult.
+        // Parameter oLength is setted to count of found characters.
+        // Method is designed for using with standard functions isalpha, isdigit, isspace, ...
+        bool containsCharsAtWhere(ViewIndex anIndex, CharTestFunction aTestFunction, bool aTestResult, ViewIndex * oLength) const;
+
+        // Returns true if the view contains from a position anIndex one or more characters for which aPredicate returns true (see IsAsciiDigit).
+        // Parameter oLength is setted to count of found characters.
+        template <class Predicate>
+        inline bool containsCharsAtWhere(ViewIndex anIndex, Predicate aPredicate, ViewIndex * oLength) const { return (*oLength = _lengthOfCharsBy(fChars, fLength, anIndex, aPredicate)) != 0; }
+
+        // Returns true if the view contains at anIndex any character contained (or not contained) in aChars.
+        // Parameter aCondition specifies mode of character testing (only characters contained or not contained in aChars).
+        bool containsAnyCharAt(ViewIndex anIndex, CharTestCondition aCondition, StringView aChars) const;
+
+        // Returns true if the view at anIndex contains character for which aTestFunction returns aTestResult.
+        // Method is designed for using with standard functions isalpha, isdigit, isspace, ...
+        bool containsAnyCharAtWhere(ViewIndex anIndex, CharTestFunction aTestFunction, bool aTestResult) const;
+
+        // Returns true if the view at anIndex contains character for which aPredicate returns true (see IsAsciiDigit).
+        template <class Predicate>
+        inline bool containsAnyCharAtWhere(ViewIndex anIndex, Predicate aPredicate) const { return anIndex >= 0 && anIndex < fLength && aPredicate(fChars[anIndex]); }
+
+
+    // Testing Prefix / Suffix
+    public:
+        // Returns true if the view starts with aSubstring.
+        // Parameter aMode defines case sensitive (default) or case insensitive comparing.
+        // If aSubstring is empty always returns true except the case when the view itself is NULL.
+        inline bool hasPrefix(StringView aSubstring, EqualityMode aMode = caseSensitive) const { return containsAt(0, aSubstring, aMode); }
+
+        // Returns true if the first character of the view is aChar.
+        // Parameter aMode defines case sensitive (default) or case insensitive comparing.
+        inline bool hasPrefix(char aChar, EqualityMode aMode = caseSensitive) const { return containsAt(0, aChar, aMode); }
+
+        // Returns true if the view ends with aSubstring.
+        // Parameter aMode defines case sensitive (default) or case insensitive comparing.
+        // If aSubstring is empty always returns true except the case when the view itself is NULL.
+        inline bool hasSuffix(StringView aSubstring, EqualityMode aMode = caseSensitive) const
+            { return aSubstring.fLength <= fLength && containsAt(fLength - aSubstring.fLength, aSubstring, aMode); }
+
+        // Returns true if the last character of the view is aChar.
+        // Parameter aMode defines case sensitive (default) or case insensitive comparing.
+        inline bool hasSuffix(char aChar, EqualityMode aMode = caseSensitive) const { return fLength && containsAt(fLength - 1, aChar, aMode); }
+
+
+    // Parsing
+    public:
+        // Method for incremental split the view to parts separated by one of the delimiter characters.
+        // It has same behaviour as String::nextPart except content of the part which can not be changed by the view.
+        // Content of quoted part is a view to the text between quotation characters, so two consecutive quotation characters are not replaced by one
+        // and if the part consists of more quoted sections the view spans from the first to the last one.
+        bool nextPart(StringView * oPart, ViewIndex * ioCharIndex, StringView aDelimiterChars, StringView aQuotationChars = StringView(""), bool anIgnoreEmpty = false) const;
+        bool nextPart(StringView * oPart, ParsingContext * aContext) const;
+
+        int partCount(StringView aDelimiterChars, StringView aQuotationChars = StringView(""), bool anIgnoreEmpty = false) const;
+        int partCount(const ParsingContext & aContext) const;
+
+        StringView part(int aPartIndex, StringView aDelimiterChars, StringView aQuotationChars = StringView(""), bool anIgnoreEmpty = false) const;
+        StringView part(int aPartIndex, const ParsingContext & aContext) const;
+
+        // Splits the view to parts in one pass and stores them to oParts (previous content of oParts is removed). 
+        // Parts are found by the same rules as in method nextPart. Splitting does not allocate memory for individual parts,
+        // parts are views to the text and oParts allocates memory only if there are more parts than StringParts::innerCapacity.
+        // It is preferable to repeated calling of partCount and part which scan the text from beginning for each call.
+        void split(StringParts * oParts, StringView aDelimiterChars, StringView aQuotationChars = StringView(""), bool anIgnoreEmpty = false) const;
+        void split(StringParts * oParts, const ParsingContext & aContext) const;
+
+
+    // Equality
+    public:
+        // Returns true if the view contains same text as anOther or both are NULL.
+        // anEqualityMode determines case sensitive or case insensitive comparison.
+        bool equals(StringView anOther, EqualityMode aMode) const;
+
+        // Returns true if the view contains only one character and the one is same as aChar.
+        // anEqualityMode determines case sensitive or case insensitive comparison.
+        bool equals(char aChar, EqualityMode aMode) const;
+
+        // Returns true if both views contains same text or both are NULL. The comparison is case sensitive.
+        inline friend bool operator == (StringView aFirst, StringView aSecond) { return aFirst.equals(aSecond, caseSensitive); }
+
+        // Returns true if views do not contain same text or one is NULL and the second is not. The comparison is case sensitive.
+        inline friend bool operator != (StringView aFirst, StringView aSecond) { return !aFirst.equals(aSecond, caseSensitive); }
+
+
+    // Ordering & Hashing
+    public:
+        // Compares the view with anOther by values of characters as unsigned numbers (the shorter one of views with same prefix is lesser).
+        // Returns negative number, zero or positive number if the view is lesser, equal or greater than anOther. NULL view is lesser than any other view.
+        // anEqualityMode determines case sensitive or case insensitive comparison (characters are compared converted to lower case).
+        int compare(StringView anOther, EqualityMode aMode = caseSensitive) const;
+
+        inline friend bool operator < (StringView aFirst, StringView aSecond) { return aFirst.compare(aSecond) < 0; }
+        inline friend bool operator <= (StringView aFirst, StringView aSecond) { return aFirst.compare(aSecond) <= 0; }
+        inline friend bool operator > (StringView aFirst, StringView aSecond) { return aFirst.compare(aSecond) > 0; }
+        inline friend bool operator >= (StringView aFirst, StringView aSecond) { return aFirst.compare(aSecond) >= 0; }
+
+        #ifdef PRACTIC_STRING_THREE_WAY_COMPARISON
+        inline friend std::strong_ordering operator <=> (StringView aFirst, StringView aSecond) { return aFirst.compare(aSecond) <=> 0; }
+        #endif
+
+        // Returns hash of viewed characters (fast non-cryptographic hash, never zero). It is same as String::hash of the same text.
+        // NULL view has same hash as empty view.
+        unsigned int hash() const;
+
+
+    // Internals
+    private:
+        const char * fChars;
+        ViewIndex fLength;
+};
+
+
+// String constant computed in compile time (e.g. set of characters for parsing). Constants and their concatenations 
+// have compile-time length and they cost nothing at runtime when declared constexpr. Constant is implicitly converted to StringView.
+// Use `constexpr StringConstant whitespace(" \t");' and `constexpr auto blank = whitespace + "\n\r";'.
+template <int aLength>
+class StringConstant
+{
+    public:
+        // Creates constant from C string literal.
+        inline constexpr StringConstant(const char (&aLiteral)[aLength + 1]): fChars{} 
+        { 
+            for (int i = 0; i < aLength; i++) 
+                fChars[i] = aLiteral[i]; 
+        }
+
+        // Creates constant by concatenation of two arrays of characters (used by operator +). Sum of lengths has to be aLength.
+        inline constexpr StringConstant(const char * aFirst, int aFirstLength, const char * aSecond, int aSecondLength): fChars{}
+        {
+            for (int i = 0; i < aFirstLength; i++) 
+                fChars[i] = aFirst[i];
+
+            for (int i = 0; i < aSecondLength; i++) 
+                fChars[aFirstLength + i] = aSecond[i];
+        }
+
+        inline constexpr int length() const { return aLength; }
+
+        // Returns characters of the constant terminated by null character.
+        inline constexpr const char * rb() const { return fChars; }
+
+        inline constexpr StringView view() const { return StringView(fChars, aLength); }
+        inline constexpr operator StringView() const { return view(); }
+
+    private:
+        char fChars[aLength + 1];
+};
+
+
+template <size_t aSize> 
+StringConstant(const char (&aLiteral)[aSize]) -> StringConstant<(int) aSize - 1>;
+
+
+template <int aFirstLength, int aSecondLength>
+inline constexpr StringConstant<aFirstLength + aSecondLength> operator + (const StringConstant<aFirstLength> & aFirst, const StringConstant<aSecondLength> & aSecond) 
+{ 
+    return StringConstant<aFirstLength + aSecondLength>(aFirst.rb(), aFirstLength, aSecond.rb(), aSecondLength); 
+}
+
+
+template <int aFirstLength, size_t aSecondSize>
+inline constexpr StringConstant<aFirstLength + (int) aSecondSize - 1> operator + (const StringConstant<aFirstLength> & aFirst, const char (&aSecond)[aSecondSize]) 
+{ 
+    return StringConstant<aFirstLength + (int) aSecondSize - 1>(aFirst.rb(), aFirstLength, aSecond, (int) aSecondSize - 1); 
+}
+
+
+template <size_t aFirstSize, int aSecondLength>
+inline constexpr StringConstant<(int) aFirstSize - 1 + aSecondLength> operator + (const char (&aFirst)[aFirstSize], const StringConstant<aSecondLength> & aSecond) 
+{ 
+    return StringConstant<(int) aFirstSize - 1 + aSecondLength>(aFirst, (int) aFirstSize - 1, aSecond.rb(), aSecondLength); 
+}
+
+
+template <int aFirstLength>
+inline constexpr StringConstant<aFirstLength + 1> operator + (const StringConstant<aFirstLength> & aFirst, char aSecond) 
+{ 
+    const char second[] = { aSecond };
+    return StringConstant<aFirstLength + 1>(aFirst.rb(), aFirstLength, second, 1); 
+}
+
+
+// Part of text found by StringView::split.
+struct StringPart
+{
+    // Content of the part. For quoted part it is the text between quotation characters (see StringView::nextPart).
+    StringView text;
+
+    // Quotation character of quoted part or '\0' if the part is not quoted.
+    char quotationChar = '\0';
+
+    // True if text is exactly the content which String::nextPart returns for the part.
+    // It is false for quoted part containing two consecutive quotation characters or more quoted sections.
+    bool isVerbatim = true;
+
+    // Quotation characters the part was split by (copy owned by StringParts). Used for rebuilding content of part which 
+    // isn't verbatim because sections of the part can be quoted by different quotation characters.
+    StringView quotationChars;
+
+    inline bool isQuoted() const { return quotationChar != '\0'; }
+
+    // Returns content of the part the same way as String::nextPart (two consecutive quotation characters are replaced by one).
+    // It allocates memory only for long part (see String::innerCapacity). 
+    String toString() const;
+};
+
+
+// Container for parts produced by StringView::split. 
+// Up to innerCapacity parts are stored inside the object, for more parts it allocates buffer on heap.
+// Reusing one object for more splits allocates the buffer only once.
+class StringParts
+{
+    public:
+        enum { innerCapacity = 8 };
+
+        StringParts();
+        ~StringParts();
+
+        StringParts(const StringParts &) = delete;
+        StringParts & operator = (const StringParts &) = delete;
+
+    public:
+        // Returns number of parts.
+        inline int count() const { return fCount; }
+
+        // Returns part at index. 
+        inline const StringPart & operator [] (int anIndex) const { return fParts[anIndex]; }
+
+        // Returns text of part at index (see StringPart::text).
+        inline StringView text(int anIndex) const { return fParts[anIndex].text; }
+
+        // Removes all parts (allocated buffer is kept for next use).
+        inline void clear() { fCount = 0; }
+
+        // Appends part at the end.
+        void append(const StringPart & aPart);
+
+        // Keeps copy of quotation characters and returns view of it for StringPart::quotationChars.
+        // The copy is valid until next call (parts appended before it must be cleared).
+        StringView keepQuotationChars(StringView aQuotationChars);
+
+    private:
+        enum { innerQuotationCapacity = 8 };
+
+        StringPart * fParts;
+        int fCount;
+        int fCapacity;
+        StringPart fInnerParts[innerCapacity];
+        char * fQuotationChars;
+        int fQuotationCapacity;
+        char fInnerQuotationChars[innerQuotationCapacity];
+};
+
+
+// Format literal for type safe formatting checked and parsed in compile time. 
+// Use `String s = String::formatted(lf("%s = %08llX"), name, value)'. 
+// Supported conversions are %s (String, StringView or C string), %c (char), %d, %i, %u, %x, %X (any integer type) and %%. 
+// Conversion can have flags '-' (left justification) and '0' (padding by zeros), width, and length modifier (hh, h, l, ll, z, j, t).
+// Length modifier is accepted for compatibility with printf only, integer is always formatted according to its own type.
+// Invalid format, wrong count of arguments or wrong type of an argument are reported as compilation error.
+#define lf(aFormatLiteral) \
+    ([] { struct _Literal: Practic::_FormatLiteral { static constexpr const char * text() { return aFormatLiteral; } }; return _Literal(); }())
+
+
+// Base of types created by macro lf. *Never* use it directly.
+struct _FormatLiteral {};
+
+
+// Kind of formatted argument (see _formatArgumentKind).
+enum _FormatArgumentKind { fakUnsupported, fakText, fakChar, fakInteger };
+
+
+// One item of parsed format. Item is either the literal text or one conversion.
+struct _FormatItem
+{
+    char conversion = '\0';  // '\0' for literal text, otherwise one of characters s c d u x X (conversion i is stored as d)
+    bool isLeftJustified = false;
+    bool isZeroPadded = false;
+    int width = 0;
+    int textStart = 0;  // range of literal text in the format
+    int textLength = 0;
+};
+
+
+// Format parsed in compile time. aCapacity is max count of items (length of the format + 1).
+template <int aCapacity>
+struct _FormatPlan
+{
+    _FormatItem items[aCapacity] {};
+    int count = 0;
+    int argumentCount = 0;
+    bool isValid = true;
+
+    static constexpr int lengthOf(const char * aFormat) 
+    { 
+        int length = 0;
+        while (aFormat[length] != '\0') length++;
+        return length; 
+    }
+
+    constexpr _FormatPlan(const char * aFormat)
+    {
+        int index = 0;
+
+        while (aFormat[index] != '\0')
+        {
+            _FormatItem & item = items[count++];
+
+            if (aFormat[index] != '%' || aFormat[index + 1] == '%')
+            {
+                item.textStart = index;
+
+                if (aFormat[index] == '%')  // "%%" is written as literal text "%"
+                    index += 2;
+                else
+                    while (aFormat[index] != '\0' && aFormat[index] != '%') 
+                        index++;
+
+                item.textLength = aFormat[item.textStart] == '%' ? 1 : index - item.textStart;
+                continue;
+            }
+
+            index++;
+
+            for (;; index++)
+                if (aFormat[index] == '-')
+                    item.isLeftJustified = true;
+                else if (aFormat[index] == '0')
+                    item.isZeroPadded = true;
+                else
+                    break;
+
+            while (aFormat[index] >= '0' && aFormat[index] <= '9')
+                item.width = item.width * 10 + (aFormat[index++] - '0');
+
+            bool hasLengthModifier = false;
+
+            while (aFormat[index] == 'h' || aFormat[index] == 'l' || aFormat[index] == 'z' || aFormat[index] == 'j' || aFormat[index] == 't')
+            {
+                index++;
+                hasLengthModifier = true;
+            }
+
+            char conversion = aFormat[index];
+
+            if (conversion == 'i')
+                conversion = 'd';
+
+            if (conversion == 'd' || conversion == 'u' || conversion == 'x' || conversion == 'X' ||
+                ((conversion == 's' || conversion == 'c') && !hasLengthModifier && !item.isZeroPadded))
+            {
+                item.conversion = conversion;
+                argumentCount++;
+                index++;
+            }
+            else
+            {
+                isValid = false;
+                return;
+            }
+        }
+    }
+
+    // Returns true if kinds of arguments correspond to conversions of the format.
+    template <class... Arguments>
+    constexpr bool matchesArguments() const
+    {
+        const _FormatArgumentKind kinds[] = { _formatArgumentKind<Arguments>()..., fakUnsupported };
+        int argumentIndex = 0;
+
+        for (int i = 0; i < count; i++)
+            if (items[i].conversion != '\0')
+            {
+                _FormatArgumentKind kind = kinds[argumentIndex++];
+
+                if ((items[i].conversion == 's' && kind != fakText) || 
+                    (items[i].conversion == 'c' && kind != fakChar) ||
+                    (items[i].conversion != 's' && items[i].conversion != 'c' && kind != fakInteger))
+                    return false;
+            }
+
+        return true;
+    }
+
+    template <class Argument>
+    static constexpr _FormatArgumentKind _formatArgumentKind()
+    {
+        using Type = std::decay_t<Argument>;
+
+        if (std::is_same<Type, char>::value)
+            return fakChar;
+        else if (std::is_integral<Type>::value && !std::is_same<Type, bool>::value)
+            return fakInteger;
+        else if (std::is_same<Type, const char *>::value || std::is_same<Type, char *>::value || 
+                 std::is_base_of<String, Type>::value || std::is_same<Type, StringView>::value)
+            return fakText;
+        else
+            return fakUnsupported;
+    }
+};
+
+
+// Argument of formatting converted to common representation (see String::formatted with format literal).
+struct _FormatArgument
+{
+    const char * chars = NULL;  // text (or NULL)
+    ViewIndex length = 0;
+    unsigned long long magnitude = 0;  // absolute value of integer
+    unsigned long long bits = 0;  // integer in two's complement with width of its type (for hexadecimal conversions)
+    bool isNegative = false;
+    char character = '\0';
+
+    inline _FormatArgument() {}
+    inline _FormatArgument(char aChar): character(aChar) {}
+    inline _FormatArgument(const char * aCString): chars(aCString), length(aCString ? (ViewIndex) strlen(aCString) : 0) {}
+    inline _FormatArgument(StringView aView): chars(aView.chars()), length(aView.length()) {}
+    inline _FormatArgument(const String & aString);
+
+    template <class Integer, class = std::enable_if_t<std::is_integral<Integer>::value>>
+    inline _FormatArgument(Integer anInteger): magnitude((unsigned long long) anInteger), bits((std::make_unsigned_t<Integer>) anInteger), isNegative(anInteger < 0)
+    {
+        if (isNegative)
+            magnitude = 0 - magnitude;  // well defined also for the most negative number
+    }
+};
 
 
 // Class implementing the string of characters.
@@ -84,8 +723,12 @@ class String
 
         // Macro for easy conversion C string literal to string object.
         // See description of String constructor with parameter aCStringIsLiteral for details.
-        // Use `String s = ls("Hello, world!!")'
-        #define ls(aStringLiteral) String(aStringLiteral, true)
+        // Use `String s = ls("Hello, world!!")'. Length of the literal is known in compile time so it is never computed.
+        #define ls(aStringLiteral) String::literal(aStringLiteral)
+
+        // Creates a string object referencing C string literal (see macro ls). Length of the string is taken from size of the literal.
+        template <size_t aSize>
+        static inline String literal(const char (&aLiteral)[aSize]) { String result(aLiteral, true); result.enableLengthCache((int) aSize - 1); return result; }
 
         // Creates a string object from aCString with limitation of length.
         // This constructor is suitable for creating string known length from array of characters which is not terminated by null character.
@@ -102,6 +745,25 @@ class String
         ~String();
 
 
+    // Adopting External Buffers
+    public:
+        // Creates a string which takes ownership of aBuffer allocated by malloc (or realloc) without copying it.
+        // Buffer must contain aLength characters followed by terminating null character. It is released by free 
+        // when the last string referencing it is destroyed. Short texts (up to innerCapacity) are copied to inner buffer 
+        // and aBuffer is released immediately. Parameter aBuffer can be NULL then it creates null string object.
+        static String adopted(char * aBuffer, int aLength);
+
+        // Creates a string which takes over the characters of aString without copying them (aString is moved to storage
+        // owned by the string and released when the last string referencing it is destroyed).
+        static String adopted(std::string && aString);
+
+        // Creates a string sharing aLength characters at aChars which are owned by someone else (e.g. memory mapped file).
+        // Characters must be followed by terminating null character and must not be changed while any string references them.
+        // Function aRelease is invoked when the last string referencing the characters is destroyed (e.g. to call munmap).
+        // The characters are never written, changing the string makes its own copy first (the same way as for literal).
+        static String shared(const char * aChars, int aLength, std::function<void ()> aRelease);
+
+
     // Typed NULL
     public:
         // NULL string for assigning or testing equality.            
@@ -121,6 +783,11 @@ class String
         // If aFormat is NULL returns NULL string.
         static String formattedList(const char * aFormat, va_list anArguments);
 
+        // Returns string builded from format literal (see macro lf) and arguments. Format is checked and parsed in compile time
+        // and the string is written in one pass without calling vsnprintf.
+        template <class Format, class... Arguments, class = std::enable_if_t<std::is_base_of<_FormatLiteral, Format>::value>>
+        static String formatted(Format aFormat, const Arguments &... anArguments);
+
 
     // String of Characters
     public:
@@ -153,10 +820,10 @@ class String
         //static inline int maxCapacity { return 0x03FFFFFFF; /* uint32 without two most significant bytes used for Mode of string */ };
         static const int maxCapacity = 0x03FFFFFFF; 
 
-        // Capacity of internal buffer used for short length strings (11 bytes)
+        // Capacity of internal buffer used for short length strings (10 bytes in 32 bit build, 14 bytes in 64 bit build).
         // Strings with length less or equals inner capacity are placed in to internal buffer and not to heap.
-        //static inline int innerCapacity { return 11; /* sizeof(Data::asCharsBuffer) - 1 */ }
-        static const int innerCapacity = 11;
+        // It is size of Data without terminating null character and the last byte which holds length of inner string and mode.
+        static const int innerCapacity = sizeof(void *) + 2 * sizeof(int32_t) - 2;
 
         // Returns current capacity of string buffer in number of characterss (without terminator character).
         // Buffer capacity can be changed by methods wb, reserveCapacity and minimizeCapacity.
@@ -168,7 +835,7 @@ class String
         // Parameter anAllowShrink allows reduce size of allocated memory when aRequiredCapacity is less than current capacity. 
         // Reducing of already allocated memory require reallocation and thus possible greater fragmentation of heap (hence anAllowShrink is false in default).
         // If aCopyOriginal is true then resulting capacity is always set to at least length of current string even if aRequiredCapacity is less and anAllowShrink is true.
-        // Resulted capacity is never smaller than size of internal buffer for short strings (usually 11 bytes, see method innerCapacity).
+        // Resulted capacity is never smaller than size of internal buffer for short strings (see innerCapacity).
         void reserveCapacity(int aRequiredCapacity, bool aCopyOriginal = true, bool anAllowShrink = false);
 
         // Reduce capacity to length of current string.
@@ -177,7 +844,7 @@ class String
         // Capacity is reduced only when buffer is not referenced from other string instance (method references() returns 1).
         void minimizeCapacity();
 
-        // Returns number of instances that referencing the buffer allocated on heap.
+        // Returns number of instances that referencing the buffer allocated on heap (or adopted external buffer).
         // If the buffer is not allocated on heap returns -1. The feature is intended mainly for debugging purposes.
         int references() const;
 
@@ -202,9 +869,13 @@ class String
         // Parameter anAllowShrink allows reduce size of allocated memory when aRequiredCapacity is less than current capacity. 
         // Reducing of already allocated memory require reallocation and thus possible greater fragmentation of heap (hence anAllowShrink is false in default).
         // If aCopyOriginal is true then resulting capacity is always set to at least length of current string even if aRequiredCapacity is less and anAllowShrink is true.
-        // Resulted capacity is never smaller than size of internal buffer for short strings (usually 11 bytes, see method innerCapacity).
+        // Resulted capacity is never smaller than size of internal buffer for short strings (see innerCapacity).
         char * wb(int aRequiredCapacity = unchanged, bool aCopyOriginal = true, bool anAllowShrink = false); 
 
+        // Returns read only view to the whole string (see class StringView). Creating of the view never allocates memory.
+        // View is valid only until the call of some modifying (non const) method on string or until end of scope of string variable.
+        inline StringView view() const { return StringView(rb(), length()); }
+
 
     // Finding Substring / Character
     public: 
@@ -246,6 +917,11 @@ class String
         // Searching starts from aStartIndex which is zero in default. If passed aStartIndex is less than zero searching starts from zero.
         // Terminating '\0' character is not considered to be a part of the string (can not be found). When the string is empty or NULL returns notFound. 
         int indexOfAnyCharWhere(CharTestFunction aTestFunction, bool aTestResult, int aStartIndex = 0) const;
+
+        // Returns index of first found character for which aPredicate returns true (see IsAsciiDigit) or notFound.
+        // Searching starts from aStartIndex which is zero in default. If passed aStartIndex is less than zero searching starts from zero.
+        template <class Predicate>
+        inline int indexOfAnyCharWhere(Predicate aPredicate, int aStartIndex = 0) const { return (int) view().indexOfAnyCharWhere(aPredicate, aStartIndex); }
             
 
     // Testing contained substring / character
@@ -284,6 +960,10 @@ class String
         // Terminating '\0' character is not considered to be a part of the string (its position is not tested).
         inline bool containsAnyCharWhere(CharTestFunction aTestFunction, bool aTestResult) const { return indexOfAnyCharWhere(aTestFunction, aTestResult) != notFound; }
 
+        // Returns true if string contains at least one character for which aPredicate returns true (see IsAsciiDigit).
+        template <class Predicate>
+        inline bool containsAnyCharWhere(Predicate aPredicate) const { return indexOfAnyCharWhere(aPredicate) != notFound; }
+
 
         // Returns true if the string contains only characters which are contained (or are not contained) in aChars. 
         // Parameter aCondition specifies mode of character testing (only characters contained or not contained in aChars).
@@ -301,6 +981,10 @@ class String
         // Terminating '\0' character is not considered to be a part of the string (its position is not tested). Always returns false for empty string.
         bool containsOnlyCharsWhere(CharTestFunction aTestFunction, bool aTestResult) const;
 
+        // Returns true if string contains only characters for which aPredicate returns true (see IsAsciiDigit). Returns false for empty or NULL string.
+        template <class Predicate>
+        inline bool containsOnlyCharsWhere(Predicate aPredicate) const { StringView text = view(); return text.length() > 0 && _lengthOfCharsBy(text.chars(), text.length(), 0, aPredicate) == text.length(); }
+
 
     // Testing substring / character at index
     public:
@@ -342,6 +1026,11 @@ class String
         // Terminating '\0' character is not considered to be a part of the string (its position is not tested).
         bool containsCharsAtWhere(int anIndex, CharTestFunction aTestFunction, bool aTestResult, int * oLength) const;
 
+        // Returns true if the string contains from a position anIndex one or more characters for which aPredicate returns true (see IsAsciiDigit). 
+        // Parameter oLength is setted to count of found characters.
+        template <class Predicate>
+        inline bool containsCharsAtWhere(int anIndex, Predicate aPredicate, int * oLength) const { StringView text = view(); return (*oLength = (int) _lengthOfCharsBy(text.chars(), text.length(), anIndex, aPredicate)) != 0; }
+
 
         // Returns true if the string contains at anIndex any character contained (or not contained) in aChars.
         // Parameter aCondition specifies mode of character testing (only characters contained or not contained in aChars).
@@ -358,6 +1047,10 @@ class String
         // Terminating '\0' character is not considered to be a part of the string (its position can not be tested).
         bool containsAnyCharAtWhere(int anIndex, CharTestFunction aTestFunction, bool aTestResult) const;
 
+        // Returns true if the string at anIndex contains character for which aPredicate returns true (see IsAsciiDigit).
+        template <class Predicate>
+        inline bool containsAnyCharAtWhere(int anIndex, Predicate aPredicate) const { return view().containsAnyCharAtWhere(anIndex, aPredicate); }
+
 
     // Testing Prefix / Suffix
     public: 
@@ -433,6 +1126,11 @@ class String
         // e.g. call substringOCharsFromWhere(0, isdigit, true) for string "123ABC" returns "123".
         // If the string is NULL returns NULL. 
         String substringOfCharsAtWhere(int aStartIndex, CharTestFunction aTestFunction, bool aTestResult) const;
+
+        // Returns a substring beginning at aStartIndex if it contains only characters for which aPredicate returns true (see IsAsciiDigit).
+        // If the string is NULL returns NULL. 
+        template <class Predicate>
+        String substringOfCharsAtWhere(int aStartIndex, Predicate aPredicate) const;
             
 
     // Converting Uppercase / Lowercase
@@ -446,14 +1144,23 @@ class String
 
         // Pointer to function which string methods use for conversion characters to lower case.
         // This function is used by methods for conversion string case and all methods which takes argument EqualityMode for case insensitive comparison.
-        // By default is set to standard function tolower. It can be set to another function to customize conversion.
+        // By default is set to String::asciiToLower. It can be set to another function to customize conversion (e.g. to standard function tolower for conversion by current C locale).
         static int (*onToLower)(int);
 
         // Pointer to function which string methods use for conversion characters to upper case.
         // This function is used by methods for conversion string case.
-        // By default is set to standard function toupper. It can be set to another function to customize conversion.
+        // By default is set to String::asciiToUpper. It can be set to another function to customize conversion (e.g. to standard function toupper).
         static int (*onToUpper)(int);
 
+        // Converts letter A-Z to lower case, other characters (including all characters above 127) returns unchanged. 
+        // The conversion does not depend on C locale. While onToLower is set to this function the methods does not call it 
+        // for each character but they use built-in lookup table and SIMD instructions (SSE2/AVX2) if available.
+        static int asciiToLower(int aChar);
+
+        // Converts letter a-z to upper case, other characters (including all characters above 127) returns unchanged. 
+        // While onToUpper is set to this function the conversion to upper case uses built-in lookup table and SIMD instructions.
+        static int asciiToUpper(int aChar);
+
 
     // Appending
     public: 
@@ -480,6 +1187,11 @@ class String
         // If aFormat is NULL then string is not changed.
         void appendFormattedList(const char * aFormat, va_list anArguments);
 
+        // Appends string builded from format literal (see macro lf) and arguments. Format is checked and parsed in compile time.
+        // Unlike appendFormatted with C format the string itself can be passed as an argument.
+        template <class Format, class... Arguments, class = std::enable_if_t<std::is_base_of<_FormatLiteral, Format>::value>>
+        void appendFormatted(Format aFormat, const Arguments &... anArguments);
+
 
         // Appends string at the end of string.
         inline String & operator += (const String & aString) { append(aString); return *this; }
@@ -627,6 +1339,10 @@ class String
         // e.g. removeCharsWhere(isspace, true) removes all whitespace characters from the string.
         void removeCharsWhere(CharTestFunction aTestFunction, bool aTestResult, int aStartIndex = 0);
 
+        // Removes all characters (from aStartIndex) for which aPredicate returns true (see IsAsciiDigit).
+        template <class Predicate>
+        inline void removeCharsWhere(Predicate aPredicate, int aStartIndex = 0) { removeCharsBy(aPredicate, aStartIndex); }
+
 
     // Replacing
     public:
@@ -671,6 +1387,10 @@ class String
         // e.g. replaceCharsWhere(isspace, true, '_') replaces all white chars to character underscore
         void replaceCharsWhere(CharTestFunction aTestFunction, bool aTestResult, char aSubstitute, int aStartIndex = 0);
 
+        // Replaces all characters (from aStartIndex) for which aPredicate returns true (see IsAsciiDigit) with character aSubstitute.
+        template <class Predicate>
+        inline void replaceCharsWhere(Predicate aPredicate, char aSubstitute, int aStartIndex = 0) { replaceCharsBy(aPredicate, aSubstitute, aStartIndex); }
+
 
     // Trimming
     public: 
@@ -696,6 +1416,10 @@ class String
         // e.g. trimLeftCharsWhere(isspace, true) removes all whitespace characters from the beginning of the string.
         void trimLeftCharsWhere(CharTestFunction aTestFunction, bool aTestResult);
 
+        // Removes all characters from the beginning of the string for which aPredicate returns true (see IsAsciiDigit).
+        template <class Predicate>
+        inline void trimLeftCharsWhere(Predicate aPredicate) { trimLeftCharsBy(aPredicate); }
+
 
         // Removes all characters which are contained (or are not contained) in aChars from the end of the string.
         // Parameter aCondition specifies mode of character testing (only characters contained or not contained in aChars).
@@ -710,6 +1434,10 @@ class String
         // e.g. trimRightCharsWhere(isspace, true) removes all whitespace characters from the end of the string.
         void trimRightCharsWhere(CharTestFunction aTestFunction, bool aTestResult);
 
+        // Removes all characters from the end of the string for which aPredicate returns true (see IsAsciiDigit).
+        template <class Predicate>
+        inline void trimRightCharsWhere(Predicate aPredicate) { trimRightCharsBy(aPredicate); }
+
 
     // Padding
     public: 
@@ -767,12 +1495,18 @@ class String
         String part(int aPartIndex, const char * aDelimiterChars, const char * aQuotationChars = "", bool anIgnoreEmpty = false) const;
         String part(int aPartIndex, const ParsingContext & aContext) const;
 
+        // Splits the string to parts in one pass and stores them to oParts (see StringView::split).
+        // Parts are views to the string so they are valid only until the string is changed or destroyed.
+        inline void split(StringParts * oParts, StringView aDelimiterChars, StringView aQuotationChars = StringView(""), bool anIgnoreEmpty = false) const { view().split(oParts, aDelimiterChars, aQuotationChars, anIgnoreEmpty); }
+        inline void split(StringParts * oParts, const ParsingContext & aContext) const { view().split(oParts, aContext); }
+
 
     // Equality
     public: 
         // Returns true if string contains same text as aString.
         // anEqualityMode determines case sensitive or case insensitive comparison.
-        inline bool equals(const String & aString, EqualityMode aMode) const { return equals(aString.rb(), aMode); }
+        // Strings sharing the same buffer are equal without comparing and strings with different cached hash are not equal.
+        bool equals(const String & aString, EqualityMode aMode) const;
 
         // Returns true if string contains same text as aCString.
         // anEqualityMode determines case sensitive or case insensitive comparison.
@@ -818,6 +1552,36 @@ class String
         inline friend bool operator != (const char aFirst, const String & aSecond) { return !aSecond.equals(aFirst, caseSensitive); }
 
 
+    // Ordering & Hashing
+    public: 
+        // Compares the string with aString (see StringView::compare). NULL string is lesser than any other string.
+        inline int compare(const String & aString, EqualityMode aMode = caseSensitive) const { return view().compare(aString.view(), aMode); }
+
+        inline friend bool operator < (const String & aFirst, const String & aSecond) { return aFirst.compare(aSecond) < 0; }
+        inline friend bool operator <= (const String & aFirst, const String & aSecond) { return aFirst.compare(aSecond) <= 0; }
+        inline friend bool operator > (const String & aFirst, const String & aSecond) { return aFirst.compare(aSecond) > 0; }
+        inline friend bool operator >= (const String & aFirst, const String & aSecond) { return aFirst.compare(aSecond) >= 0; }
+
+        inline friend bool operator < (const String & aFirst, const char * aSecond) { return aFirst.view().compare(aSecond) < 0; }
+        inline friend bool operator <= (const String & aFirst, const char * aSecond) { return aFirst.view().compare(aSecond) <= 0; }
+        inline friend bool operator > (const String & aFirst, const char * aSecond) { return aFirst.view().compare(aSecond) > 0; }
+        inline friend bool operator >= (const String & aFirst, const char * aSecond) { return aFirst.view().compare(aSecond) >= 0; }
+
+        inline friend bool operator < (const char * aFirst, const String & aSecond) { return aSecond.view().compare(aFirst) > 0; }
+        inline friend bool operator <= (const char * aFirst, const String & aSecond) { return aSecond.view().compare(aFirst) >= 0; }
+        inline friend bool operator > (const char * aFirst, const String & aSecond) { return aSecond.view().compare(aFirst) < 0; }
+        inline friend bool operator >= (const char * aFirst, const String & aSecond) { return aSecond.view().compare(aFirst) <= 0; }
+
+        #ifdef PRACTIC_STRING_THREE_WAY_COMPARISON
+        inline friend std::strong_ordering operator <=> (const String & aFirst, const String & aSecond) { return aFirst.compare(aSecond) <=> 0; }
+        inline friend std::strong_ordering operator <=> (const String & aFirst, const char * aSecond) { return aFirst.view().compare(aSecond) <=> 0; }
+        #endif
+
+        // Returns hash of the string (see StringView::hash). Hash of the string in allocated buffer is computed only once
+        // and it is kept in the buffer until the string is changed (so also copies of the string don't compute it again).
+        unsigned int hash() const;
+
+
     // Joining
     public: 
         // Joins two strings into one new string.
@@ -877,11 +1641,22 @@ class String
         static void defaultOutOfMemoryHandler(size_t aRequestedSize);
 
 
+    // Memory Instrumentation
+    public:
+        // Pointer to function which is invoked for each allocation, reallocation and release of memory made by strings, builders,
+        // parts and atoms and for each detaching of buffer shared by more strings (see MemoryEvent). 
+        // By default it is NULL so the memory operations cost only the test of the pointer. The function can be invoked 
+        // from more threads at once (e.g. when atoms are created) and it must not allocate strings.
+        // See MemoryAccounting for implementation which counts the operations.
+        static void (*onMemoryEvent)(MemoryEvent anEvent, size_t aSize, size_t aPreviousSize);
+
+
     // Internals
     private: 
         void setInner(const char * aCString);
         void setLiteral(const char * aCString);
         void setAllocation(int aCapacity, const char * aCString);
+        void setShared(const char * aChars, int aLength, std::function<void ()> aRelease);
         inline void setBuffer(int aRequiredCapacity);
 
         void copyFrom(const char * aCString, int aLength);
@@ -891,33 +1666,35 @@ class String
         void uniquate(int aRequiredCapacity, bool aCopyOriginal, bool anAllowShrink);
         inline void uniquateInner(int aRequiredCapacity, bool aCopyOriginal);
         inline void uniquateLiteral(int aRequiredCapacity, bool aCopyOriginal);
+        inline void uniquateShared(int aRequiredCapacity, bool aCopyOriginal);
         inline void uniquateSingleReferenceAllocation(int aRequiredCapacity, bool aCopyOriginal, bool anAllowShrink);
         inline void uniquateMultiReferenceAllocation(int aRequiredCapacity, bool aCopyOriginal);
             
         void enableLengthCache(int aLength);
+        inline int innerLength() const;
+        inline void setInnerLength(int aLength);
+        inline uint32_t * hashCache() const;
 
-        typedef bool (*ParameterizedCharTestFunction)(char aChar, void * aParameter);
-        static ParameterizedCharTestFunction checkingFunctionFor(CharTestFunction aTestFunction, bool aResult);
-        static ParameterizedCharTestFunction checkingFunctionFor(CharTestCondition aCondition);
+        template <typename Test> void removeCharsBy(const Test & aTest, int aStartIndex);
+        template <typename Test> void replaceCharsBy(const Test & aTest, char aSubstitute, int aStartIndex);
+        template <typename Test> void trimLeftCharsBy(const Test & aTest);
+        template <typename Test> void trimRightCharsBy(const Test & aTest);
 
-        int indexOfAnyCharBy(ParameterizedCharTestFunction aTestFunction, void * aTestParameter, int aStartIndex) const;
-        bool containsCharsAtBy(int anIndex, ParameterizedCharTestFunction aTestFunction, void * aTestParameter, int * oLength) const;
-        bool containsAnyCharAtBy(int anIndex, ParameterizedCharTestFunction aTestFunction, void * aTestParameter) const;
-        String substringOfCharsBy(int aStartIndex, ParameterizedCharTestFunction aTestFunction, void * aTestParameter) const;
-        void removeCharsBy(ParameterizedCharTestFunction aTestFunction, void * aTestParameter, int aStartIndex);
-        void replaceCharsBy(ParameterizedCharTestFunction aTestFunction, void * aTestParameter, char aSubstitute, int aStartIndex);
-        void trimLeftCharsBy(ParameterizedCharTestFunction aTestFunction, void * aTestParameter);
-        void trimRightCharsBy(ParameterizedCharTestFunction aTestFunction, void * aTestParameter);
+        void appendFormattedItems(const char * aFormat, const _FormatItem * anItems, int anItemCount, const _FormatArgument * anArguments);
 
-        void appendBlockAndIncrementIndex(int * ioCharIndex, int aLength, String * ioToken, bool * ioTokenIsEmpty) const;
+        friend struct StringPart;
+        friend class StringBuilder;
+        friend class Atom;
 
-        _Allocation * _AllocationPublisher() {};  // only to make visible _Allocation in visual studio debugger
+        _Allocation * _AllocationPublisher() { return NULL; }  // only to make visible _Allocation in visual studio debugger
+        _SharedStorage * _SharedStoragePublisher() { return NULL; }  // only to make visible _SharedStorage in visual studio debugger
 
         enum Mode
         {
             smInner = 0,  
             smLiteral = 1,
-            smAllocation = 2
+            smAllocation = 2,
+            smShared = 3
         };
 
         #ifdef __GNUC__
@@ -936,10 +1713,12 @@ class String
             unsigned int mode : 2;
         });
 
+        // Inner string (mode smInner) uses whole Data as buffer. Its last byte holds length of the string in low six bits 
+        // (two high bits are occupied by mode which is zero for smInner) so length of inner string is known without strlen.
         PACK(union Data
         {
             Fields asFields;
-            char asCharsBuffer[12];
+            char asCharsBuffer[innerCapacity + 2];
         }); 
 
         mutable Data data;
@@ -958,10 +1737,453 @@ struct ParsingContext
         String delimiterChars;
         String quotingChars;
         bool ignoreEmpty;
-        int charIndex = 0;
+        ViewIndex charIndex = 0;
+};
+
+
+inline StringView::StringView(const String & aString): StringView(aString.view()) {}
+
+
+// Char testing templates of String are defined here to be inlined for any predicate (including CharTestFunction adapters).
+template <class Predicate>
+String String::substringOfCharsAtWhere(int aStartIndex, Predicate aPredicate) const
+{
+    if (isNull())
+        return null;
+
+    int substringLength;    
+    if (containsCharsAtWhere(aStartIndex, aPredicate, &substringLength))
+        return substringFrom(aStartIndex, substringLength);
+    else
+        return empty;
+}
+
+
+template <typename Test>
+void String::trimLeftCharsBy(const Test & aTest)
+{
+    StringView text = view();
+    int trimmedLength = (int) _lengthOfCharsBy(text.chars(), text.length(), 0, aTest);
+
+    if (trimmedLength > 0)  // prevent reallocation (calling wb) when there is nothing to trim
+        removeFrom(0, trimmedLength);
+}
+
+
+template <typename Test>
+void String::trimRightCharsBy(const Test & aTest)
+{
+    StringView text = view();
+    int newLength = (int) text.length();
+
+    while (newLength > 0 && aTest(text[newLength - 1]))
+        newLength--;
+
+    if (newLength == text.length())  // prevent reallocation (calling wb) when there is nothing to trim
+        return;
+
+    wb()[newLength] = '\0';
+    enableLengthCache(newLength);
+}
+
+
+template <typename Test>
+void String::removeCharsBy(const Test & aTest, int aStartIndex)
+{
+    StringView text = view();
+    int index = (int) _indexOfCharBy(text.chars(), text.length(), aStartIndex, aTest);
+
+    if (index == notFound)  // prevent reallocation (calling wb) when there is nothing to remove (also for NULL or empty string)
+        return;
+
+    int selfLength = (int) text.length();
+    char * buffer = wb();
+    int newLength = index;
+
+    for (; index < selfLength; index++)
+        if (!aTest(buffer[index]))
+            buffer[newLength++] = buffer[index];
+
+    buffer[newLength] = '\0';
+    enableLengthCache(newLength);
+}
+
+
+template <typename Test>
+void String::replaceCharsBy(const Test & aTest, char aSubstitute, int aStartIndex)
+{
+    StringView text = view();
+    int index = (int) _indexOfCharBy(text.chars(), text.length(), aStartIndex, aTest);
+
+    if (index == notFound)  // prevent reallocation (calling wb) when there is nothing to replace (also for NULL or empty string)
+        return;
+
+    int selfLength = (int) text.length();
+    int newLength = aSubstitute ? selfLength : index;  // replacing by '\0' truncates the string at the first replaced character
+    char * buffer = wb();
+
+    for (; index < selfLength; index++)
+        if (aTest(buffer[index]))
+            buffer[index] = aSubstitute;
+
+    enableLengthCache(newLength);
+}
+
+
+// Searcher of one substring prepared for repeated searching (e.g. the same keyword in many texts or many times in one long text).
+// The substring is analyzed only once in constructor (critical factorization for Two-Way algorithm) so each search runs 
+// in time linear to the length of searched text for any substring and in both case sensitive and case insensitive mode.
+// Searcher holds its own copy of the substring so it can be created also from a temporary view.
+class StringSearcher
+{
+    public:
+        StringSearcher(StringView aSubstring, EqualityMode aMode = caseSensitive);
+
+        // Returns index of first occurrence of the substring in aText (starting at aStartIndex) or notFound.
+        ViewIndex indexIn(StringView aText, ViewIndex aStartIndex = 0) const;
+
+        // Returns true if aText contains the substring.
+        inline bool isContainedIn(StringView aText) const { return indexIn(aText) != notFound; }
+
+        inline const String & substring() const { return fSubstring; }
+        inline EqualityMode mode() const { return fMode; }
+
+    private:
+        String fSubstring;
+        EqualityMode fMode;
+        bool fAsciiFolding;
+        int fCriticalIndex;
+        int fPeriod;
+        bool fIsPeriodic;
 };
 
 
+// Builder for composing a string by many appends (e.g. text of a file). Its buffer grows geometrically so appending 
+// is amortized O(1) regardless of count of appends. Built text is handed over to String without copying (see takeString).
+// The builder is not copyable. Text in the buffer is not terminated by null character until it is taken by takeString.
+class StringBuilder
+{
+    public:
+        // Creates empty builder without allocated buffer.
+        StringBuilder();
+
+        // Creates empty builder with buffer for aCapacity characters (e.g. estimated length of built text).
+        explicit StringBuilder(int aCapacity);
+
+        ~StringBuilder();
+
+        StringBuilder(const StringBuilder &) = delete;
+        StringBuilder & operator = (const StringBuilder &) = delete;
+
+
+    // Basic Properties
+    public:
+        // Returns length of built text.
+        inline int length() const { return fLength; }
+
+        // Returns true if nothing was appended since creation or the last takeString or clear.
+        inline bool isEmpty() const { return fLength == 0; }
+
+        // Returns count of characters which fit to the buffer without its reallocation.
+        inline int capacity() const { return fCapacity; }
+
+        // Returns view to the built text. The view is valid only until next append (which can reallocate the buffer)
+        // but it can be passed to append of the same builder.
+        inline StringView view() const { return StringView(fBuffer ? fBuffer : "", fLength); }
+
+
+    // Managing Capacity
+    public:
+        // Ensures capacity for at least aRequiredCapacity characters. 
+        // Use it with estimated length of the result to avoid reallocations during appending.
+        void reserveCapacity(int aRequiredCapacity);
+
+        // Ensures capacity for additional aLength characters after current text.
+        inline void reserveAdditional(int aLength) { reserveCapacity(fLength + aLength); }
+
+
+    // Appending
+    public:
+        // Appends aText. NULL view is considered to be empty text. The text must not contain null character.
+        void append(StringView aText);
+
+        // Appends character aChar. Null character must not be appended (it would terminate resulting String).
+        inline void append(char aChar) { if (fLength == fCapacity) grow(fLength + 1); fBuffer[fLength++] = aChar; }
+
+        // Appends aCount characters aChar.
+        void appendRepeated(char aChar, int aCount);
+
+        // Appends aNumber in decimal notation. If the number has less digits than aMinDigitCount they are completed by leading zeros (after the sign).
+        void appendDecimal(long long aNumber, int aMinDigitCount = 0);
+
+        // Appends aNumber in hexadecimal notation (without prefix). If the number has less digits than aMinDigitCount they are completed by leading zeros.
+        // aLetterCase determines case of digits A-F.
+        void appendHex(unsigned long long aNumber, int aMinDigitCount = 0, LetterCase aLetterCase = upperCase);
+
+        // Appends aNumber in binary notation (without prefix). If the number has less digits than aMinDigitCount they are completed by leading zeros.
+        void appendBinary(unsigned long long aNumber, int aMinDigitCount = 0);
+
+        // Appends text builded from format literal (see macro lf) and arguments. Format is checked and parsed in compile time.
+        template <class Format, class... Arguments, class = std::enable_if_t<std::is_base_of<_FormatLiteral, Format>::value>>
+        void appendFormatted(Format aFormat, const Arguments &... anArguments);
+
+        inline StringBuilder & operator += (StringView aText) { append(aText); return *this; }
+        inline StringBuilder & operator += (char aChar) { append(aChar); return *this; }
+
+
+    // Building
+    public:
+        // Returns built text and makes the builder empty. Buffer of the builder is handed over to the returned String without copying.
+        // Short text (see String::innerCapacity) is copied to the String inner buffer and the builder keeps its buffer for next use.
+        // Capacity of returned String can be greater than its length (see String::minimizeCapacity).
+        String takeString();
+
+        // Removes built text. Allocated buffer is kept for next use.
+        inline void clear() { fLength = 0; }
+
+
+    // Internals
+    private:
+        void grow(int aRequiredCapacity);
+        void appendDigits(unsigned long long aNumber, unsigned int aBase, int aMinDigitCount, const char * aDigits);
+        void appendFormattedItems(const char * aFormat, const _FormatItem * anItems, int anItemCount, const _FormatArgument * anArguments);
+
+        _Allocation * fAllocation;
+        char * fBuffer;
+        int fLength;
+        int fCapacity;
+};
+
+
+// Interned text (e.g. identifier) which is stored only once for whole process. Equal texts are always represented by the same atom
+// so comparing and hashing atoms takes O(1) time. Text of atom is immutable and it is never released. Interning is thread safe
+// (the table of atoms is divided to shards with own locks), all other methods only read immutable data.
+// Atom is intended for names repeated in many places (symbol names, table names) not for arbitrary texts.
+class Atom
+{
+    public:
+        // Creates NULL atom.
+        inline Atom(): fEntry(NULL) {}
+
+        // Returns atom of aText. If there is no atom of the same text yet it is created. NULL view gives NULL atom.
+        explicit Atom(StringView aText);
+
+
+    // Basic Properties
+    public:
+        inline bool isNull() const { return fEntry == NULL; }
+        inline bool isEmpty() const { return fEntry != NULL && length() == 0; }
+        inline int length() const;
+
+        // Returns hash of the text (same as StringView::hash of the text). NULL atom has same hash as empty text.
+        inline unsigned int hash() const;
+
+        // Returns count of distinct atoms created in the process.
+        static int count();
+
+
+    // Accessing Text
+    public:
+        // Returns pointer to the text terminated by null character (or NULL for NULL atom).
+        inline const char * rb() const;
+
+        inline StringView view() const { return StringView(rb(), length()); }
+
+        // Returns text of the atom as literal string (without allocation and copying of the text).
+        String text() const;
+
+
+    // Equality
+    public:
+        inline friend bool operator == (Atom aFirst, Atom aSecond) { return aFirst.fEntry == aSecond.fEntry; }
+        inline friend bool operator != (Atom aFirst, Atom aSecond) { return aFirst.fEntry != aSecond.fEntry; }
+
+
+    // Internals
+    private:
+        const _AtomEntry * fEntry;
+};
+
+
+// Transparent hash and comparators for containers of strings. Views and C strings can be used as keys for searching 
+// in containers which support heterogeneous lookup (e.g. std::set<String, StringLess> in C++14, unordered containers in C++20).
+// They use cached hash of String.
+struct StringHash
+{
+    using is_transparent = void;
+
+    inline size_t operator () (const String & aString) const { return aString.hash(); }
+    inline size_t operator () (StringView aView) const { return aView.hash(); }
+    inline size_t operator () (const char * aCString) const { return StringView(aCString).hash(); }
+};
+
+
+struct StringEqualTo
+{
+    using is_transparent = void;
+
+    inline bool operator () (StringView aFirst, StringView aSecond) const { return aFirst.equals(aSecond, caseSensitive); }
+};
+
+
+struct StringLess
+{
+    using is_transparent = void;
+
+    inline bool operator () (StringView aFirst, StringView aSecond) const { return aFirst.compare(aSecond) < 0; }
+};
+
+
+// Counts of memory operations collected by MemoryAccounting.
+struct MemoryCounts
+{
+    long long allocationCount = 0;
+    long long reallocationCount = 0;
+    long long releaseCount = 0;
+    long long detachCount = 0;
+
+    // Sum of sizes of allocated blocks and of growths of reallocated blocks.
+    long long allocatedBytes = 0;
+
+    // Size of blocks allocated and not released since start of accounting (it can be negative when memory allocated 
+    // before the start is released). Current and peak bytes are counted only in total (see MemoryAccounting::total).
+    long long currentBytes = 0;
+    long long peakBytes = 0;
+};
+
+
+// Counters updated from more threads. *Never* use it directly.
+struct _MemoryCounters
+{
+    std::atomic<long long> allocationCount {0};
+    std::atomic<long long> reallocationCount {0};
+    std::atomic<long long> releaseCount {0};
+    std::atomic<long long> detachCount {0};
+    std::atomic<long long> allocatedBytes {0};
+    std::atomic<long long> currentBytes {0};
+    std::atomic<long long> peakBytes {0};
+
+    void add(MemoryEvent anEvent, size_t aSize, size_t aPreviousSize, bool aCountsCurrentBytes);
+    MemoryCounts counts() const;
+    void reset();
+};
+
+
+// Named group of call sites (e.g. phase of a program) to which memory operations are attributed while the tag is current 
+// tag of the thread (see MemoryTagScope). Tag is registered for MemoryAccounting::forEachTag while it exists. Destroyed tag
+// stops to be current tag of the destroying thread, it must not be current tag of other threads.
+class MemoryTag
+{
+    public:
+        explicit MemoryTag(const char * aName);
+        ~MemoryTag();
+
+        MemoryTag(const MemoryTag &) = delete;
+        MemoryTag & operator = (const MemoryTag &) = delete;
+
+        inline const char * name() const { return fName; }
+
+        // Returns counts of operations made while the tag was current.
+        inline MemoryCounts counts() const { return fCounters.counts(); }
+
+    private:
+        const char * fName;
+        _MemoryCounters fCounters;
+        MemoryTag * fNextTag;
+
+        friend class MemoryAccounting;
+};
+
+
+// Implementation of String::onMemoryEvent which counts memory operations in total and for the current tag of the thread.
+// Use `MemoryAccounting::start()' and later e.g. `assert(MemoryAccounting::total().allocationCount <= budget)'.
+class MemoryAccounting
+{
+    public:
+        // Sets String::onMemoryEvent to accounting. Operations made before are not counted.
+        static void start();
+
+        // Resets String::onMemoryEvent to NULL. Counts are kept.
+        static void stop();
+
+        // Sets all counts (in total and of all tags) to zero.
+        static void reset();
+
+        // Returns counts of all operations since start (or reset).
+        static MemoryCounts total();
+
+        // Calls aVisitor for each created tag.
+        static void forEachTag(const std::function<void (const MemoryTag & aTag)> & aVisitor);
+
+        // Sets current tag of the thread (NULL means no tag) and returns the previous one.
+        static MemoryTag * setCurrentTag(MemoryTag * aTag);
+
+        // Counts the operation (it is set to String::onMemoryEvent by start).
+        static void count(MemoryEvent anEvent, size_t aSize, size_t aPreviousSize);
+};
+
+
+// Sets aTag as current tag of the thread until the end of the scope, then the previous tag is current again.
+class MemoryTagScope
+{
+    public:
+        inline explicit MemoryTagScope(MemoryTag * aTag): fPreviousTag(MemoryAccounting::setCurrentTag(aTag)) {}
+        inline ~MemoryTagScope() { MemoryAccounting::setCurrentTag(fPreviousTag); }
+
+        MemoryTagScope(const MemoryTagScope &) = delete;
+        MemoryTagScope & operator = (const MemoryTagScope &) = delete;
+
+    private:
+        MemoryTag * fPreviousTag;
+};
+
+
+
+// Formatting by Format Literal //////////////////////////////////////////////////////////////////////////////////////
+
+// Checks format literal and argument types in compile time. Result is the parsed format stored as constant.
+#define _practicCheckedFormatPlan(Format, Arguments) \
+    static constexpr _FormatPlan<_FormatPlan<1>::lengthOf(Format::text()) + 1> plan(Format::text()); \
+    static_assert(plan.isValid, "Invalid format literal (supported conversions are %s %c %d %i %u %x %X %%)."); \
+    static_assert(plan.argumentCount == sizeof...(Arguments), "Count of arguments doesn't match count of conversions in format literal."); \
+    static_assert(plan.template matchesArguments<Arguments...>(), "Type of argument doesn't match its conversion in format literal.")
+
+
+inline _FormatArgument::_FormatArgument(const String & aString): chars(aString.rb()), length(aString.isNull() ? 0 : aString.length()) {}
+
+
+template <class Format, class... Arguments, class>
+String String::formatted(Format, const Arguments &... anArguments)
+{
+    _practicCheckedFormatPlan(Format, Arguments);
+    const _FormatArgument arguments[] = { _FormatArgument(anArguments)..., _FormatArgument() };
+
+    String result;
+    result.appendFormattedItems(Format::text(), plan.items, plan.count, arguments);
+    return result;
+}
+
+
+template <class Format, class... Arguments, class>
+void String::appendFormatted(Format, const Arguments &... anArguments)
+{
+    _practicCheckedFormatPlan(Format, Arguments);
+    const _FormatArgument arguments[] = { _FormatArgument(anArguments)..., _FormatArgument() };
+
+    appendFormattedItems(Format::text(), plan.items, plan.count, arguments);
+}
+
+
+template <class Format, class... Arguments, class>
+void StringBuilder::appendFormatted(Format, const Arguments &... anArguments)
+{
+    _practicCheckedFormatPlan(Format, Arguments);
+    const _FormatArgument arguments[] = { _FormatArgument(anArguments)..., _FormatArgument() };
+
+    appendFormattedItems(Format::text(), plan.items, plan.count, arguments);
+}
+
+
 class _StringJoiningResult: public String
 {
     public:
@@ -973,6 +2195,7 @@ class _StringJoiningResult: public String
 
 struct _Allocation
 {
+    uint32_t hashCache;  // zero if hash is not computed yet (see String::hash)
     uint16_t references;
     
     #pragma warning(suppress : 4200)  // suppress MSVC warning about zero sized variable
@@ -985,6 +2208,49 @@ struct _Allocation
 };
 
 
+struct _SharedStorage
+{
+    uint32_t hashCache;  // zero if hash is not computed yet (see String::hash)
+    int references;
+    const char * chars;
+    std::function<void ()> release;  // invoked when the last reference is released
+};
+
+
+struct _AtomEntry
+{
+    unsigned int hash;
+    int length;
+
+    #pragma warning(suppress : 4200)  // suppress MSVC warning about zero sized variable
+    char chars[];
+};
+
+
+inline int Atom::length() const { return fEntry ? fEntry->length : 0; }
+inline unsigned int Atom::hash() const { return fEntry ? fEntry->hash : StringView("").hash(); }
+inline const char * Atom::rb() const { return fEntry ? fEntry->chars : NULL; }
+
+
+}
+
+
+namespace std
+{
+    template <> struct hash<Practic::String>
+    {
+        inline size_t operator () (const Practic::String & aString) const { return aString.hash(); }
+    };
+
+    template <> struct hash<Practic::StringView>
+    {
+        inline size_t operator () (Practic::StringView aView) const { return aView.hash(); }
+    };
+
+    template <> struct hash<Practic::Atom>
+    {
+        inline size_t operator () (Practic::Atom anAtom) const { return anAtom.hash(); }
+    };
 }
 
 
@@ -3,11 +3,25 @@
 
 #include <filesystem>
 #include <fstream>
-#include <sstream>
 #include <string>
 #include <unordered_set>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
 #include <cassert>
 #include <cstdarg>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
 #include <PracticString.h>
 
 using namespace std;
@@ -19,117 +33,1123 @@ using namespace Practic;
 
 #define filePathEqualityMode caseInsensitive
 
+#define sourceBlockSize (1 << 20)  // size of blocks in which source files are read ahead (see SourceReader)
+
+#define sourceBlockHeadroom (64 << 10)  // space before text of block for the text kept from previous block (see SourceWindow)
+
+#define sourceReaderCount 4  // count of source files read ahead at the same time (see SourceReader)
+
+#define tableWriterCount 4  // count of threads writing table files (see OutputWriter)
+
+#define consoleLogFlushSize (1 << 20)  // size of console text written before the end of the source file (see ConsoleLog)
+
 
 
 // General Utilities //////////////////////////////////////////////////////////////////////////////////////////////////
 
-struct ParseError {};
+struct ParseError {};
+
+
+bool tryStringToInt(String aString, int * oValue, int aRadix)
+{
+    try 
+    { 
+        *oValue = stoi(aString.rb(), NULL, aRadix); 
+        return true;
+    } 
+    catch (logic_error) 
+    { 
+        return false; 
+    };
+}
+
+
+
+// Logging  ///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int verbosityLevel = 1;
+const int maxVerbosityLevel = 5;
+
+
+// Messages are collected in log and written to console at once by flush (e.g. after each source file) or when the log 
+// is full. Message is formatted only when its level is within verbosity. Task log (without console) collects messages 
+// of the task running in other thread and it is appended to console log in source order so the output doesn't depend 
+// on timing of the threads.
+class ConsoleLog
+{
+    public:
+        ConsoleLog(FILE * aConsole = NULL)
+        {
+            fConsole = aConsole;
+            fWasWrite = false;
+        }
+
+        ~ConsoleLog()
+        {
+            flush();
+        }
+
+        ConsoleLog(const ConsoleLog &) = delete;
+        ConsoleLog & operator = (const ConsoleLog &) = delete;
+
+        static bool isWriting(int aLevel)
+        {
+            return aLevel <= verbosityLevel;
+        }
+
+        void writeList(int aLevel, const char * aTemplate, va_list anArguments)
+        {
+            if (!isWriting(aLevel))
+                return;
+
+            writeText(aLevel, String::formattedList(aTemplate, anArguments));
+        }
+
+        // Writes aText as it is (e.g. long text which doesn't have to be formatted).
+        void writeText(int aLevel, StringView aText)
+        {
+            if (!isWriting(aLevel))
+                return;
+
+            if (fWasWrite && aLevel == 0) 
+                fText.append('\n');  // indent error message from previous text
+
+            fText.append(aText);
+            fText.append('\n');
+
+            fWasWrite = true;
+
+            if (fText.length() >= consoleLogFlushSize)
+                flush();
+        }
+
+        // Moves messages of task log ioLog behind the messages of this log.
+        void append(ConsoleLog * ioLog)
+        {
+            if (ioLog->fText.isEmpty())
+                return;
+
+            fText.append(ioLog->fText.view());
+            ioLog->fText.clear();
+
+            fWasWrite = true;
+
+            if (fText.length() >= consoleLogFlushSize)
+                flush();
+        }
+
+        // Writes collected messages to console (task log keeps them until they are appended to console log).
+        void flush()
+        {
+            if (!fConsole || fText.isEmpty())
+                return;
+
+            fwrite(fText.view().chars(), 1, (size_t) fText.length(), fConsole);
+            fflush(fConsole);
+            fText.clear();
+        }
+
+    private:
+        FILE * fConsole;
+        StringBuilder fText;
+        bool fWasWrite;
+};
+
+
+ConsoleLog consoleLog(stdout);
+
+
+void consoleWrite(int aLevel, const char * aTemplate, ...)
+{
+    if (!ConsoleLog::isWriting(aLevel))
+        return;
+
+    va_list arguments;
+    va_start(arguments, aTemplate);
+    consoleLog.writeList(aLevel, aTemplate, arguments);
+    va_end(arguments);
+}
+
+
+
+// Collecting Statistics //////////////////////////////////////////////////////////////////////////////////////////////
+
+// With --stats time spent in phases of extraction and counts of processed items are collected and their summary is 
+// printed when the extraction is finished. Time of each thread is counted to the phase of its innermost phase scope 
+// so the phases don't overlap and time of phase running in more threads (e.g. reading) is summed over the threads. 
+// When statistics are not collected the scopes and counters only test the flag.
+
+bool isCollectingStatistics = false;  // set before other threads are started
+
+enum Phase { phNone, phWalk, phRead, phClean, phScan, phParse, phWait, phWrite, phaseCount };
+
+const char * const phaseNames[phaseCount] = { "", "walk", "read", "clean", "scan", "parse", "wait", "write" };
+
+// String memory is attributed to the phase of thread (memory out of phases to tag "other").
+MemoryTag phaseMemoryTags[phaseCount] = { 
+    MemoryTag("other"), MemoryTag("walk"), MemoryTag("read"), MemoryTag("clean"), 
+    MemoryTag("scan"), MemoryTag("parse"), MemoryTag("wait"), MemoryTag("write") 
+};
+
+enum Counter { ctFiles, ctSourceBytes, ctTables, ctSymbols, ctWrittenBytes, ctAllocations, counterCount };
+
+
+struct FileStatistics
+{
+    string path;
+    double seconds;
+    long long sourceBytes;
+    long long symbolCount;
+};
+
+
+class Statistics
+{
+    public:
+        static const int slowestFileCount = 5;
+
+        Statistics()
+        {
+            reset();
+        }
+
+        void addTime(Phase aPhase, long long aNanoseconds)
+        {
+            fPhaseNanoseconds[aPhase].fetch_add(aNanoseconds, memory_order_relaxed);
+        }
+
+        void count(Counter aCounter, long long anAmount = 1)
+        {
+            if (isCollectingStatistics)
+                fCounters[aCounter].fetch_add(anAmount, memory_order_relaxed);
+        }
+
+        long long counter(Counter aCounter) const
+        {
+            return fCounters[aCounter].load(memory_order_relaxed);
+        }
+
+        double phaseSeconds(Phase aPhase) const
+        {
+            return (double) fPhaseNanoseconds[aPhase].load(memory_order_relaxed) / 1e9;
+        }
+
+        const vector<FileStatistics> & files() const
+        {
+            return fFiles;
+        }
+
+        // Called when no extraction is running (e.g. between runs of benchmark).
+        void reset()
+        {
+            for (auto & nanoseconds : fPhaseNanoseconds)
+                nanoseconds = 0;
+
+            for (auto & counter : fCounters)
+                counter = 0;
+
+            fFiles.clear();
+        }
+
+        // Called in the main thread when the file was processed.
+        void addFile(const FileStatistics & aFile)
+        {
+            count(ctFiles);
+            count(ctSourceBytes, aFile.sourceBytes);
+
+            fFiles.push_back(aFile);
+        }
+
+        void print(double aWallSeconds)
+        {
+            MemoryAccounting::stop();  // memory of the printed text is not counted
+
+            double seconds = max(aWallSeconds, 1e-9);
+            double megabytes = (double) counter(ctSourceBytes) / (1 << 20);
+
+            String text = "Statistics:\n";
+            text.appendFormatted("  Time: %.3f s\n", aWallSeconds);
+            text.appendFormatted("  Files: %lld (%.1f files/s)\n", counter(ctFiles), (double) counter(ctFiles) / seconds);
+            text.appendFormatted("  Source: %.2f MiB (%.2f MiB/s)\n", megabytes, megabytes / seconds);
+            text.appendFormatted("  Tables: %lld\n", counter(ctTables));
+            text.appendFormatted("  Symbols: %lld (%.0f symbols/s)\n", counter(ctSymbols), (double) counter(ctSymbols) / seconds);
+            text.appendFormatted("  Written: %.2f MiB\n", (double) counter(ctWrittenBytes) / (1 << 20));
+            text.appendFormatted("  Allocations: %lld (new)\n", counter(ctAllocations));
+
+            MemoryCounts memory = MemoryAccounting::total();
+            text.appendFormatted("  String memory: %lld allocations, %lld reallocations, %lld releases, %lld detaches, "
+                "%.2f MiB allocated, %.2f MiB peak\n", 
+                memory.allocationCount, memory.reallocationCount, memory.releaseCount, memory.detachCount, 
+                (double) memory.allocatedBytes / (1 << 20), (double) memory.peakBytes / (1 << 20));
+
+            text.append("  String memory by phases:\n");
+
+            for (const auto & tag : phaseMemoryTags)
+            {
+                MemoryCounts tagMemory = tag.counts();
+                text.appendFormatted("    %-6s %lld allocations, %lld reallocations, %lld detaches, %.2f MiB\n", 
+                    tag.name(), tagMemory.allocationCount, tagMemory.reallocationCount, tagMemory.detachCount, 
+                    (double) tagMemory.allocatedBytes / (1 << 20));
+            }
+
+            text.append("  Phases (seconds summed over threads):\n");
+
+            for (int phase = phNone + 1; phase < phaseCount; phase++)
+                text.appendFormatted("    %-6s %.3f\n", phaseNames[phase], phaseSeconds((Phase) phase));
+
+            sort(fFiles.begin(), fFiles.end(), [](const FileStatistics & aFile, const FileStatistics & anOther) { 
+                return aFile.seconds > anOther.seconds; 
+            });
+
+            text.append("  Slowest files:");
+
+            for (size_t index = 0; index < fFiles.size() && index < slowestFileCount; index++)
+                text.appendFormatted("\n    %.3f s  %s (%lld bytes, %lld symbols)", 
+                    fFiles[index].seconds, fFiles[index].path.c_str(), fFiles[index].sourceBytes, fFiles[index].symbolCount);
+
+            consoleWrite(0, "%s", text.rb());
+        }
+
+    private:
+        atomic<long long> fPhaseNanoseconds[phaseCount];
+        atomic<long long> fCounters[counterCount];
+        vector<FileStatistics> fFiles;
+};
+
+
+Statistics statistics;
+
+
+// Allocations made by new are counted (String reports its memory to MemoryAccounting).
+void * operator new(size_t aSize)
+{
+    statistics.count(ctAllocations);
+
+    void * pointer = malloc(aSize > 0 ? aSize : 1);
+
+    if (!pointer)
+        throw bad_alloc();
+
+    return pointer;
+}
+
+
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wpragmas"
+    #pragma GCC diagnostic ignored "-Wmismatched-new-delete"  // GCC doesn't see that operator new above uses malloc
+#endif
+
+void operator delete(void * aPointer) noexcept
+{
+    free(aPointer);
+}
+
+
+void operator delete(void * aPointer, size_t) noexcept
+{
+    free(aPointer);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic pop
+#endif
+
+
+
+// Tracing Phases /////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// With --trace-out spans of the phases of each thread (see PhaseScope) and spans of the source files are recorded and 
+// written after the extraction as Chrome trace events which can be opened in trace viewer (chrome://tracing or 
+// Perfetto). Each thread records to its own buffer without locking and the buffers are read only after the threads 
+// ended. When the buffer of the thread is full its oldest spans are overwritten.
+
+bool isTracing = false;  // set before other threads are started
+
+
+struct TraceSpan
+{
+    Phase phase;
+    long long startTime;  // nanoseconds from start of the program
+    long long duration;  // nanoseconds
+};
+
+
+class TraceBuffer
+{
+    public:
+        static const size_t capacity = 1 << 16;
+
+        TraceBuffer(const char * aThreadName)
+        {
+            fThreadName = aThreadName;
+            fAddedCount = 0;
+        }
+
+        void add(const TraceSpan & aSpan)
+        {
+            if (fSpans.size() < capacity)
+                fSpans.push_back(aSpan);
+            else
+                fSpans[fAddedCount % capacity] = aSpan;
+
+            fAddedCount += 1;
+        }
+
+        const char * threadName() const
+        {
+            return fThreadName;
+        }
+
+        const vector<TraceSpan> & spans() const
+        {
+            return fSpans;
+        }
+
+    private:
+        const char * fThreadName;
+        vector<TraceSpan> fSpans;
+        size_t fAddedCount;
+};
+
+
+class Trace
+{
+    public:
+        Trace()
+        {
+            fStartTime = chrono::steady_clock::now();
+        }
+
+        // Names the current thread in the trace (it has to be called before the thread records the first span).
+        static void nameThread(const char * aName)
+        {
+            fThreadName = aName;
+        }
+
+        long long timeOf(chrono::steady_clock::time_point aTime) const
+        {
+            return chrono::duration_cast<chrono::nanoseconds>(aTime - fStartTime).count();
+        }
+
+        void add(const TraceSpan & aSpan)
+        {
+            if (!fThreadBuffer)
+            {
+                lock_guard<mutex> lock(fMutex);
+                fBuffers.emplace_back(new TraceBuffer(fThreadName));  // buffer outlives its thread
+                fThreadBuffer = fBuffers.back().get();
+            }
+
+            fThreadBuffer->add(aSpan);
+        }
+
+        // Called in the main thread when the file was processed.
+        void addFile(String aFilePath, chrono::steady_clock::time_point aStartTime)
+        {
+            fFiles.push_back(FileSpan { aFilePath.rb(), timeOf(aStartTime), timeOf(chrono::steady_clock::now()) - timeOf(aStartTime) });
+        }
+
+        // Writes the recorded spans when all threads except the main thread ended.
+        void write(String aFilePath)
+        {
+            StringBuilder text;
+            text.append("{\"traceEvents\":[\n");
+            text.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"files\"}}");
+
+            for (const auto & file : fFiles)
+            {
+                text.append(",\n{\"name\":");
+                appendJsonString(&text, file.path);
+                text.append(",\"cat\":\"file\",\"ph\":\"X\",\"pid\":1,\"tid\":0");
+                appendTimes(&text, file.startTime, file.duration);
+                text.append('}');
+            }
+
+            for (size_t index = 0; index < fBuffers.size(); index++)
+            {
+                int threadId = (int) index + 1;
+                
+                text.appendFormatted(lf(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}"),
+                    threadId, fBuffers[index]->threadName(), threadId);
+
+                for (const auto & span : fBuffers[index]->spans())
+                {
+                    text.appendFormatted(lf(",\n{\"name\":\"%s\",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":1,\"tid\":%d"), 
+                        phaseNames[span.phase], threadId);
+                    appendTimes(&text, span.startTime, span.duration);
+                    text.append('}');
+                }
+            }
+
+            text.append("\n]}\n");
+
+            try {
+                ofstream file;
+                file.exceptions(ios::badbit | ios::failbit);
+                file.open(aFilePath.rb(), ios::out | ios::binary);
+                file.write(text.view().chars(), text.length());
+                file.close();
+            }
+            catch (ofstream::failure error) {
+                throw String::formatted(
+                    lf("Can not write file \"%s\".\n%s"), 
+                    aFilePath.rb(), error.what());
+            }
+        }
+
+    private:
+        struct FileSpan
+        {
+            string path;
+            long long startTime;
+            long long duration;
+        };
+
+        // Appends start time and duration in microseconds (unit of trace events).
+        static void appendTimes(StringBuilder * ioText, long long aStartTime, long long aDuration)
+        {
+            ioText->appendFormatted(lf(",\"ts\":%d.%03d,\"dur\":%d.%03d"), 
+                aStartTime / 1000, aStartTime % 1000, aDuration / 1000, aDuration % 1000);
+        }
+
+        static void appendJsonString(StringBuilder * ioText, const string & aText)
+        {
+            ioText->append('"');
+
+            for (char aChar : aText)
+                if (aChar == '"' || aChar == '\\')
+                {
+                    ioText->append('\\');
+                    ioText->append(aChar);
+                }
+                else if ((unsigned char) aChar < 0x20)
+                    ioText->appendFormatted(lf("\\u%04x"), (int) (unsigned char) aChar);
+                else
+                    ioText->append(aChar);
+
+            ioText->append('"');
+        }
+
+    private:
+        chrono::steady_clock::time_point fStartTime;
+        mutex fMutex;
+        vector<unique_ptr<TraceBuffer>> fBuffers;
+        vector<FileSpan> fFiles;
+
+        static thread_local TraceBuffer * fThreadBuffer;
+        static thread_local const char * fThreadName;
+};
+
+
+thread_local TraceBuffer * Trace::fThreadBuffer = NULL;
+thread_local const char * Trace::fThreadName = "thread";
+
+
+Trace trace;
+
+
+
+// Measuring Phases ///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Counts time of the current thread to aPhase until the end of the scope and then again to the phase of enclosing scope.
+class PhaseScope
+{
+    public:
+        PhaseScope(Phase aPhase)
+        {
+            if (isCollectingStatistics || isTracing)
+                fEnclosingPhase = switchTo(aPhase);
+        }
+
+        ~PhaseScope()
+        {
+            if (isCollectingStatistics || isTracing)
+                switchTo(fEnclosingPhase);
+        }
+
+        PhaseScope(const PhaseScope &) = delete;
+        PhaseScope & operator = (const PhaseScope &) = delete;
+
+    private:
+        static Phase switchTo(Phase aPhase)
+        {
+            auto now = chrono::steady_clock::now();
+
+            if (fCurrentPhase != phNone)
+            {
+                long long duration = chrono::duration_cast<chrono::nanoseconds>(now - fPhaseStartTime).count();
+                statistics.addTime(fCurrentPhase, duration);
+
+                if (isTracing)
+                    trace.add(TraceSpan { fCurrentPhase, trace.timeOf(fPhaseStartTime), duration });
+            }
+
+            Phase previousPhase = fCurrentPhase;
+            fCurrentPhase = aPhase;
+            fPhaseStartTime = now;
+
+            if (isCollectingStatistics)
+                MemoryAccounting::setCurrentTag(&phaseMemoryTags[aPhase]);
+
+            return previousPhase;
+        }
+
+    private:
+        Phase fEnclosingPhase;
+
+        static thread_local Phase fCurrentPhase;
+        static thread_local chrono::steady_clock::time_point fPhaseStartTime;
+};
+
+
+thread_local Phase PhaseScope::fCurrentPhase = phNone;
+thread_local chrono::steady_clock::time_point PhaseScope::fPhaseStartTime;
+
+
+
+// File System Utilities //////////////////////////////////////////////////////////////////////////////////////////////
+
+String extractFileNameWithoutExtension(String aFilePath)
+{
+    return filesystem::path(aFilePath.rb()).filename().replace_extension().string().c_str();
+}
+
+
+void createDirectoryPath(String aDirectory)
+{
+    try { 
+        filesystem::create_directories(aDirectory.rb()); 
+    } 
+    catch (exception error) {
+        throw String::formatted(
+            lf("Can't create output directory \"%s\".\n%s"), 
+            aDirectory.rb(), error.what());
+    }
+}
+
+
+
+// Extraction Pipeline //////////////////////////////////////////////////////////////////////////////////////////////
+
+// Extraction runs in three stages: reader threads read source files ahead (see SourceReader), main thread parses them
+// and formats tables, writer threads write the table files (see OutputWriter). Stages are connected by queues with 
+// limited count of bytes so the faster stage waits for the slower one and memory doesn't grow without bound.
+// Several files are opened, read and written at once so waiting for one file doesn't stall the others.
+
+const int defaultInflightBudget = 64;
+const int maxInflightBudget = 4096;
+
+int inflightBudget = defaultInflightBudget;  // MiB of data read ahead and waiting for writing (half for each queue)
+
+
+size_t inflightQueueByteCapacity()
+{
+    return (size_t) inflightBudget * (1 << 20) / 2;
+}
+
+
+template <class Item>
+class BoundedQueue
+{
+    public:
+        BoundedQueue(size_t aByteCapacity)
+        {
+            fByteCapacity = aByteCapacity;
+            fByteSize = 0;
+            fIsClosed = false;
+        }
+
+        // Waits while the queue is full (single item larger than capacity is accepted by empty queue).
+        // Returns false when the queue is closed and the item is dropped.
+        bool push(Item anItem, size_t aByteSize)
+        {
+            unique_lock<mutex> lock(fMutex);
+            fNotFull.wait(lock, [&] { return fIsClosed || fByteSize == 0 || fByteSize + aByteSize <= fByteCapacity; });
+
+            if (fIsClosed)
+                return false;
+
+            fItems.push_back(Entry { move(anItem), aByteSize });
+            fByteSize += aByteSize;
+            fNotEmpty.notify_one();
+
+            return true;
+        }
+
+        // Waits for next item. Returns false when the queue is closed and empty.
+        bool pop(Item * oItem)
+        {
+            unique_lock<mutex> lock(fMutex);
+            fNotEmpty.wait(lock, [&] { return fIsClosed || !fItems.empty(); });
+
+            if (fItems.empty())
+                return false;
+
+            *oItem = move(fItems.front().item);
+            fByteSize -= fItems.front().byteSize;
+            fItems.pop_front();
+            fNotFull.notify_one();
+
+            return true;
+        }
+
+        // Items are not accepted after closing but the remaining items can be popped.
+        void close()
+        {
+            lock_guard<mutex> lock(fMutex);
+            fIsClosed = true;
+            fNotFull.notify_all();
+            fNotEmpty.notify_all();
+        }
+
+    private:
+        struct Entry
+        {
+            Item item;
+            size_t byteSize;
+        };
+
+        mutex fMutex;
+        condition_variable fNotFull;
+        condition_variable fNotEmpty;
+        deque<Entry> fItems;
+        size_t fByteSize;
+        size_t fByteCapacity;
+        bool fIsClosed;
+};
+
+
+
+// Reading Source Files ///////////////////////////////////////////////////////////////////////////////////////////////
+
+// Only standard strings are passed between threads because String doesn't count references atomically.
+struct SourceBlock
+{
+    unique_ptr<char[]> chars;  // headroom, text and terminating null character, not initialized before reading
+    size_t length = 0;
+    string error;  // message when the file can't be read
+    bool isLast = false;  // the last block of the file
+
+    char * text() const
+    {
+        return chars.get() + sourceBlockHeadroom;
+    }
+};
+
+
+// Reads the source files in reader threads, each thread reads one whole file at a time. Only files close behind the file
+// being parsed are read so their blocks don't take more than the queue capacity (which is split among the files).
+class SourceReader
+{
+    public:
+        SourceReader(const vector<String> & aFilePaths)
+        {
+            for (const auto & filePath : aFilePaths)
+            {
+                fFilePaths.push_back(filePath.rb());
+                fFileBlocks.emplace_back(new BoundedQueue<SourceBlock>(inflightQueueByteCapacity() / sourceReaderCount));
+            }
+
+            fNextFileIndex = 0;
+            fTakenFileIndex = 0;
+            fIsClosed = false;
+
+            for (int order = 0; order < sourceReaderCount; order++)
+                fThreads.emplace_back([this] { Trace::nameThread("reader"); run(); });
+        }
+
+        ~SourceReader()
+        {
+            {
+                lock_guard<mutex> lock(fMutex);
+                fIsClosed = true;  // stops reading when extraction was interrupted by error
+                fCanStartFile.notify_all();
+            }
+
+            for (auto & blocks : fFileBlocks)
+                blocks->close();
+
+            for (auto & thread : fThreads)
+                thread.join();
+        }
+
+        // Returns next block of the file being parsed. Blocks of the files come in order of the file paths.
+        SourceBlock takeBlock()
+        {
+            SourceBlock block;
+            {
+                PhaseScope waiting(phWait);
+                bool taken = fFileBlocks[fTakenFileIndex]->pop(&block);
+                assert(taken);
+            }
+
+            if (block.isLast)
+            {
+                lock_guard<mutex> lock(fMutex);
+                fTakenFileIndex += 1;  // queue of the file is kept because its reader thread may still be leaving it
+                fCanStartFile.notify_all();
+            }
+
+            if (!block.error.empty())
+                throw String(block.error.c_str());
+
+            return block;
+        }
+
+        // Hands characters of aConsumedBlock back for reading of next blocks.
+        void releaseBlock(SourceBlock * aConsumedBlock)
+        {
+            if (aConsumedBlock->chars)
+            {
+                lock_guard<mutex> lock(fMutex);
+                fFreeChars.push_back(move(aConsumedBlock->chars));  // reusing avoids page faults of fresh memory
+            }
+        }
+
+    private:
+        void run()
+        {
+            while (true)
+            {
+                size_t fileIndex;
+
+                {
+                    unique_lock<mutex> lock(fMutex);
+                    fCanStartFile.wait(lock, [&] { 
+                        return fIsClosed || fNextFileIndex >= fFilePaths.size() || fNextFileIndex < fTakenFileIndex + sourceReaderCount; 
+                    });
+
+                    if (fIsClosed || fNextFileIndex >= fFilePaths.size())
+                        return;
+
+                    fileIndex = fNextFileIndex;
+                    fNextFileIndex += 1;
+                }
+
+                PhaseScope reading(phRead);
+
+                if (!readFile(fFilePaths[fileIndex], fFileBlocks[fileIndex].get()))
+                    return;
+            }
+        }
+
+        bool readFile(const string & aFilePath, BoundedQueue<SourceBlock> * oBlocks)
+        {
+            ifstream file;
+
+            try {
+                file.exceptions(ios::badbit | ios::failbit);
+                file.open(aFilePath, ios::binary);
+                file.exceptions(ios::badbit);  // reaching end of file is not an error
+
+                while (true)
+                {
+                    SourceBlock block;
+                    block.chars = allocateChars();
+                    file.read(block.text(), sourceBlockSize);
+                    block.length = (size_t) file.gcount();
+                    block.isLast = file.eof();
+
+                    bool isLast = block.isLast;
+                    size_t size = block.length;
+
+                    PhaseScope waiting(phNone);  // waiting for parsing of the previous files is not counted
+
+                    if (!oBlocks->push(move(block), size))
+                        return false;
+
+                    if (isLast)
+                        return true;
+                }
+            }
+            catch (ifstream::failure error) {
+                SourceBlock block;
+                block.error = String::formatted(
+                    lf("Can not read file \"%s\".\n%s"), 
+                    aFilePath.c_str(), error.what()).rb();
+                block.isLast = true;
+
+                return oBlocks->push(move(block), 0);
+            }
+        }
+
+        unique_ptr<char[]> allocateChars()
+        {
+            lock_guard<mutex> lock(fMutex);
+
+            if (fFreeChars.empty())
+                return unique_ptr<char[]>(new char[sourceBlockHeadroom + sourceBlockSize + 1]);
+
+            unique_ptr<char[]> chars = move(fFreeChars.back());
+            fFreeChars.pop_back();
+
+            return chars;
+        }
+
+    private:
+        vector<string> fFilePaths;
+        vector<unique_ptr<BoundedQueue<SourceBlock>>> fFileBlocks;  // blocks of each file
+        mutex fMutex;
+        condition_variable fCanStartFile;
+        size_t fNextFileIndex;  // next file to be read
+        size_t fTakenFileIndex;  // file being parsed
+        bool fIsClosed;
+        vector<unique_ptr<char[]>> fFreeChars;
+        vector<thread> fThreads;
+};
+
+
+
+// Parsing Source File in Windows /////////////////////////////////////////////////////////////////////////////////////
+
+// Source file is parsed in window of limited size so memory used for parsing doesn't depend on size of the file.
+// The window refers to the block taken from reader so the text is written only once when it is read. When already 
+// parsed text is dropped, the rest of the text is copied to the headroom of next block just before its text. Only 
+// single parsed item (see loadItem) longer than the headroom is collected in a buffer of the window.
+class SourceWindow
+{
+    public:
+        SourceWindow(SourceReader * ioReader)
+        {
+            fReader = ioReader;
+            fBlock = fReader->takeBlock();
+            fReadLength = (long long) fBlock.length;
+            fIsAtEnd = fBlock.isLast;
+            fIsBuffered = false;
+
+            fBlock.text()[fBlock.length] = '\0';
+            fChars = fBlock.text();
+            fLength = (ViewIndex) fBlock.length;
+        }
+
+        // Creates window containing whole aText which is not taken from reader (e.g. part of other window).
+        SourceWindow(StringView aText)
+        {
+            fReader = NULL;
+            fChars = aText.chars();
+            fLength = aText.length();
+            fReadLength = aText.length();
+            fIsAtEnd = true;
+            fIsBuffered = false;
+        }
+
+        ~SourceWindow()
+        {
+            if (fReader)
+                fReader->releaseBlock(&fBlock);
+        }
+
+        SourceWindow(const SourceWindow &) = delete;
+        SourceWindow & operator = (const SourceWindow &) = delete;
+
+        StringView text() const
+        {
+            return StringView(fChars, fLength);
+        }
+
+        // Returns count of characters of the file taken to the window so far.
+        long long readLength() const
+        {
+            return fReadLength;
+        }
 
+        // Returns true when the window contains the rest of the file.
+        bool isAtEnd() const
+        {
+            return fIsAtEnd;
+        }
 
-bool tryStringToInt(String aString, int * oValue, int aRadix)
-{
-    try 
-    { 
-        *oValue = stoi(aString.rb(), NULL, aRadix); 
-        return true;
-    } 
-    catch (logic_error) 
-    { 
-        return false; 
-    };
-}
+        // Drops text before aKeptIndex and takes next part of the file behind the rest of the text.
+        // Returns count of dropped characters (indexes to the text have to be decreased by this count).
+        ViewIndex advance(ViewIndex aKeptIndex)
+        {
+            assert(!fIsAtEnd);
 
+            SourceBlock block = fReader->takeBlock();
+            fReadLength += (long long) block.length;
+            fIsAtEnd = block.isLast;
 
+            ViewIndex keptLength = fLength - aKeptIndex;
 
-// Logging  ///////////////////////////////////////////////////////////////////////////////////////////////////////////
+            if (keptLength <= sourceBlockHeadroom)
+            {
+                char * text = block.text() - keptLength;
+                memcpy(text, fChars + aKeptIndex, (size_t) keptLength);
+                text[keptLength + (ViewIndex) block.length] = '\0';
 
-int verbosityLevel = 1;
-const int maxVerbosityLevel = 5;
+                fChars = text;
+                fLength = keptLength + (ViewIndex) block.length;
+                fIsBuffered = false;
+            }
+            else
+            {
+                if (fIsBuffered)
+                    fBuffer.erase(0, (size_t) aKeptIndex);
+                else
+                    fBuffer.assign(fChars + aKeptIndex, (size_t) keptLength);
 
+                fBuffer.append(block.text(), block.length);
 
-void consoleWrite(int aLevel, const char * aTemplate, ...)
-{
-    if (aLevel > verbosityLevel)
-        return;
+                fChars = fBuffer.data();
+                fLength = (ViewIndex) fBuffer.size();
+                fIsBuffered = true;
+            }
 
-    va_list arguments;
-    va_start(arguments, aTemplate);
-    String text = String::formattedList(aTemplate, arguments);
-    va_end(arguments);
+            fReader->releaseBlock(&fBlock);
+            fBlock = move(block);
 
-    static bool wasWrite = false;
+            return aKeptIndex;
+        }
 
-    if (wasWrite && aLevel == 0) 
-        printf("\n");  // indent error message from previous text
+    private:
+        SourceReader * fReader;
+        SourceBlock fBlock;  // the last block taken from reader
+        long long fReadLength;
+        string fBuffer;  // text of item longer than the headroom of block
+        const char * fChars;  // text in block, buffer or text given to constructor
+        ViewIndex fLength;
+        bool fIsAtEnd;
+        bool fIsBuffered;
+};
 
-    printf("%s\n", text.rb());
 
-    wasWrite = true;
-}
 
+// Writing Output Files ///////////////////////////////////////////////////////////////////////////////////////////////
 
+// With --bench and without output folder the table files are neither deleted nor created. Tables are formatted and 
+// handed over to writer threads as usual but the writing tasks only release their data.
+bool isDiscardingOutput = false;  // set before other threads are started
 
-// File System Utilities //////////////////////////////////////////////////////////////////////////////////////////////
 
-String extractFileNameWithoutExtension(String aFilePath)
+// Executes writing tasks in writer threads. Tasks posted with the same key (e.g. tasks of one file) are executed 
+// in order of posting by the same thread. After a failed task the tasks posted later are skipped and the error of 
+// the earliest posted failed task is thrown by waitUntilIdle or throwError in the main thread.
+class OutputWriter
 {
-    return filesystem::path(aFilePath.rb()).filename().replace_extension().string().c_str();
-}
+    public:
+        OutputWriter()
+        {
+            fPostedCount = 0;
+            fPendingCount = 0;
+            fHasError = false;
+            fErrorOrder = 0;
 
+            for (int order = 0; order < tableWriterCount; order++)
+                fTasks.emplace_back(new BoundedQueue<Task>(inflightQueueByteCapacity() / tableWriterCount));
 
-void createDirectoryPath(String aDirectory)
-{
-    try { 
-        filesystem::create_directories(aDirectory.rb()); 
-    } 
-    catch (exception error) {
-        throw String::formatted(
-            "Can't create output directory \"%s\".\n%s", 
-            aDirectory.rb(), error.what());
-    }
-}
+            for (auto & tasks : fTasks)
+            {
+                BoundedQueue<Task> * threadTasks = tasks.get();
+                fThreads.emplace_back([this, threadTasks] { Trace::nameThread("writer"); run(threadTasks); });
+            }
+        }
+
+        ~OutputWriter()
+        {
+            for (auto & tasks : fTasks)
+                tasks->close();  // the remaining tasks are executed before the threads end
 
+            for (auto & thread : fThreads)
+                thread.join();
+        }
 
+        // Posts aTask holding aByteSize bytes of data for writing. Waits while too much data waits for writing.
+        void post(function<void ()> aTask, size_t aByteSize, size_t aKey)
+        {
+            Task task { move(aTask), 0 };
 
-// Reading and Writing String to File /////////////////////////////////////////////////////////////////////////////////
+            {
+                lock_guard<mutex> lock(fMutex);
+                fPendingCount += 1;
+                fPostedCount += 1;
+                task.order = fPostedCount;
+            }
 
-String readStringFromFile(String aFilePath)
-{
-    ifstream file;
-    file.exceptions(ios::badbit | ios::failbit);
+            PhaseScope waiting(phWait);
+            fTasks[aKey % fTasks.size()]->push(move(task), aByteSize);
+        }
 
-    try {
-        file.open(aFilePath.rb());
+        // Waits until all posted tasks are executed and throws error of failed task.
+        void waitUntilIdle()
+        {
+            {
+                PhaseScope waiting(phWait);
+                unique_lock<mutex> lock(fMutex);
+                fIdle.wait(lock, [&] { return fPendingCount == 0; });
+            }
 
-        ostringstream stream;
-        stream << file.rdbuf();
+            throwError();
+        }
 
-        String text = stream.str().c_str();
-        return text;
-    }
-    catch (ifstream::failure error) {
-        throw String::formatted(
-            "Can not read file \"%s\".\n%s", 
-            aFilePath.rb(), error.what());
-    }
-}
+        void throwError()
+        {
+            lock_guard<mutex> lock(fMutex);
 
+            if (fHasError)
+                throw String(fError.c_str());
+        }
 
-void writeStringToFile(String aFilePath, String aString)
-{
-    ofstream file;
-    file.exceptions(ios::badbit | ios::failbit);
+    private:
+        struct Task
+        {
+            function<void ()> run;
+            long long order;  // order of posting
+        };
 
-    try {
-        file.open(aFilePath.rb(), ios::out);
-        file << aString.rb();
-    }
-    catch (ifstream::failure error) {
-        throw String::formatted(
-            "Can not write file \"%s\".\n%s", 
-            aFilePath.rb(), error.what());
-    }
-}
+        void run(BoundedQueue<Task> * ioTasks)
+        {
+            Task task;
+
+            while (ioTasks->pop(&task))
+            {
+                string error;
+
+                if (!hasErrorBefore(task.order))
+                    try {
+                        PhaseScope writing(phWrite);
+                        task.run();
+                    }
+                    catch (String taskError) {
+                        error = taskError.rb();
+                    }
+                    catch (exception taskError) {
+                        error = taskError.what();
+                    }
+
+                task.run = nullptr;  // releases data held by the task
+
+                lock_guard<mutex> lock(fMutex);
+
+                if (!error.empty() && (!fHasError || task.order < fErrorOrder))
+                {
+                    fError = error;
+                    fErrorOrder = task.order;
+                    fHasError = true;
+                }
+
+                fPendingCount -= 1;
+                fIdle.notify_all();
+            }
+        }
+
+        bool hasErrorBefore(long long anOrder)
+        {
+            lock_guard<mutex> lock(fMutex);
+            return fHasError && fErrorOrder < anOrder;
+        }
+
+    private:
+        vector<unique_ptr<BoundedQueue<Task>>> fTasks;  // tasks of each thread
+        mutex fMutex;
+        condition_variable fIdle;
+        long long fPostedCount;
+        int fPendingCount;
+        bool fHasError;
+        long long fErrorOrder;  // order of the task which failed
+        string fError;
+        vector<thread> fThreads;
+};
 
 
 
@@ -138,10 +1158,10 @@ void writeStringToFile(String aFilePath, String aString)
 const String tableFileExtension = "txt";
 
 
-String buildTableFilePath(String anOutputDirectoryPath, String aVerilogFilePath, String aTableName)
+String buildTableFilePath(String anOutputDirectoryPath, String aVerilogFilePath, Atom aTableName)
 {
     String verilogFileName = extractFileNameWithoutExtension(aVerilogFilePath);
-    String tableFileName = verilogFileName + '.' + aTableName + '.' + tableFileExtension;
+    String tableFileName = verilogFileName + '.' + aTableName.text() + '.' + tableFileExtension;
 
     filesystem::path tableFilePath;
     tableFilePath.append(anOutputDirectoryPath.rb());
@@ -156,13 +1176,14 @@ bool isTableFileName(String aTestedFileName, String aVerilogFilePath)
     String verilogFileName = extractFileNameWithoutExtension(aVerilogFilePath);
     assert(verilogFileName != "");
 
-    ParsingContext context("."); 
+    StringParts parts;
+    aTestedFileName.split(&parts, ".");
 
     return 
-        aTestedFileName.partCount(context) == 3 &&
-        aTestedFileName.part(0, context).equals(verilogFileName, filePathEqualityMode) &&
-        aTestedFileName.part(1, context) != "" &&
-        aTestedFileName.part(2, context).equals(tableFileExtension, filePathEqualityMode);
+        parts.count() == 3 &&
+        parts.text(0).equals(verilogFileName, filePathEqualityMode) &&
+        !parts.text(1).isEmpty() &&
+        parts.text(2).equals(tableFileExtension, filePathEqualityMode);
 }
 
 
@@ -189,30 +1210,69 @@ VerilogNumber bitWidthMask(int aBitWidth)
 }
 
 
-bool tryStringToVerilogNumber(String aString, VerilogNumber * oValue, int aRadix)
+int digitValue(char aChar)
 {
-    try { 
-        *oValue = stoull(aString.rb(), NULL, aRadix); 
-        return true;
-    } 
-    catch (logic_error) { 
-        return false; 
-    };
+    if (aChar >= '0' && aChar <= '9') return aChar - '0';
+    if (aChar >= 'A' && aChar <= 'Z') return aChar - 'A' + 10;
+    if (aChar >= 'a' && aChar <= 'z') return aChar - 'a' + 10;
+    return INT_MAX;
+}
+
+
+bool tryDigitsToVerilogNumber(StringView aDigits, VerilogNumber * oValue, int aRadix)
+{
+    // same result as stoull applied to the digits with removed underscores (conversion stops at first invalid digit)
+
+    VerilogNumber value = 0;
+    int digitCount = 0;
+
+    for (ViewIndex index = 0; index < aDigits.length(); index++)
+    {
+        if (aDigits[index] == '_')
+            continue;
+
+        int digit = digitValue(aDigits[index]);
+        if (digit >= aRadix)
+            break;
+
+        if (value > (ULLONG_MAX - digit) / aRadix)
+            return false;  // out of range
+
+        value = value * aRadix + digit;
+        digitCount += 1;
+    }
+
+    if (!digitCount)
+        return false;
+
+    *oValue = value;
+    return true;
+}
+
+
+bool tryDigitsToInt(StringView aDigits, int * oValue)
+{
+    VerilogNumber value;
+    if (!tryDigitsToVerilogNumber(aDigits, &value, 10) || value > INT_MAX)
+        return false;
+
+    *oValue = (int) value;
+    return true;
 }
 
 
 String verilogNumberToHexString(VerilogNumber aNumber, int aDigitCount)
 {
-    String result = String::formatted("%llX", aNumber);
-    result.padLeft(aDigitCount, '0');
-    return result;
+    StringBuilder result;
+    result.appendHex(aNumber, aDigitCount);
+    return result.takeString();
 }
 
 
 
 // Parsing Chars //////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool skipChar(String aChars, bool aMandatory, String aText, int * ioIndex)
+bool skipChar(StringView aChars, bool aMandatory, StringView aText, ViewIndex * ioIndex)
 {
     bool found = aText.containsAnyCharAt(*ioIndex, containedIn, aChars);
 
@@ -223,9 +1283,9 @@ bool skipChar(String aChars, bool aMandatory, String aText, int * ioIndex)
 }
 
 
-bool skipChars(String aChars, bool aMandatory, String aText, int * ioIndex)
+bool skipChars(StringView aChars, bool aMandatory, StringView aText, ViewIndex * ioIndex)
 {
-    int length;
+    ViewIndex length;
     bool found = aText.containsCharsAt(*ioIndex, containedIn, aChars, &length);
 
     if (found)
@@ -235,14 +1295,20 @@ bool skipChars(String aChars, bool aMandatory, String aText, int * ioIndex)
 }
 
 
-String radixChars(int aRadix)
+constexpr StringConstant binaryDigits("01");
+constexpr StringConstant octalDigits("01234567");
+constexpr StringConstant decimalDigits("0123456789");
+constexpr StringConstant hexDigits("0123456789ABCDEFabcdef");
+
+
+StringView radixChars(int aRadix)
 {
     switch (aRadix)
     {
-        case 2:  return "01";
-        case 8:  return "01234567";
-        case 10: return "0123456789";
-        case 16: return "0123456789ABCDEFabcdef";
+        case 2:  return binaryDigits;
+        case 8:  return octalDigits;
+        case 10: return decimalDigits;
+        case 16: return hexDigits;
 
         default: 
             assert(false);
@@ -254,15 +1320,16 @@ String radixChars(int aRadix)
 
 // Parsing Comments and Whitespace ////////////////////////////////////////////////////////////////////////////////////
 
-const String whitespace = " \t";
-const String newline = "\n\r";
+constexpr StringConstant whitespace(" \t");
+constexpr StringConstant newline("\n\r");
+constexpr auto blank = whitespace + newline;
 
 
-bool skipLineCommentStart(String aText, int * ioIndex)
+bool skipLineCommentStart(StringView aText, ViewIndex * ioIndex)
 {
     // format: //
 
-    static const String commentStart = "//";
+    static constexpr StringConstant commentStart("//");
 
     bool found = aText.containsAt(*ioIndex, commentStart);
 
@@ -273,14 +1340,14 @@ bool skipLineCommentStart(String aText, int * ioIndex)
 }
 
 
-bool skipLineComment(String aText, int * ioIndex)
+bool skipLineComment(StringView aText, ViewIndex * ioIndex)
 {
     // format: // ... eol
 
     if (!skipLineCommentStart(aText, ioIndex))
         return false;
 
-    int length;
+    ViewIndex length;
     aText.containsCharsAt(*ioIndex, notContainedIn, newline, &length);
 
     *ioIndex += length;
@@ -291,29 +1358,31 @@ bool skipLineComment(String aText, int * ioIndex)
 }
 
 
-bool skipGeneralComment(String aText, int * ioIndex)
+bool skipGeneralComment(StringView aText, ViewIndex * ioIndex)
 {
     // format: /* ... */
 
-    static const String commentStart = "/*";
-    static const String commentEnd = "*/";
+    static constexpr StringConstant commentStart("/*");
+    static const StringSearcher commentEnd("*/");
 
     if (!aText.containsAt(*ioIndex, commentStart))
         return false;
 
-    int endIndex = aText.indexOf(commentEnd, caseSensitive, *ioIndex);
+    ViewIndex endIndex = commentEnd.indexIn(aText, *ioIndex);
 
     if (endIndex != notFound)
-        *ioIndex = endIndex + commentEnd.length();
+        *ioIndex = endIndex + commentEnd.substring().length();
+    else
+        *ioIndex = aText.length();  // unterminated comment continues to the end of text
 
     return true;
 }
 
 
-void skipBlank(String aText, int * ioIndex)
+void skipBlank(StringView aText, ViewIndex * ioIndex)
 {
     while (
-        skipChars(whitespace + newline, true, aText, ioIndex) ||
+        skipChars(blank, true, aText, ioIndex) ||
         skipLineComment(aText, ioIndex) ||
         skipGeneralComment(aText, ioIndex)
     );
@@ -321,35 +1390,150 @@ void skipBlank(String aText, int * ioIndex)
 
 
 
-// Parsing Definition Header //////////////////////////////////////////////////////////////////////////////////////////
+// Loading Source Items ///////////////////////////////////////////////////////////////////////////////////////////////
 
-bool moveToNextLocalParam(String aText, int * ioIndex)
+bool scanItem(StringView aText, ViewIndex * ioIndex)
 {
-    static String localParam = "localparam";
+    // format: ... , ... eol
+    // format: ... ; ... eol
+    // delimiters inside comments are skipped, returns false when the item can continue behind the end of aText
+    // and moves *ioIndex to position from which the scanning can be resumed when more text is available
 
-    int index = aText.indexOf(localParam, caseSensitive, *ioIndex);
+    static constexpr StringConstant stopChars(",;/");
 
-    if (index == notFound)
-        return false;
+    while (*ioIndex < aText.length())
+    {
+        ViewIndex index = *ioIndex;
+
+        ViewIndex length;
+        aText.containsCharsAt(index, notContainedIn, stopChars, &length);
+        index += length;
+
+        if (index >= aText.length())
+        {
+            *ioIndex = index;
+            return false;
+        }
+
+        if (aText[index] == '/')
+        {
+            *ioIndex = index;  // comment is scanned again when it continues behind the end of text
+
+            if (!skipLineComment(aText, &index) && !skipGeneralComment(aText, &index))
+                index += 1;
+
+            if (index >= aText.length())
+                return false;
+
+            *ioIndex = index;
+        }
+        else
+        {
+            *ioIndex = index;
+
+            aText.containsCharsAt(index, notContainedIn, newline, &length);  // rest of line is part of error messages
+            return index + length < aText.length();
+        }
+    }
+
+    return false;
+}
+
+
+void loadItem(SourceWindow * ioSource, ViewIndex * ioIndex)
+{
+    // ensures the whole item starting at *ioIndex is in the window (text before the item is dropped)
+    // so the parsing of the item never reaches the end of window unless it is end of file
+
+    if (ioSource->isAtEnd())
+        return;
+
+    ViewIndex scanIndex = *ioIndex;
+
+    while (!scanItem(ioSource->text(), &scanIndex) && !ioSource->isAtEnd())
+    {
+        ViewIndex droppedLength = ioSource->advance(*ioIndex);
+        *ioIndex -= droppedLength;
+        scanIndex -= droppedLength;
+    }
+}
+
+
+bool scanDefinition(StringView aText, ViewIndex * ioIndex)
+{
+    // format: item [, item] ;  (see scanItem)
+    // moves *ioIndex to the terminating ";" or returns false the same way as scanItem
 
-    *ioIndex = index + localParam.length();
+    while (scanItem(aText, ioIndex))
+    {
+        if (aText[*ioIndex] == ';')
+            return true;
+
+        *ioIndex += 1;
+    }
+
+    return false;
+}
+
+
+ViewIndex loadDefinition(SourceWindow * ioSource, ViewIndex * ioIndex)
+{
+    // ensures the whole definition of symbols starting at *ioIndex is in the window (text before it is dropped) 
+    // and returns index of its terminating ";" (or length of the text when the definition is not terminated)
+
+    ViewIndex scanIndex = *ioIndex;
+
+    while (!scanDefinition(ioSource->text(), &scanIndex))
+    {
+        if (ioSource->isAtEnd())
+            return ioSource->text().length();
 
-    return *ioIndex < aText.length();
+        ViewIndex droppedLength = ioSource->advance(*ioIndex);
+        *ioIndex -= droppedLength;
+        scanIndex -= droppedLength;
+    }
+
+    return scanIndex;
 }
 
 
-int isTableNameChar(int aChar)
+
+// Parsing Definition Header //////////////////////////////////////////////////////////////////////////////////////////
+
+bool moveToNextLocalParam(SourceWindow * ioSource, ViewIndex * ioIndex)
 {
-    return aChar > 0 && (isalnum(aChar) || aChar == '_');
+    static const StringSearcher localParam("localparam");
+    const ViewIndex localParamLength = localParam.substring().length();
+
+    while (true)
+    {
+        StringView text = ioSource->text();
+        ViewIndex index = localParam.indexIn(text, *ioIndex);
+
+        if (index != notFound && (index + localParamLength < text.length() || ioSource->isAtEnd()))
+        {
+            *ioIndex = index + localParamLength;
+            return *ioIndex < text.length();
+        }
+
+        if (ioSource->isAtEnd())
+            return false;
+
+        // keyword found at the end of window or its beginning can be at the end of window
+        ViewIndex keptIndex = index != notFound ? index : max(*ioIndex, text.length() - localParamLength + 1);
+
+        ioSource->advance(keptIndex);
+        *ioIndex = 0;
+    }
 }
 
 
-bool readHeaderTableName(String * oTableName, String aText, int * ioIndex)
+bool readHeaderTableName(Atom * oTableName, StringView aText, ViewIndex * ioIndex)
 {
-    int length;
-    if (aText.containsCharsAtWhere(*ioIndex, isTableNameChar, true, &length))
+    ViewIndex length;
+    if (aText.containsCharsAtWhere(*ioIndex, isAsciiIdentifierChar, &length))
     {
-        *oTableName = aText.substringFrom(*ioIndex, length);
+        *oTableName = Atom(aText.substringFrom(*ioIndex, length));
         *ioIndex += length;
         return true;
     }
@@ -358,19 +1542,18 @@ bool readHeaderTableName(String * oTableName, String aText, int * ioIndex)
 }
 
 
-bool readHeaderBitWidth(int * oBitWidth, String aText, int * ioIndex)
+bool readHeaderBitWidth(int * oBitWidth, StringView aText, ViewIndex * ioIndex)
 {
-    int index = *ioIndex;
+    ViewIndex index = *ioIndex;
 
-    int length;
-    String bitWidthText;
+    ViewIndex length;
     if (!aText.containsCharsAt(index, containedIn, radixChars(10), &length))
         return false;
 
-    bitWidthText = aText.substringFrom(index, length);
+    StringView bitWidthText = aText.substringFrom(index, length);
     index += length;
 
-    if (!tryStringToInt(bitWidthText, oBitWidth, 10))
+    if (!tryDigitsToInt(bitWidthText, oBitWidth))
         return false;
 
     *ioIndex = index;
@@ -378,26 +1561,26 @@ bool readHeaderBitWidth(int * oBitWidth, String aText, int * ioIndex)
 }
 
 
-String readRemovingPrefix(String aText, int * ioIndex)
+Atom readRemovingPrefix(StringView aText, ViewIndex * ioIndex)
 {
-    int length;
-    if (!aText.containsCharsAt(*ioIndex, notContainedIn, whitespace + newline, &length))
-        return "";
+    ViewIndex length;
+    if (!aText.containsCharsAt(*ioIndex, notContainedIn, blank, &length))
+        return Atom("");
 
-    String prefix = aText.substringFrom(*ioIndex, length);
+    Atom prefix(aText.substringFrom(*ioIndex, length));
     *ioIndex += length;
 
     return prefix;
 }
 
 
-bool readHeader(String * oTableName, int * oBitWidth, String * oRemovingPrefix, String aText, int * ioIndex)
+bool readHeader(Atom * oTableName, int * oBitWidth, Atom * oRemovingPrefix, StringView aText, ViewIndex * ioIndex)
 {
     // format: // $table_name : bit_width [; removing_prefix]
 
-    int index = *ioIndex;
+    ViewIndex index = *ioIndex;
 
-    skipChars(whitespace + newline, false, aText, &index);
+    skipChars(blank, false, aText, &index);
 
     if (!skipLineCommentStart(aText, &index))
         return false;
@@ -429,14 +1612,14 @@ bool readHeader(String * oTableName, int * oBitWidth, String * oRemovingPrefix,
         skipChars(whitespace, false, aText, &index);
     }
     else
-        *oRemovingPrefix = "";
+        *oRemovingPrefix = Atom("");
 
     if (!skipChars(newline, true, aText, &index))
         return false;
 
     if (*oBitWidth < 1 || *oBitWidth > verilogNumberMaxBitWidth)
         throw String::formatted(
-            "Unsupported size (%d bits) of \"%s\" (size must be from 1 to %d bits).", 
+            lf("Unsupported size (%d bits) of \"%s\" (size must be from 1 to %d bits)."), 
             *oBitWidth, oTableName->rb(), verilogNumberMaxBitWidth);
 
     *ioIndex = index;
@@ -447,18 +1630,18 @@ bool readHeader(String * oTableName, int * oBitWidth, String * oRemovingPrefix,
 
 // Parsing Verilog Number /////////////////////////////////////////////////////////////////////////////////////////////
 
-bool readNumberBitWidth(int * oBitWidth, String aText, int * ioIndex)
+bool readNumberBitWidth(int * oBitWidth, StringView aText, ViewIndex * ioIndex)
 {
-    int index = *ioIndex;
+    ViewIndex index = *ioIndex;
 
-    int length;
+    ViewIndex length;
     if (!aText.containsCharsAt(index, containedIn, radixChars(10), &length))
         return false;
 
-    String radixText = aText.substringFrom(index, length);
+    StringView radixText = aText.substringFrom(index, length);
     index += length;
 
-    if (!tryStringToInt(radixText, oBitWidth, 10))
+    if (!tryDigitsToInt(radixText, oBitWidth))
         return false;
 
     *ioIndex = index;
@@ -466,9 +1649,9 @@ bool readNumberBitWidth(int * oBitWidth, String aText, int * ioIndex)
 }
 
 
-bool readNumberRadix(int * oRadix, String aText, int * ioIndex)
+bool readNumberRadix(int * oRadix, StringView aText, ViewIndex * ioIndex)
 {
-    int index = *ioIndex;
+    ViewIndex index = *ioIndex;
 
     if (!aText.containsAt(index, '\''))
         return false;
@@ -488,25 +1671,27 @@ bool readNumberRadix(int * oRadix, String aText, int * ioIndex)
 }
 
 
-bool readNumberValue(String * oValueText, String aText, int * ioIndex)
+bool readNumberValue(StringView * oValueText, StringView aText, ViewIndex * ioIndex)
 {
-    int index = *ioIndex;
+    // the value text contains underscores which are skipped by tryDigitsToVerilogNumber
+
+    ViewIndex index = *ioIndex;
+
+    ViewIndex length;
+    static constexpr auto valueChars = hexDigits + '_';
 
-    int length;
-    if (!aText.containsCharsAt(index, containedIn, radixChars(16) + '_', &length))
+    if (!aText.containsCharsAt(index, containedIn, valueChars, &length))
         return false;
 
     *oValueText = aText.substringFrom(index, length);
     index += length;
 
-    oValueText->remove('_');
-
     *ioIndex = index;
     return true;
 }
 
 
-VerilogNumber readNumber(String aText, int * ioIndex)
+VerilogNumber readNumber(StringView aText, ViewIndex * ioIndex)
 {
     // format: <bit_widh> <'radix> <value>
     // format: <'radix> <value>
@@ -514,9 +1699,9 @@ VerilogNumber readNumber(String aText, int * ioIndex)
 
     int radix;
     int bitWidth;
-    String valueText;
+    StringView valueText;
 
-    int startIndex = *ioIndex;
+    ViewIndex startIndex = *ioIndex;
 
     bool readed = 
         readNumberBitWidth(&bitWidth, aText, ioIndex) &&
@@ -547,9 +1732,9 @@ VerilogNumber readNumber(String aText, int * ioIndex)
         !readed || 
         bitWidth < 1 || 
         bitWidth > verilogNumberMaxBitWidth ||
-        !tryStringToVerilogNumber(valueText, &value, radix)
+        !tryDigitsToVerilogNumber(valueText, &value, radix)
     ) throw String::formatted(
-        "Value must be non-negative integer constant with max %d bits size.", 
+        lf("Value must be non-negative integer constant with max %d bits size."), 
         verilogNumberMaxBitWidth);
 
     return value;
@@ -557,53 +1742,245 @@ VerilogNumber readNumber(String aText, int * ioIndex)
 
 
 
-// Parsing Symbols ////////////////////////////////////////////////////////////////////////////////////////////////////
+// Writing Symbol Table ///////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Symbol
+{
+    StringView name;  // refers to source window so it is valid only until next part of the source is loaded
+    VerilogNumber value;
+    Symbol(StringView aName, VerilogNumber aValue): name(aName), value(aValue) {}
+};
+
+
+// Writes symbols to table file as soon as they are parsed so memory used for a table doesn't depend on count of symbols.
+// Formatted lines are collected in buffer which is handed over to writer thread when it is full. Table file which is not
+// finished (e.g. parsing of the definition failed) is deleted so incomplete table is never left in output directory.
+// Deferred table only collects the text and warnings (e.g. when it is parsed in worker thread), they are printed 
+// and written after publish is called in the main thread.
+class SymbolTableWriter
+{
+    public:
+        static const int bufferSize = 64 << 10;
+        static const int warningLevel = 1;
+
+        SymbolTableWriter(String aTableFilePath, int aBitWidth, String aVerilogFileName, Atom aTableName, Atom aRemovingPrefix, 
+            OutputWriter * ioOutput, bool anIsDeferred = false)
+        {
+            fOutput = ioOutput;
+            fTableFilePath = aTableFilePath.rb();
+            fFileKey = hash<string>()(fTableFilePath);
+            fFile = make_shared<ofstream>();
+            fVerilogFileName = aVerilogFileName;
+            fTableName = aTableName;
+            fRemovingPrefix = aRemovingPrefix;
+            fBitWidth = aBitWidth;
+            fSizeMask = bitWidthMask(aBitWidth);
+            fHexDigitCount = aBitWidth / 4 + (aBitWidth % 4 ? 1 : 0);
+            fWasWarning = false;
+            fIsDeferred = anIsDeferred;
+            fIsOpened = false;
+            fIsFinished = false;
+            fSymbolCount = 0;
+
+            if (!fIsDeferred)  // deferred table grows on demand because a batch can hold many small tables
+            {
+                fText.reserveCapacity(bufferSize);
+                open();
+            }
+        }
+
+        ~SymbolTableWriter()
+        {
+            if (fIsOpened && !fIsFinished && !isDiscardingOutput)
+            {
+                string filePath = fTableFilePath;
+                shared_ptr<ofstream> file = fFile;
+
+                fOutput->post([filePath, file] {
+                    file->close();
+
+                    error_code ignoredError;
+                    filesystem::remove(filePath, ignoredError);
+                }, 0, fFileKey);
+            }
+        }
+
+        SymbolTableWriter(const SymbolTableWriter &) = delete;
+        SymbolTableWriter & operator = (const SymbolTableWriter &) = delete;
+
+        void write(const Symbol & aSymbol)
+        {
+            auto truncatedValue = aSymbol.value & fSizeMask;
+
+            if (truncatedValue != aSymbol.value && ConsoleLog::isWriting(warningLevel)) 
+            {
+                String hexValue = verilogNumberToHexString(aSymbol.value, 0);
+                String truncatedHexValue = verilogNumberToHexString(truncatedValue, fHexDigitCount);
+                warn(String::formatted(
+                    lf("SymbolEx Warning: Value of symbol %s.%s.%s was truncated to %d bits from value %s to %s."), 
+                    fVerilogFileName.rb(), fTableName.rb(), aSymbol.name.toString().rb(), fBitWidth, hexValue.rb(), truncatedHexValue.rb()));
+            }
+
+            StringView unprefixedName = aSymbol.name;
+
+            if (unprefixedName.hasPrefix(fRemovingPrefix.view()))
+                unprefixedName = unprefixedName.substringFrom(fRemovingPrefix.length());
+    
+            if (unprefixedName.isEmpty())
+            {
+                if (ConsoleLog::isWriting(warningLevel))
+                    warn(String::formatted(
+                        lf("SymbolEx Warning: Removing prefix \"%s\" shorted the name of the symbol %s.%s.%s to empty text."), 
+                        fRemovingPrefix.rb(), fVerilogFileName.rb(), fTableName.rb(), aSymbol.name.toString().rb()));
+            }
+            else
+            {
+                fText.appendHex(truncatedValue, fHexDigitCount);
+                fText.append(' ');
+                fText.append(unprefixedName);
+                fText.append('\n');
+                fSymbolCount += 1;
+
+                if (fText.length() >= bufferSize && verbosityLevel < 5 && !fIsDeferred)  // whole text is kept for printing at the highest verbosity
+                    flush();
+            }
+        }
+
+        // Prints warnings collected by deferred table and enables its writing.
+        void publish()
+        {
+            consoleLog.append(&fDeferredLog);
+            fIsDeferred = false;
+
+            open();
+        }
+
+        void finish()
+        {
+            if (fWasWarning)
+                consoleWrite(2, "");
+
+            consoleLog.writeText(5, fText.view());
+
+            flush();
+
+            post([](ofstream * aFile, const string &) {
+                aFile->close();
+            });
+
+            fIsFinished = true;
+
+            statistics.count(ctTables);
+            statistics.count(ctSymbols, fSymbolCount);
+        }
+
+    private:
+        void open()
+        {
+            post([](ofstream * aFile, const string & aFilePath) {
+                aFile->exceptions(ios::badbit | ios::failbit);
+                aFile->open(aFilePath, ios::out);
+            });
+
+            fIsOpened = true;
+        }
+
+        void warn(String aWarning)
+        {
+            if (fIsDeferred)
+                fDeferredLog.writeText(warningLevel, aWarning);
+            else
+                consoleLog.writeText(warningLevel, aWarning);
+
+            fWasWarning = true;
+        }
+
+        void flush()
+        {
+            auto text = make_shared<string>(fText.view().chars(), (size_t) fText.length());
+            fText.clear();
+
+            statistics.count(ctWrittenBytes, (long long) text->size());
+
+            post([text](ofstream * aFile, const string &) {
+                aFile->write(text->data(), text->size());
+            }, text->size());
+        }
+
+        // Posts anOperation with the table file to writer thread and reports its failure the same way as synchronous writing.
+        template <class Operation>
+        void post(Operation anOperation, size_t aByteSize = 0)
+        {
+            string filePath = fTableFilePath;
+            shared_ptr<ofstream> file = fFile;
+
+            fOutput->post([anOperation, filePath, file] {
+                if (isDiscardingOutput)
+                    return;
+
+                try {
+                    anOperation(file.get(), filePath);
+                }
+                catch (ofstream::failure error) {
+                    throw String::formatted(
+                        lf("Can not write file \"%s\".\n%s"), 
+                        filePath.c_str(), error.what());
+                }
+            }, aByteSize, fFileKey);
+        }
 
-struct Symbol
-{
-    String name;
-    VerilogNumber value;
-    Symbol(String aName, VerilogNumber aValue): name(aName), value(aValue) {}
+    private:
+        OutputWriter * fOutput;
+        string fTableFilePath;
+        size_t fFileKey;  // tasks of the file are executed by the same writer thread
+        shared_ptr<ofstream> fFile;
+        String fVerilogFileName;
+        Atom fTableName;
+        Atom fRemovingPrefix;
+        int fBitWidth;
+        VerilogNumber fSizeMask;
+        int fHexDigitCount;
+        bool fWasWarning;
+        bool fIsDeferred;
+        bool fIsOpened;
+        bool fIsFinished;
+        long long fSymbolCount;
+        ConsoleLog fDeferredLog;  // warnings of deferred table
+        StringBuilder fText;
 };
 
 
-int isIdentifierStartChar(int aChar) 
-{ 
-    return aChar > 0 && (isalpha(aChar) || aChar == '_');
-}
 
+// Parsing Symbols ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int isIdentifierInnerChar(int aChar) 
-{ 
-    return aChar > 0 && (isalnum(aChar) || aChar == '_' || aChar == '$');
-}
+constexpr auto isIdentifierInnerChar = [](char aChar) { return isAsciiIdentifierChar(aChar) || aChar == '$'; };
 
 
-String readIdentifier(String aText, int * ioIndex)
+StringView readIdentifier(StringView aText, ViewIndex * ioIndex)
 {
     if (aText.containsAt(*ioIndex, '\\'))
         throw String("Escaped identifiers are not supported.");
 
-    int startIndex = *ioIndex;
+    ViewIndex startIndex = *ioIndex;
 
-    if (!aText.containsAnyCharAtWhere(*ioIndex, isIdentifierStartChar, true))
-        throw String::formatted("Missing or invalid identifier.");
+    if (!aText.containsAnyCharAtWhere(*ioIndex, isAsciiIdentifierStart))
+        throw String::formatted(lf("Missing or invalid identifier."));
 
     *ioIndex += 1;
 
-    int length;
-    if (aText.containsCharsAtWhere(*ioIndex, isIdentifierInnerChar, true, &length))
+    ViewIndex length;
+    if (aText.containsCharsAtWhere(*ioIndex, isIdentifierInnerChar, &length))
         *ioIndex += length;
 
     return aText.substringBetween(startIndex, *ioIndex);
 }
 
 
-Symbol readSymbol(String aText, int * ioIndex)
+Symbol readSymbol(StringView aText, ViewIndex * ioIndex)
 {
     // format: identifier = value
 
-    String name = readIdentifier(aText, ioIndex);
+    StringView name = readIdentifier(aText, ioIndex);
 
     skipBlank(aText, ioIndex);
 
@@ -618,92 +1995,187 @@ Symbol readSymbol(String aText, int * ioIndex)
 }
 
 
-vector<Symbol> readSymbols(String aTableName, String aText, int * ioIndex)
+void readSymbols(Atom aTableName, SourceWindow * ioSource, ViewIndex * ioIndex, SymbolTableWriter * ioTable)
 {
     // format: symbol [,symbol] ;
 
-    int symbolStartIndex;
+    ViewIndex symbolStartIndex = *ioIndex;
 
     try {
-        vector<Symbol> symbols;
-
         do {
-            skipBlank(aText, ioIndex);
+            loadItem(ioSource, ioIndex);
+
+            StringView text = ioSource->text();
+            skipBlank(text, ioIndex);
 
             symbolStartIndex = *ioIndex;
-            Symbol symbol = readSymbol(aText, ioIndex);
-            symbols.push_back(symbol);
+            Symbol symbol = readSymbol(text, ioIndex);
+            ioTable->write(symbol);
 
-            skipBlank(aText, ioIndex);
+            skipBlank(text, ioIndex);
         } 
-        while (skipChar(",", true, aText, ioIndex));
+        while (skipChar(",", true, ioSource->text(), ioIndex));
 
-        if (!skipChar(";", true, aText, ioIndex))
+        if (!skipChar(";", true, ioSource->text(), ioIndex))
             throw String("Unexpected end of the definition (expected \";\" after last value).");
-        
-        return symbols;
     }
     catch (String subError)
     {
-        int lengthToEol;
-        aText.containsCharsAt(symbolStartIndex, notContainedIn, newline, &lengthToEol);
+        StringView text = ioSource->text();
+        ViewIndex lengthToEol;
+        text.containsCharsAt(symbolStartIndex, notContainedIn, newline, &lengthToEol);
         throw String::formatted(
-            "Can't parse definition of \"%s\".\n"
+            lf("Can't parse definition of \"%s\".\n"
             "Can't analyze source text \"%s\".\n"
-            "%s", 
-            aTableName.rb(), aText.substringFrom(symbolStartIndex, lengthToEol).rb(), subError.rb());
+            "%s"), 
+            aTableName.view(), text.substringFrom(symbolStartIndex, lengthToEol), subError);
     }
 }
 
 
 
-// Building Symbol Table //////////////////////////////////////////////////////////////////////////////////////////////
+// Extracting Definitions in Parallel ////////////////////////////////////////////////////////////////////////////////
+
+// With more jobs (see --jobs) definitions of the file are collected to batch in which they are parsed and formatted
+// in parallel. Tables of the batch are printed and written in the main thread in source order so the output is the same
+// as when the definitions are extracted one after another.
+
+int jobCount = 1;
+const int maxJobCount = 256;
+
+#define definitionBatchSize (4 << 20)  // count of source characters collected in batch before it is extracted
 
-String buildTableText(vector<Symbol> aSymbols, int aBitWidth, String aVerilogFileName, String aTableName, String aRemovingPrefix)
+#define definitionBatchOutputSize (4 << 20)  // max count of output characters which can be formatted by definitions of batch
+
+#define definitionBatchCount 1024  // count of definitions collected in batch before it is extracted
+
+
+void runInParallel(int aCount, const function<void (int anIndex)> & aJob)
 {
-    VerilogNumber sizeMask = bitWidthMask(aBitWidth);
+    atomic<int> nextIndex(0);
+
+    auto worker = [&] {
+        for (int index = nextIndex++; index < aCount; index = nextIndex++)
+            aJob(index);
+    };
 
-    int hexDigitCount = aBitWidth / 4;
-    if (aBitWidth % 4) hexDigitCount += 1;
+    vector<thread> threads;
 
-    String text;
-    text.reserveCapacity(10000);
+    for (int order = 1; order < min(jobCount, aCount); order++)
+        threads.emplace_back([&] { Trace::nameThread("worker"); worker(); });
 
-    bool wasWarning = false;
+    worker();
+
+    for (auto & thread : threads)
+        thread.join();
+}
+
+
+void consoleWriteExtracting(Atom aTableName, int aBitWidth, Atom aRemovingPrefix)
+{
+    consoleWrite(5, "");
+    consoleWrite(3, "Extracting: %s:%d%s", aTableName.rb(), aBitWidth, 
+        (aRemovingPrefix.isEmpty() ? "" : "," + aRemovingPrefix.text()).rb());
+}
+
+
+struct Definition
+{
+    Atom tableName;
+    int bitWidth;
+    Atom removingPrefix;
+    string text;  // copy of source text from the end of header to the end of line with terminating ";"
+    unique_ptr<SymbolTableWriter> table;  // deferred table
+    String error = String::null;  // NULL when parsing succeeded
+};
 
-    for (auto symbol : aSymbols)
-    {
-        auto truncatedValue = symbol.value & sizeMask;
-        String truncatedHexValue = verilogNumberToHexString(truncatedValue, hexDigitCount);
 
-        if (truncatedValue != symbol.value) 
+class DefinitionBatch
+{
+    public:
+        DefinitionBatch()
         {
-            String hexValue = verilogNumberToHexString(symbol.value, 0);
-            consoleWrite(1, "SymbolEx Warning: Value of symbol %s.%s.%s was truncated to %d bits from value %s to %s.", 
-                aVerilogFileName.rb(), aTableName.rb(), symbol.name.rb(), aBitWidth, hexValue.rb(), truncatedHexValue.rb());
-            wasWarning = true;
+            fTextLength = 0;
+            fOutputLength = 0;
         }
 
-        String unprefixedName = symbol.name;
-        unprefixedName.removePrefix(aRemovingPrefix);
-    
-        if (unprefixedName == "")
+        bool isFull() const
         {
-            consoleWrite(1, "SymbolEx Warning: Removing prefix \"%s\" shorted the name of the symbol %s.%s.%s to empty text.", 
-                aRemovingPrefix.rb(), aVerilogFileName.rb(), aTableName.rb(), symbol.name.rb());
-            wasWarning = true;
+            return 
+                fTextLength >= definitionBatchSize || 
+                fOutputLength >= definitionBatchOutputSize || 
+                fDefinitions.size() >= definitionBatchCount;
+        }
+
+        // Adds definition of symbols at aText from aStartIndex to anEndIndex. Tables are created in the main thread
+        // because arguments of type String can't be copied in parallel (String doesn't count references atomically).
+        void add(Atom aTableName, int aBitWidth, Atom aRemovingPrefix, StringView aText, ViewIndex aStartIndex, ViewIndex anEndIndex,
+            String aTableFilePath, String aVerilogFileName, OutputWriter * ioOutput)
+        {
+            Definition definition;
+            definition.tableName = aTableName;
+            definition.bitWidth = aBitWidth;
+            definition.removingPrefix = aRemovingPrefix;
+            definition.text.assign(aText.chars() + aStartIndex, (size_t) (anEndIndex - aStartIndex));
+            definition.table.reset(new SymbolTableWriter(aTableFilePath, aBitWidth, aVerilogFileName, aTableName, aRemovingPrefix, 
+                ioOutput, true));
+
+            // each symbol (with "=" in the text) is formatted to its name from the text, hexadecimal value, space and newline
+            size_t symbolCount = (size_t) count(definition.text.begin(), definition.text.end(), '=');
+            size_t hexDigitCount = (size_t) (aBitWidth + 3) / 4;
+
+            fTextLength += definition.text.size();
+            fOutputLength += definition.text.size() + symbolCount * (hexDigitCount + 2);
+            fDefinitions.push_back(move(definition));
         }
-        else
-            text += truncatedHexValue + ' ' + unprefixedName + '\n';
-    }
 
-    if (wasWarning)
-        consoleWrite(2, "");
+        // Parses definitions in parallel and then prints and writes their tables in order. 
+        // Throws error of the first definition which failed.
+        void extract()
+        {
+            PhaseScope parsing(phParse);
 
-    consoleWrite(5, "%s", text.rb());
+            runInParallel((int) fDefinitions.size(), [this](int anIndex) { parse(&fDefinitions[(size_t) anIndex]); });
 
-    return text;
-}
+            vector<Definition> definitions = move(fDefinitions);
+            fDefinitions.clear();
+            fTextLength = 0;
+            fOutputLength = 0;
+
+            for (auto & definition : definitions)
+            {
+                consoleWriteExtracting(definition.tableName, definition.bitWidth, definition.removingPrefix);
+
+                definition.table->publish();
+
+                if (!definition.error.isNull())
+                    throw definition.error;
+
+                definition.table->finish();
+            }
+        }
+
+    private:
+        static void parse(Definition * ioDefinition)
+        {
+            PhaseScope parsing(phParse);
+
+            SourceWindow text(StringView(ioDefinition->text.data(), (ViewIndex) ioDefinition->text.size()));
+            ViewIndex index = 0;
+
+            try {
+                readSymbols(ioDefinition->tableName, &text, &index, ioDefinition->table.get());
+            }
+            catch (String error) {
+                ioDefinition->error = error;
+            }
+        }
+
+    private:
+        vector<Definition> fDefinitions;
+        size_t fTextLength;
+        size_t fOutputLength;  // upper estimate of output formatted by the definitions
+};
 
 
 
@@ -711,6 +2183,11 @@ String buildTableText(vector<Symbol> aSymbols, int aBitWidth, String aVerilogFil
 
 void cleanOutputDirectory(String aVerilogFilePath, String anOutputFolderPath)
 {
+    if (isDiscardingOutput)
+        return;
+
+    PhaseScope cleaning(phClean);
+
     for (auto entry : filesystem::directory_iterator(anOutputFolderPath.rb()))
         if (entry.is_regular_file())
         {
@@ -723,28 +2200,29 @@ void cleanOutputDirectory(String aVerilogFilePath, String anOutputFolderPath)
                 } 
                 catch (exception error) {
                     throw String::formatted(
-                        "Can't delete file \"%s\".\n%s", 
+                        lf("Can't delete file \"%s\".\n%s"), 
                         entry.path().string().c_str(), error.what());
                 }
         }
 }
 
 
-void checkMultipleDefinition(String aTableName, unordered_set<string> * ioDefinedTables)
+void checkMultipleDefinition(Atom aTableName, unordered_set<Atom> * ioDefinedTables)
 {
-    auto item = ioDefinedTables->find(aTableName.rb());
-
-    if (item == ioDefinedTables->end())
-        ioDefinedTables->insert(aTableName.rb());
-    else
+    if (!ioDefinedTables->insert(aTableName).second)
         throw String::formatted(
-            "Multiple definition of \"%s\".", 
+            lf("Multiple definition of \"%s\"."), 
             aTableName.rb());
 }
 
 
-void extractSymbolsFromFile(String aVerilogFilePath, String anOutputFolderPath)
+void extractSymbolsFromFile(String aVerilogFilePath, String anOutputFolderPath, SourceReader * ioReader, OutputWriter * ioOutput)
 {
+    PhaseScope scanning(phScan);
+
+    auto startTime = chrono::steady_clock::now();
+    long long startSymbolCount = statistics.counter(ctSymbols);
+
     consoleWrite(3, "");
     consoleWrite(2, "Analyzing: %s", aVerilogFilePath.rb());
 
@@ -752,48 +2230,226 @@ void extractSymbolsFromFile(String aVerilogFilePath, String anOutputFolderPath)
 
     try {
         String verilogFileName = extractFileNameWithoutExtension(aVerilogFilePath);
-        String verilogFileText = readStringFromFile(aVerilogFilePath);
+        SourceWindow verilogFile(ioReader);
 
-        int index = 0;
-        unordered_set<string> definedTables;
+        ViewIndex index = 0;
+        unordered_set<Atom> definedTables;
+        DefinitionBatch batch;
 
-        while (moveToNextLocalParam(verilogFileText, &index))
-        {
-            String tableName; int bitWidth; String removingPrefix; 
-            if (readHeader(&tableName, &bitWidth, &removingPrefix, verilogFileText, &index))
+        try {
+            while (moveToNextLocalParam(&verilogFile, &index))
             {
-                checkMultipleDefinition(tableName, &definedTables);
+                loadItem(&verilogFile, &index);
+
+                Atom tableName; int bitWidth; Atom removingPrefix; 
+                if (readHeader(&tableName, &bitWidth, &removingPrefix, verilogFile.text(), &index))
+                {
+                    checkMultipleDefinition(tableName, &definedTables);
 
-                consoleWrite(5, "");
-                consoleWrite(3, "Extracting: %s:%d%s", tableName.rb(), bitWidth, 
-                    (removingPrefix.isEmpty() ? "" : "," + removingPrefix).rb());
+                    auto tableFilePath = buildTableFilePath(anOutputFolderPath, aVerilogFilePath, tableName);
 
-                auto symbols = readSymbols(tableName, verilogFileText, &index);
-                auto tableText = buildTableText(symbols, bitWidth, verilogFileName, tableName, removingPrefix);
+                    if (jobCount == 1)
+                    {
+                        consoleWriteExtracting(tableName, bitWidth, removingPrefix);
 
-                auto tableFilePath = buildTableFilePath(anOutputFolderPath, aVerilogFilePath, tableName);
-                writeStringToFile(tableFilePath, tableText);
+                        SymbolTableWriter table(tableFilePath, bitWidth, verilogFileName, tableName, removingPrefix, ioOutput);
+
+                        PhaseScope parsing(phParse);
+
+                        readSymbols(tableName, &verilogFile, &index, &table);
+                        table.finish();
+                    }
+                    else
+                    {
+                        ViewIndex endIndex = loadDefinition(&verilogFile, &index);
+                        StringView text = verilogFile.text();
+
+                        ViewIndex lengthToEol = 0;
+                        text.containsCharsAt(endIndex, notContainedIn, newline, &lengthToEol);  // rest of line is part of error messages
+
+                        batch.add(tableName, bitWidth, removingPrefix, text, index, endIndex + lengthToEol, 
+                            tableFilePath, verilogFileName, ioOutput);
+
+                        index = min(endIndex + 1, text.length());
+
+                        if (batch.isFull())
+                            batch.extract();
+                    }
+                }
             }
         }
+        catch (String) {
+            batch.extract();  // definitions before the failed one are extracted as when they are extracted one after another
+            throw;
+        }
+
+        batch.extract();
+
+        ioOutput->waitUntilIdle();  // write errors are reported for the file and old tables of next file can be deleted
+
+        if (isCollectingStatistics)
+            statistics.addFile(FileStatistics {
+                aVerilogFilePath.rb(), 
+                chrono::duration<double>(chrono::steady_clock::now() - startTime).count(),
+                verilogFile.readLength(), 
+                statistics.counter(ctSymbols) - startSymbolCount });
+
+        if (isTracing)
+            trace.addFile(aVerilogFilePath, startTime);
+
+        consoleLog.flush();
     }
     catch (String subError) {
         throw String::formatted(
-            "Problem when processing file \"%s\".\n%s",
+            lf("Problem when processing file \"%s\".\n%s"),
             aVerilogFilePath.rb(), subError.rb());
     }
 }
 
 
+void extractSymbolsFromFiles(const vector<String> & aVerilogFilePaths, String anOutputDirectoryPath)
+{
+    SourceReader reader(aVerilogFilePaths);
+    OutputWriter output;
+
+    for (const auto & verilogFilePath : aVerilogFilePaths)
+        extractSymbolsFromFile(verilogFilePath, anOutputDirectoryPath, &reader, &output);
+}
+
+
 void extractSymbolsFromDirectory(String aDirectoryPath, String anOutputDirectoryPath)
 {
-    for (auto entry : filesystem::directory_iterator(aDirectoryPath.rb()))
+    vector<String> verilogFilePaths;
+
+    {
+        PhaseScope walking(phWalk);
+
+        for (auto entry : filesystem::directory_iterator(aDirectoryPath.rb()))
+        {
+            string extension = entry.path().extension().string();
+            transform(extension.begin(), extension.end(), extension.begin(), [](char aChar) { return (char) tolower(aChar); });
+
+            if (extension == ".v" || extension == ".sv")
+                verilogFilePaths.push_back(entry.path().string().c_str());
+        }
+    }
+
+    extractSymbolsFromFiles(verilogFilePaths, anOutputDirectoryPath);
+}
+
+
+void extractSymbols(String aSourcePath, String anOutputDirectoryPath)
+{
+    if (filesystem::is_directory(aSourcePath.rb()))
+        extractSymbolsFromDirectory(aSourcePath, anOutputDirectoryPath);
+    else
+        extractSymbolsFromFiles({ aSourcePath }, anOutputDirectoryPath);
+}
+
+
+
+// Benchmarking ///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// With --bench the whole extraction is repeated in one process so the measured times don't include start of the process
+// and noise of reading files from disk. The first run only warms up the page cache and it is not counted. When it is 
+// much slower than the counted runs the source files were not cached before and a cold run of the tool takes longer 
+// than the reported times. Times of phases are taken from statistics which are reset before each run.
+
+const int maxBenchRunCount = 100000;
+
+const double coldRunRatio = 1.5;  // the warming up run is cold when it is slower than median of runs times the ratio
+
+
+// Nearest-rank percentile of aValues.
+double percentile(vector<double> aValues, double aPercent)
+{
+    sort(aValues.begin(), aValues.end());
+
+    size_t rank = (size_t) ceil(aPercent / 100 * (double) aValues.size());
+
+    return aValues[min(max(rank, (size_t) 1), aValues.size()) - 1];
+}
+
+
+struct BenchRun
+{
+    double seconds;
+    double phaseSeconds[phaseCount];
+};
+
+
+BenchRun runBenchExtraction(String aSourcePath, String anOutputDirectoryPath)
+{
+    statistics.reset();
+    MemoryAccounting::reset();
+
+    auto startTime = chrono::steady_clock::now();
+
+    extractSymbols(aSourcePath, anOutputDirectoryPath);
+
+    BenchRun run;
+    run.seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    for (int phase = 0; phase < phaseCount; phase++)
+        run.phaseSeconds[phase] = statistics.phaseSeconds((Phase) phase);
+
+    return run;
+}
+
+
+String formatPercentiles(const vector<double> & aValues)
+{
+    String text;
+    text.appendFormatted("min %.3f  median %.3f  p99 %.3f", percentile(aValues, 0), percentile(aValues, 50), percentile(aValues, 99));
+    return text;
+}
+
+
+// Returns wall time of the last run (statistics are collected only for it).
+double benchmarkExtraction(String aSourcePath, String anOutputDirectoryPath, int aRunCount)
+{
+    BenchRun warmingUpRun = runBenchExtraction(aSourcePath, anOutputDirectoryPath);
+    consoleWrite(2, "Warming up run: %.3f s", warmingUpRun.seconds);
+
+    vector<BenchRun> runs;
+    vector<double> runSeconds;
+
+    for (int run = 1; run <= aRunCount; run++)
+    {
+        runs.push_back(runBenchExtraction(aSourcePath, anOutputDirectoryPath));
+        runSeconds.push_back(runs.back().seconds);
+        consoleWrite(2, "Run %d: %.3f s", run, runs.back().seconds);
+    }
+
+    double medianSeconds = max(percentile(runSeconds, 50), 1e-9);
+    double megabytes = (double) statistics.counter(ctSourceBytes) / (1 << 20);
+
+    String text = String::formatted(lf("Benchmark (%d runs after warming up run):\n"), aRunCount);
+    text.appendFormatted("  Output: %s\n", isDiscardingOutput ? "discarded" : anOutputDirectoryPath.rb());
+    text.appendFormatted("  Wall time (s): %s\n", formatPercentiles(runSeconds).rb());
+    text.appendFormatted("  Median throughput: %.2f MiB/s, %.1f files/s, %.0f symbols/s\n", 
+        megabytes / medianSeconds, (double) statistics.counter(ctFiles) / medianSeconds, (double) statistics.counter(ctSymbols) / medianSeconds);
+    text.append("  Phases (seconds summed over threads):");
+
+    for (int phase = phNone + 1; phase < phaseCount; phase++)
     {
-        string extension = entry.path().extension().string();
-        transform(extension.begin(), extension.end(), extension.begin(), std::tolower);
+        vector<double> phaseSeconds;
+
+        for (const auto & run : runs)
+            phaseSeconds.push_back(run.phaseSeconds[phase]);
 
-        if (extension == ".v" || extension == ".sv")
-            extractSymbolsFromFile(entry.path().string().c_str(), anOutputDirectoryPath);
+        text.appendFormatted("\n    %-6s %s", phaseNames[phase], formatPercentiles(phaseSeconds).rb());
     }
+
+    consoleWrite(0, "%s", text.rb());
+
+    if (warmingUpRun.seconds > medianSeconds * coldRunRatio)
+        consoleWrite(1, 
+            "SymbolEx Warning: Page cache was cold, the warming up run took %.3f s (median of runs %.3f s). "
+            "A cold run of the tool is slower than the measured runs.", 
+            warmingUpRun.seconds, medianSeconds);
+
+    return runs.back().seconds;
 }
 
 
@@ -803,8 +2459,8 @@ void extractSymbolsFromDirectory(String aDirectoryPath, String anOutputDirectory
 String syntaxDescription()
 {
     return String::formatted(
-        "Syntax: symbolex [--verbosity 0-%d] verilog_file_or_folder [output_folder]",
-        maxVerbosityLevel);
+        lf("Syntax: symbolex [--verbosity 0-%d] [--inflight 1-%d] [--jobs 1-%d] [--stats] [--trace-out trace_file] [--bench runs] verilog_file_or_folder [output_folder]"),
+        maxVerbosityLevel, maxInflightBudget, maxJobCount);
 }
 
 
@@ -856,7 +2512,7 @@ bool readVerbosityLevel(int * oLevel, ArgumentsCursor * ioCursor)
 
     int level;
     if (!tryStringToInt(valueText, &level, 10) || level < 0 || level > maxVerbosityLevel)
-        throw String::formatted("Verbosity level \"%s\" is invalid.", valueText.rb());
+        throw String::formatted(lf("Verbosity level \"%s\" is invalid."), valueText.rb());
 
     *oLevel = level;
     ioCursor->moveToNextArgument();
@@ -865,6 +2521,131 @@ bool readVerbosityLevel(int * oLevel, ArgumentsCursor * ioCursor)
 }
 
 
+bool readInflightBudget(int * oBudget, ArgumentsCursor * ioCursor)
+{
+    // budget of in-flight data in MiB
+
+    String argument;
+    if (!ioCursor->getArgument(&argument))
+        return false;
+
+    argument.convertTo(lowerCase);
+    if (argument != "--inflight")
+        return false;
+
+    ioCursor->moveToNextArgument();
+
+    String valueText;
+    if (!ioCursor->getArgument(&valueText))
+        throw String("In-flight budget missing.");
+
+    int budget;
+    if (!tryStringToInt(valueText, &budget, 10) || budget < 1 || budget > maxInflightBudget)
+        throw String::formatted(lf("In-flight budget \"%s\" is invalid."), valueText.rb());
+
+    *oBudget = budget;
+    ioCursor->moveToNextArgument();
+
+    return true;
+}
+
+
+bool readJobCount(int * oCount, ArgumentsCursor * ioCursor)
+{
+    // count of threads parsing definitions of the file in parallel
+
+    String argument;
+    if (!ioCursor->getArgument(&argument))
+        return false;
+
+    argument.convertTo(lowerCase);
+    if (argument != "--jobs")
+        return false;
+
+    ioCursor->moveToNextArgument();
+
+    String valueText;
+    if (!ioCursor->getArgument(&valueText))
+        throw String("Job count missing.");
+
+    int count;
+    if (!tryStringToInt(valueText, &count, 10) || count < 1 || count > maxJobCount)
+        throw String::formatted(lf("Job count \"%s\" is invalid."), valueText.rb());
+
+    *oCount = count;
+    ioCursor->moveToNextArgument();
+
+    return true;
+}
+
+
+bool readStatisticsFlag(bool * oIsCollecting, ArgumentsCursor * ioCursor)
+{
+    String argument;
+    if (!ioCursor->getArgument(&argument))
+        return false;
+
+    argument.convertTo(lowerCase);
+    if (argument != "--stats")
+        return false;
+
+    *oIsCollecting = true;
+    ioCursor->moveToNextArgument();
+
+    return true;
+}
+
+
+bool readTraceFilePath(String * oFilePath, ArgumentsCursor * ioCursor)
+{
+    String argument;
+    if (!ioCursor->getArgument(&argument))
+        return false;
+
+    argument.convertTo(lowerCase);
+    if (argument != "--trace-out")
+        return false;
+
+    ioCursor->moveToNextArgument();
+
+    if (!ioCursor->getArgument(oFilePath) || oFilePath->isEmpty())
+        throw String("Trace file path missing.");
+
+    ioCursor->moveToNextArgument();
+
+    return true;
+}
+
+
+bool readBenchRunCount(int * oCount, ArgumentsCursor * ioCursor)
+{
+    // count of measured runs of the whole extraction (see benchmarkExtraction)
+
+    String argument;
+    if (!ioCursor->getArgument(&argument))
+        return false;
+
+    argument.convertTo(lowerCase);
+    if (argument != "--bench")
+        return false;
+
+    ioCursor->moveToNextArgument();
+
+    String valueText;
+    if (!ioCursor->getArgument(&valueText))
+        throw String("Count of benchmark runs missing.");
+
+    int count;
+    if (!tryStringToInt(valueText, &count, 10) || count < 1 || count > maxBenchRunCount)
+        throw String::formatted(lf("Count of benchmark runs \"%s\" is invalid."), valueText.rb());
+
+    *oCount = count;
+    ioCursor->moveToNextArgument();
+
+    return true;
+}
+
+
 bool readFileSystemPath(String * oFileSystemPath, ArgumentsCursor * ioCursor)
 {
     if (!oFileSystemPath->isEmpty())
@@ -882,7 +2663,12 @@ bool readFileSystemPath(String * oFileSystemPath, ArgumentsCursor * ioCursor)
 bool readCommandLineArguments(int aCount, char ** anArguments, 
     String * oSourcePath, 
     String * oOutputDirectoryPath,
-    int * oVerbosityLevel)
+    int * oVerbosityLevel,
+    int * oInflightBudget,
+    int * oJobCount,
+    bool * oIsCollectingStatistics,
+    String * oTraceFilePath,
+    int * oBenchRunCount)
 {
     if (aCount < 2)
         return false;
@@ -891,19 +2677,29 @@ bool readCommandLineArguments(int aCount, char ** anArguments,
         *oSourcePath = "";
         *oOutputDirectoryPath = "";
         *oVerbosityLevel = 1;
+        *oInflightBudget = defaultInflightBudget;
+        *oJobCount = 1;
+        *oIsCollectingStatistics = false;
+        *oTraceFilePath = String::null;
+        *oBenchRunCount = 0;
 
         ArgumentsCursor cursor(aCount, anArguments);
         cursor.moveToNextArgument();  // skip first argument (path to program file)
 
         while (
             readVerbosityLevel(oVerbosityLevel, &cursor) ||
+            readInflightBudget(oInflightBudget, &cursor) ||
+            readJobCount(oJobCount, &cursor) ||
+            readStatisticsFlag(oIsCollectingStatistics, &cursor) ||
+            readTraceFilePath(oTraceFilePath, &cursor) ||
+            readBenchRunCount(oBenchRunCount, &cursor) ||
             readFileSystemPath(oSourcePath, &cursor) ||
             readFileSystemPath(oOutputDirectoryPath, &cursor)
         );
 
         String unknownArgument;
         if (cursor.getArgument(&unknownArgument))
-            throw String::formatted("Unknown argument \"%s\".", unknownArgument.rb());
+            throw String::formatted(lf("Unknown argument \"%s\"."), unknownArgument.rb());
 
         if (oSourcePath->isEmpty())
             throw String("Missing path to source verilog file or folder.");
@@ -912,7 +2708,7 @@ bool readCommandLineArguments(int aCount, char ** anArguments,
     }
     catch (String subError) {
         throw String::formatted(
-            "Problem when reading command line arguments.\n%s\n\n%s",
+            lf("Problem when reading command line arguments.\n%s\n\n%s"),
             subError.rb(), syntaxDescription().rb());
     }
 }
@@ -940,33 +2736,67 @@ void printError(String anError)
 }
 
 
+#ifndef SYMBOLEX_WITHOUT_MAIN  // defined when the file is included by a benchmark (see Source/Benchmarks)
+
 int main(int argc, char * argv[])
 {
     try {
         String sourcePath;
         String outputDirectoryPath;
+        String traceFilePath;
+        int benchRunCount;
 
         if (!readCommandLineArguments(argc, argv,
             &sourcePath,
             &outputDirectoryPath,
-            &verbosityLevel)) 
+            &verbosityLevel,
+            &inflightBudget,
+            &jobCount,
+            &isCollectingStatistics,
+            &traceFilePath,
+            &benchRunCount)) 
         {
             printProgramDescription();
             return 0;
         }
 
+        auto startTime = chrono::steady_clock::now();
+        isTracing = !traceFilePath.isNull();
+
+        bool isPrintingStatistics = isCollectingStatistics;
+        isCollectingStatistics = isCollectingStatistics || benchRunCount > 0;  // benchmark reports phases from statistics
+
+        if (isPrintingStatistics)
+            MemoryAccounting::start();
+
+        Trace::nameThread("main");
+
         if (!filesystem::exists(sourcePath.rb()))
-            throw String::formatted("Verilog source file or folder \"%s\" not found.", sourcePath.rb());
+            throw String::formatted(lf("Verilog source file or folder \"%s\" not found."), sourcePath.rb());
 
         if (!outputDirectoryPath.isEmpty())
             createDirectoryPath(outputDirectoryPath);
         else
+        {
             outputDirectoryPath = filesystem::current_path().string().c_str();
-            
-        if (filesystem::is_directory(sourcePath.rb()))
-            extractSymbolsFromDirectory(sourcePath, outputDirectoryPath);
+            isDiscardingOutput = benchRunCount > 0;
+        }
+
+        double wallSeconds;
+
+        if (benchRunCount > 0)
+            wallSeconds = benchmarkExtraction(sourcePath, outputDirectoryPath, benchRunCount);
         else
-            extractSymbolsFromFile(sourcePath, outputDirectoryPath);
+        {
+            extractSymbols(sourcePath, outputDirectoryPath);
+            wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        }
+
+        if (isPrintingStatistics)
+            statistics.print(wallSeconds);
+
+        if (isTracing)
+            trace.write(traceFilePath);
 
         return 0;
     }
@@ -984,3 +2814,4 @@ int main(int argc, char * argv[])
     }
 }
 
+#endif